@@ -3,6 +3,9 @@ use std::collections::HashMap;
 
 mod git;
 mod optimization;
+// Reader for the files written with --positionsFile, kept with its tests. The optimizer
+// itself works from the statistics written to --summaryFile
+#[cfg(test)]
 mod position_parser;
 mod util;
 
@@ -1,6 +1,3 @@
-use crate::position_parser::{SimulationData, TimePoint};
-
-use glam::Vec3A;
 use once_cell::sync::OnceCell;
 use plotters::prelude::*;
 use rand::{distributions::Alphanumeric, Rng};
@@ -57,15 +54,27 @@ static RUNNING: AtomicBool = AtomicBool::new(true);
 static PATH: OnceCell<String> = OnceCell::new();
 static STATE: OnceCell<State> = OnceCell::new();
 
-static BASE_ARGUMENTS: [&str; 5] = [
+static BASE_ARGUMENTS: [&str; 7] = [
     "--duration=180",
     "--pNodes=8",
     "--packetInterval=0.3",
     "--calculateInterval=0.01",
     "--spawnRadius=8.5",
+    // The swarm statistics are computed during the run, so nothing else needs to hit the disk
+    "--logPositions=false",
+    "--pcap=false",
 ];
 const TARGET_DISTANCE: f64 = 7.5;
 
+/// Swarm stability statistics written by the simulation to `--summaryFile`
+#[derive(serde::Deserialize, Debug)]
+#[serde(rename_all = "camelCase")]
+struct SwarmSummary {
+    mean_central_distance: f64,
+    peripheral_distance_mad: f64,
+    mean_velocity: f64,
+}
+
 const MAX_SIMULATIONS: usize = 1000;
 
 static LOWEST_ERROR: atomic_float::AtomicF64 = atomic_float::AtomicF64::new(10000.0);
@@ -450,27 +459,26 @@ fn run_thread() {
     for arg in BASE_ARGUMENTS.iter() {
         args.push((*arg).to_owned());
     }
+    args.push(format!("--targetDistance={}", TARGET_DISTANCE));
+    let base_len = args.len();
 
     while RUNNING.load(Ordering::Relaxed) {
-        let pos_file_name: String = rand::thread_rng()
+        let summary_file_name: String = rand::thread_rng()
             .sample_iter(&Alphanumeric)
             .take(10)
             .map(char::from)
             .collect();
 
         //Keep base arguments
-        args.resize(BASE_ARGUMENTS.len(), String::new());
+        args.resize(base_len, String::new());
 
         let ns3_path = PATH.get().unwrap();
         let mut buf = PathBuf::from(ns3_path);
-        buf.push(pos_file_name);
-        buf.set_extension("csv");
-        let mut positions_file = std::env::current_dir().unwrap();
-        positions_file.push(buf);
-        args.push(format!(
-            "--positionsFile={}",
-            &positions_file.to_str().unwrap()
-        ));
+        buf.push(summary_file_name);
+        buf.set_extension("json");
+        let mut summary_file = std::env::current_dir().unwrap();
+        summary_file.push(buf);
+        args.push(format!("--summaryFile={}", &summary_file.to_str().unwrap()));
 
         let seed: usize = rng.gen();
         args.push(format!("--seed={}", seed));
@@ -487,7 +495,7 @@ fn run_thread() {
 
         //Run simulation
         match run_binary(ns3_path, "build/scratch/non-ideal/non-ideal", &args) {
-            Ok(_) => match run_analysis(&positions_file, &param_map, &positions_file) {
+            Ok(_) => match run_analysis(&summary_file, &param_map) {
                 Ok(_) => {}
                 Err(err) => {
                     println!("Error while doing analysis: {}", err);
@@ -495,95 +503,32 @@ fn run_thread() {
             },
             Err(err) => {
                 println!("Error while running waf: {}", err);
-                let _ = std::fs::remove_file(positions_file);
+                let _ = std::fs::remove_file(summary_file);
             }
         }
     }
     println!("Runner exiting cleanly");
 }
 
-fn get_error(data: &mut SimulationData) -> f64 {
-    let time_step = 0.1;
-    let mut time = 0.0;
-    let mut last_poses = IndexMap::new();
-    let uavs = data.uavs.clone();
-    let central_node = uavs.iter().min().unwrap();
-
-    let mut all_central_distances = Vec::new();
-    let mut all_peripheral_distances = Vec::new();
-    let mut all_velocities = Vec::new();
-    while time <= data.simulation_length {
-        let mut central_distances: Vec<f64> = Vec::new();
-        let mut peripheral_distances: Vec<f64> = Vec::new();
-        let mut velocities: Vec<f64> = Vec::new();
-
-        let central_pos = data.pos_at_time(TimePoint(time), *central_node).unwrap();
-        for uav in &uavs {
-            if let Some(now_pos) = data.pos_at_time(TimePoint(time), *uav) {
-                match last_poses.get(uav) {
-                    None => {}
-                    Some((last_pos, last_time)) => {
-                        let pos_delta = now_pos - *last_pos;
-                        let time_delta = time - last_time;
-                        let velocity: Vec3A = pos_delta / time_delta;
-                        velocities.push(velocity.length() as f64);
-                    }
-                }
-                last_poses.insert(uav, (now_pos, time));
-                if uav != central_node {
-                    central_distances.push((now_pos - central_pos).length() as f64);
-                    for uav_2 in &uavs {
-                        if uav != uav_2 && uav_2 != central_node {
-                            //Calculate the distance between this node and every other peripheral node
-                            if let Some(now_2_pos) = data.pos_at_time(TimePoint(time), *uav_2) {
-                                peripheral_distances.push((now_2_pos - now_pos).length() as f64);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        let central_distances_mean =
-            rgsl::statistics::mean(&central_distances, 1, central_distances.len());
-        let peripheral_distances_mean =
-            rgsl::statistics::mean(&peripheral_distances, 1, peripheral_distances.len());
-
-        let mean_velocity = rgsl::statistics::mean(&velocities, 1, velocities.len());
-
-        all_central_distances.push(central_distances_mean);
-        all_velocities.push(mean_velocity);
-        all_peripheral_distances.push(peripheral_distances_mean);
-        //println!("T: {}, V: {}, D: {}", time, mean_velocity, mad_of_distance);
-
-        time += time_step;
-    }
-    let mean_velocity: f64 = all_velocities.iter().sum::<f64>() / all_velocities.len() as f64;
-
-    let mean_central_distance: f64 =
-        rgsl::statistics::mean(&all_central_distances, 1, all_central_distances.len());
-
-    let mad_of_peripheral_distance: f64 =
-        rgsl::statistics::absdev(&all_peripheral_distances, 1, all_peripheral_distances.len());
+fn get_error(summary: &SwarmSummary) -> f64 {
+    let mean_central_distance = summary.mean_central_distance;
+    let mad_of_peripheral_distance = summary.peripheral_distance_mad;
 
     println!("mean central: {mean_central_distance}, c mad: {mad_of_peripheral_distance}");
 
     let p_mad_cost = 400.0 * mad_of_peripheral_distance;
     let central_distance_cost = 400.0 * (TARGET_DISTANCE - mean_central_distance).abs();
-    let velocity_cost = 250.0 * mean_velocity;
+    let velocity_cost = 250.0 * summary.mean_velocity;
 
     p_mad_cost + central_distance_cost + velocity_cost
 }
 
 fn run_analysis(
-    pos_path: &std::path::Path,
+    summary_path: &std::path::Path,
     param_map: &IndexMap<String, f64>,
-    positions_file: &std::path::Path,
 ) -> Result<(), Box<dyn std::error::Error>> {
-    //let start = Instant::now();
-    let positions = String::from_utf8(std::fs::read(&pos_path)?)?;
-    let mut data = SimulationData::parse(&positions)?;
-    let error = get_error(&mut data);
+    let summary: SwarmSummary = serde_json::from_str(&std::fs::read_to_string(summary_path)?)?;
+    let error = get_error(&summary);
     {
         let mut state = STATE.get().unwrap().lock().unwrap();
         for param in state.params.iter_mut() {
@@ -607,20 +552,20 @@ fn run_analysis(
     if error < old_error {
         //If multiple threads get in here we don't really care...
         LOWEST_ERROR.store(error, Ordering::Relaxed);
-        let src = positions_file;
-        let mut dest = PathBuf::from(positions_file);
-        dest.pop(); //Pop positions csv file name
+        let src = summary_path;
+        let mut dest = PathBuf::from(summary_path);
+        dest.pop(); //Pop summary file name
         dest.push("out");
         let _ = std::fs::create_dir_all(&dest);
-        dest.push(format!("{}.csv", error));
+        dest.push(format!("{}.json", error));
         std::fs::copy(src, dest).unwrap();
         println!("  got best error: {} for params: {:?}", error, param_map);
     }
 
-    if let Some(err) = std::fs::remove_file(pos_path).err() {
+    if let Some(err) = std::fs::remove_file(summary_path).err() {
         println!(
-            "failed to delete temp positions file: {} - {}",
-            pos_path.to_str().unwrap(),
+            "failed to delete temp summary file: {} - {}",
+            summary_path.to_str().unwrap(),
             err
         );
     }
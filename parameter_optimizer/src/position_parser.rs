@@ -1,11 +1,17 @@
 use std::collections::{HashMap, HashSet};
-use std::net::IpAddr;
+use std::convert::TryInto;
+use std::net::{IpAddr, Ipv4Addr};
 
 use crate::util;
 
 pub use glam::Vec3A as Vec3;
 pub type UavId = IpAddr;
 
+/// Magic bytes at the start of a binary positions file (see scratch/non-ideal/position-log.h)
+pub const BINARY_MAGIC: &[u8; 8] = b"UAVPOS01";
+const RECORD_POSITIONS: u32 = 0;
+const RECORD_COLOR: u32 = 1;
+
 #[derive(Debug, PartialEq, PartialOrd, Clone, Copy)]
 pub struct TimePoint(pub f32);
 
@@ -120,6 +126,78 @@ impl SimulationData {
             frames.push(TimedObject::new(last_time, std::mem::take(&mut inner_map)));
         }
 
+        Ok(Self::from_parts(frames, events, unique_ids))
+    }
+
+    /// Parses either format written by the simulation, detected by the binary magic bytes
+    pub fn parse_bytes(data: &[u8]) -> Result<Self, Box<dyn std::error::Error>> {
+        if data.starts_with(BINARY_MAGIC) {
+            Self::parse_binary(data)
+        } else {
+            Self::parse(std::str::from_utf8(data)?)
+        }
+    }
+
+    /// Parses the columnar binary format: a node table followed by position and color records
+    pub fn parse_binary(data: &[u8]) -> Result<Self, Box<dyn std::error::Error>> {
+        let mut reader = ByteReader { data };
+        if reader.take(BINARY_MAGIC.len())? != BINARY_MAGIC {
+            return Err("Not a binary positions file".into());
+        }
+        let count = reader.read_u32()? as usize;
+        let mut ids = Vec::with_capacity(count);
+        for _ in 0..count {
+            ids.push(IpAddr::V4(Ipv4Addr::from(reader.read_u32()?)));
+        }
+        let unique_ids: HashSet<UavId> = ids.iter().copied().collect();
+
+        let mut frames = Vec::new();
+        let mut events = Vec::new();
+        while !reader.data.is_empty() {
+            match reader.read_u32()? {
+                RECORD_POSITIONS => {
+                    let time = reader.read_f64()? as f32;
+                    //Columns are laid out as x[count], y[count], z[count]
+                    let columns = reader.take(3 * count * 4)?;
+                    let value = |column: usize, i: usize| {
+                        let start = (column * count + i) * 4;
+                        f32::from_le_bytes(columns[start..start + 4].try_into().unwrap())
+                    };
+                    let mut inner_map = HashMap::with_capacity(count);
+                    for (i, ip) in ids.iter().enumerate() {
+                        inner_map.insert(
+                            *ip,
+                            UavKeyFrame {
+                                ip: *ip,
+                                pos: Vec3::new(value(0, i), value(1, i), value(2, i)),
+                            },
+                        );
+                    }
+                    frames.push(TimedObject::new(time, inner_map));
+                }
+                RECORD_COLOR => {
+                    let time = reader.read_f64()? as f32;
+                    let ip = IpAddr::V4(Ipv4Addr::from(reader.read_u32()?));
+                    let r = reader.read_f32()?;
+                    let g = reader.read_f32()?;
+                    let b = reader.read_f32()?;
+                    events.push(TimedObject::new(
+                        time,
+                        Event::ColorChange((ip, Vec3::new(r, g, b))),
+                    ));
+                }
+                tag => return Err(format!("Unknown record tag {} in positions file", tag).into()),
+            }
+        }
+
+        Ok(Self::from_parts(frames, events, unique_ids))
+    }
+
+    fn from_parts(
+        frames: Vec<TimedObject<HashMap<UavId, UavKeyFrame>>>,
+        events: Vec<TimedObject<Event>>,
+        unique_ids: HashSet<UavId>,
+    ) -> Self {
         //Set the initial state. Because we assume the user starts the simulation at t=0, all the UAV's
         //will be in the before state because we only know their position in the future
         let mut state = HashMap::new();
@@ -135,14 +213,14 @@ impl SimulationData {
             }
         }
         let simulation_length = frames[frames.len() - 1].time.0;
-        Ok(Self {
+        Self {
             frames,
             state,
             events,
             last_time: None,
             simulation_length,
             uavs: unique_ids,
-        })
+        }
     }
 
     /// Returns the position of the specified UAV at the given point in time
@@ -216,6 +294,34 @@ impl SimulationData {
     }
 }
 
+/// Little endian cursor over the bytes of a binary positions file
+struct ByteReader<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> ByteReader<'a> {
+    fn take(&mut self, len: usize) -> Result<&'a [u8], Box<dyn std::error::Error>> {
+        if self.data.len() < len {
+            return Err("Unexpected end of binary positions file".into());
+        }
+        let (head, tail) = self.data.split_at(len);
+        self.data = tail;
+        Ok(head)
+    }
+
+    fn read_u32(&mut self) -> Result<u32, Box<dyn std::error::Error>> {
+        Ok(u32::from_le_bytes(self.take(4)?.try_into()?))
+    }
+
+    fn read_f32(&mut self) -> Result<f32, Box<dyn std::error::Error>> {
+        Ok(f32::from_le_bytes(self.take(4)?.try_into()?))
+    }
+
+    fn read_f64(&mut self) -> Result<f64, Box<dyn std::error::Error>> {
+        Ok(f64::from_le_bytes(self.take(8)?.try_into()?))
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -253,6 +359,46 @@ color,0,10.1.1.1,0.3,0.7,1,
         );
     }
 
+    #[test]
+    fn parse_binary() {
+        let mut bytes = Vec::new();
+        bytes.extend_from_slice(BINARY_MAGIC);
+        bytes.extend_from_slice(&2u32.to_le_bytes());
+        bytes.extend_from_slice(&0x0a01_0101u32.to_le_bytes());
+        bytes.extend_from_slice(&0x0a01_0102u32.to_le_bytes());
+        for (time, x) in &[(0.0f64, 1.0f32), (0.05, 2.0)] {
+            bytes.extend_from_slice(&RECORD_POSITIONS.to_le_bytes());
+            bytes.extend_from_slice(&time.to_le_bytes());
+            // x column, then y, then z
+            for v in &[0.0f32, *x, 0.0, -1.0, 0.0, 3.0] {
+                bytes.extend_from_slice(&v.to_le_bytes());
+            }
+        }
+        bytes.extend_from_slice(&RECORD_COLOR.to_le_bytes());
+        bytes.extend_from_slice(&0.0f64.to_le_bytes());
+        bytes.extend_from_slice(&0x0a01_0101u32.to_le_bytes());
+        for v in &[0.3f32, 0.7, 1.0] {
+            bytes.extend_from_slice(&v.to_le_bytes());
+        }
+
+        let data = SimulationData::parse_bytes(&bytes).unwrap();
+        let second: IpAddr = "10.1.1.2".parse().unwrap();
+
+        assert_eq!(data.frames.len(), 2);
+        assert_eq!(data.frames[1].time, TimePoint(0.05f32));
+        assert_eq!(data.frames[1].inner[&second].pos, Vec3::new(2.0, -1.0, 3.0));
+        assert_eq!(data.uavs.len(), 2);
+        assert_eq!(
+            data.events,
+            vec!(TimedObject::new(
+                0f32,
+                Event::ColorChange(("10.1.1.1".parse().unwrap(), [0.3, 0.7, 1.0].into()))
+            ))
+        );
+
+        assert!(SimulationData::parse_binary(&bytes[..bytes.len() - 2]).is_err());
+    }
+
     macro_rules! assert_approx_eq {
         ($a:expr, $b:expr) => {{
             let eps = 1.0e-5;
@@ -35,6 +35,7 @@ macro_rules! map {
     };
 }
 
+#[cfg(test)]
 fn lerp<T, F>(a: T, b: T, f: F) -> T
 where
     T: Copy,
@@ -46,6 +47,7 @@ where
     a + ((b - a) * f)
 }
 
+#[cfg(test)]
 fn normalize<T, F>(a: T, b: T, value: T) -> F
 where
     T: Copy,
@@ -55,6 +57,8 @@ where
     (value - a) / (b - a)
 }
 
+/// Maps `value` from one range onto another, used to interpolate the logged positions
+#[cfg(test)]
 pub fn map<S, D, F>(left_min: S, left_max: S, value: S, right_min: D, right_max: D) -> D
 where
     S: Copy,
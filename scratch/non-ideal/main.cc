@@ -16,11 +16,24 @@
 * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <atomic>
+#include <cerrno>
 #include <cstdint>
+#include <deque>
 #include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
 #include <memory>
-#include <fstream>
+#include <new>
 #include <random>
+#include <sstream>
+#include <thread>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "ns3/core-module.h"
 #include "ns3/csma-module.h"
@@ -29,7 +42,7 @@
 #include "ns3/mobility-helper.h"
 #include "ns3/mobility-model.h"
 #include "ns3/ptr.h"
-#include "ns3/waypoint-mobility-model.h"
+#include "ns3/constant-acceleration-mobility-model.h"
 #include "ns3/rectangle.h"
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/ipv4-address-helper.h"
@@ -38,6 +51,9 @@
 #include "ns3/attribute-helper.h"
 
 #include "main.h"
+#include "position-log.h"
+#include "swarm-metric.h"
+#include "swarm-table.h"
 #include "uav.h"
 
 using namespace ns3;
@@ -56,58 +72,27 @@ CourseChange (std::string _unused, Ptr<const MobilityModel> mobility)
   */
 }
 
-std::unique_ptr<std::ofstream> s_csvFile;
-
-void
-SetColor (const Ipv4Address &address, Vector color)
+static void
+LogColor (PositionLog *log, Ipv4Address address, Vector color)
 {
-  auto &stream = *s_csvFile;
-  stream << "color,";
-  stream << Simulator::Now ().GetSeconds () << ',';
-
-  address.Print (stream);
-  stream << ',';
-
-  stream << color.x << ',';
-  stream << color.y << ',';
-  stream << color.z << ',';
-  stream << std::endl;
+  log->LogColor (Simulator::Now ().GetSeconds (), address, color);
 }
 
-SimulationParameters s_Parameters;
-
 static void
-LogPositions (const NodeContainer &nodes)
+LogPositions (PositionLog *log)
 {
-  if (!s_csvFile)
-    {
-      s_csvFile.reset (new std::ofstream (s_Parameters.positionsFile));
-      const char header[] = "Time (s),IP Address, X (m), Y (m), Z (m)";
-      s_csvFile->write (header, sizeof (header));
-    }
-
-  auto &stream = *s_csvFile;
-
-  for (uint32_t i = 0; i < nodes.GetN (); i++)
-    {
-      Ptr<Node> node = nodes.Get (i);
-      auto mobility = node->GetObject<ns3::WaypointMobilityModel> (MobilityModel::GetTypeId ());
-      auto uav = node->GetApplication (0);
+  log->LogPositions (Simulator::Now ().GetSeconds ());
 
-      stream << Simulator::Now ().GetSeconds () << ',';
-
-      Ipv4AddressValue addressValue;
-      uav->GetAttribute ("ClientAddress", addressValue);
-      addressValue.Get ().Print (stream);
-      stream << ',';
+  Simulator::Schedule (MilliSeconds (50), &LogPositions, log);
+}
 
-      stream << mobility->GetPosition ().x << ',';
-      stream << mobility->GetPosition ().y << ',';
-      stream << mobility->GetPosition ().z << ',';
-      stream << std::endl;
-    }
+static void
+SampleMetric (SwarmMetric *metric)
+{
+  metric->Sample (Simulator::Now ().GetSeconds ());
 
-  Simulator::Schedule (MilliSeconds (50), &LogPositions, nodes);
+  //Same step the optimizer used when replaying the positions file
+  Simulator::Schedule (MilliSeconds (100), &SampleMetric, metric);
 }
 
 bool
@@ -116,40 +101,91 @@ ShouldDoCyberAttack ()
   return false;
 }
 
-int
-main (int argc, char *argv[])
+static void
+AddParameters (CommandLine &cmd, SimulationParameters &params)
 {
-
-  LogComponentEnable ("UdpClient", LOG_LEVEL_INFO);
-  LogComponentEnable ("UdpServer", LOG_LEVEL_INFO);
-
-  //Parameters
-  CommandLine cmd (__FILE__);
-
-  cmd.AddValue ("a", "Attraction constant between central and peripheral nondes", s_Parameters.a);
-  cmd.AddValue ("r", "Repultion constant between peripheral nodes", s_Parameters.r);
+  cmd.AddValue ("a", "Attraction constant between central and peripheral nondes", params.a);
+  cmd.AddValue ("r", "Repultion constant between peripheral nodes", params.r);
   cmd.AddValue ("seed", "Seed for the random number generator when calculating initial positions",
-                s_Parameters.seed);
-  cmd.AddValue ("pNodes", "The number of peripheral nodes to simulate",
-                s_Parameters.peripheralNodes);
-  cmd.AddValue ("spawnRadius", "How large of a radius to spawn the nodes in",
-                s_Parameters.spawnRadius);
-  cmd.AddValue ("duration", "How long to run the simulation for (seconds)", s_Parameters.duration);
+                params.seed);
+  cmd.AddValue ("pNodes", "The number of peripheral nodes to simulate", params.peripheralNodes);
+  cmd.AddValue ("spawnRadius", "How large of a radius to spawn the nodes in", params.spawnRadius);
+  cmd.AddValue ("duration", "How long to run the simulation for (seconds)", params.duration);
   cmd.AddValue ("packetInterval", "How often UAV's send location packets to one another",
-                s_Parameters.packetInterval);
+                params.packetInterval);
   cmd.AddValue ("calculateInterval", "How often the velocity of each UAV is re calculated",
-                s_Parameters.calculateInterval);
-
+                params.calculateInterval);
+  cmd.AddValue ("lazyCalculate",
+                "Only recalculate velocities when neighbor data changes, following a "
+                "piecewise linear trajectory in between",
+                params.lazyCalculate);
+  cmd.AddValue ("lazyTolerance",
+                "Largest distance in meters the lazy trajectory may be from the per "
+                "calculateInterval trajectory",
+                params.lazyTolerance);
+  cmd.AddValue ("targetDistance", "Desired distance between central and peripheral nodes",
+                params.targetDistance);
+  cmd.AddValue ("disseminationMode",
+                "How uavs send their position to each other: unicast, broadcast or multicast",
+                params.disseminationMode);
+  cmd.AddValue ("radioRange",
+                "Uavs further apart than this (m) can not hear each other, 0 for unlimited. "
+                "The channel also skips them without computing their propagation loss",
+                params.radioRange);
+  cmd.AddValue ("neighborTimeout",
+                "Seconds after which uavs forget a uav they have not heard from, 0 to never forget",
+                params.neighborTimeout);
+
+  cmd.AddValue ("logPositions", "Write uav positions to positionsFile during the simulation",
+                params.logPositions);
   cmd.AddValue ("positionsFile", "Where to write uav positions to during the simulation",
-                s_Parameters.positionsFile);
-  cmd.Parse (argc, argv);
+                params.positionsFile);
+  cmd.AddValue ("positionsFormat", "Format of the positions file: csv or binary",
+                params.positionsFormat);
+  cmd.AddValue ("pcap", "Write a pcap trace for every node", params.pcap);
+  cmd.AddValue ("summaryFile",
+                "Where to write the swarm stability statistics as JSON at the end of the run",
+                params.summaryFile);
+}
+
+//Time the peripheral uavs start, before which the attraction and repulsion constants
+//have no effect
+static const double PERIPHERAL_START = 1.0;
+
+/// The state of a simulation built by BuildSimulation that outlives the build
+struct Simulation
+{
+  NodeContainer nodes;
+  ApplicationContainer uavs;
+  std::unique_ptr<PositionLog> positionLog;
+  SwarmMetric metric;
+};
+
+/**
+ * Builds the topology and applications of one simulation in \p sim and schedules its
+ * end, without running it.
+ */
+static void
+BuildSimulation (const SimulationParameters &params, Simulation &sim)
+{
+  PositionLog::Format positionsFormat;
+  if (!PositionLog::ParseFormat (params.positionsFormat, positionsFormat))
+    {
+      NS_FATAL_ERROR ("Unknown positions format: " << params.positionsFormat);
+    }
+
+  //Start from the same global state as a fresh process so every trial is reproducible
+  //regardless of what ran before it
+  RngSeedManager::ResetNextStreamIndex ();
+  Mac48Address::ResetAllocationIndex ();
+  Ipv4AddressGenerator::Reset ();
 
   //
   // Explicitly create the nodes required by the topology (shown above).
   //
   NS_LOG_INFO ("Create nodes.");
-  NodeContainer nodes;
-  nodes.Create (1 + s_Parameters.peripheralNodes);
+  NodeContainer &nodes = sim.nodes;
+  nodes.Create (1 + params.peripheralNodes);
 
   NS_LOG_INFO ("Create channels.");
 
@@ -177,7 +213,16 @@ main (int argc, char *argv[])
   // The below FixedRssLossModel will cause the rss to be fixed regardless
   // of the distance between the two stations, and the transmit power
   wifiChannel.AddPropagationLoss ("ns3::FixedRssLossModel", "Rss", DoubleValue (rss));
-  wifiPhy.SetChannel (wifiChannel.Create ());
+  if (params.radioRange > 0)
+    {
+      // Out of range uavs receive nothing
+      wifiChannel.AddPropagationLoss ("ns3::RangePropagationLossModel", "MaxRange",
+                                      DoubleValue (params.radioRange));
+    }
+  Ptr<YansWifiChannel> channel = wifiChannel.Create ();
+  // Only saves computing the loss of the receivers the range model silences
+  channel->SetAttribute ("MaxRange", DoubleValue (params.radioRange));
+  wifiPhy.SetChannel (channel);
 
   // Add a mac and disable rate control
   WifiMacHelper wifiMac;
@@ -202,16 +247,29 @@ main (int argc, char *argv[])
   uint16_t port = 4000;
 
   UAVHelper central (serverAddress, port, UAVDataType::VIRTUAL_FORCES_CENTRAL_POSITION,
-                     Seconds (s_Parameters.packetInterval),
-                     Seconds (s_Parameters.calculateInterval), 1 + s_Parameters.peripheralNodes);
+                     Seconds (params.packetInterval),
+                     Seconds (params.calculateInterval), 1 + params.peripheralNodes);
+  central.SetAttribute ("Attraction", DoubleValue (params.a));
+  central.SetAttribute ("Repulsion", DoubleValue (params.r));
+  central.SetAttribute ("DisseminationMode", StringValue (params.disseminationMode));
+  central.SetAttribute ("LazyCalculate", BooleanValue (params.lazyCalculate));
+  central.SetAttribute ("LazyTolerance", DoubleValue (params.lazyTolerance));
+  central.SetAttribute ("NeighborTimeout", TimeValue (Seconds (params.neighborTimeout)));
 
   ApplicationContainer apps = central.Install (nodes.Get (0));
   apps.Get (0)->SetAttribute ("ClientAddress", Ipv4AddressValue (serverAddress));
   apps.Start (Seconds (0.0));
+  sim.uavs.Add (apps);
 
   UAVHelper client (serverAddress, port, UAVDataType::VIRTUAL_FORCES_POSITION,
-                    Seconds (s_Parameters.packetInterval), Seconds (s_Parameters.calculateInterval),
-                    1 + s_Parameters.peripheralNodes);
+                    Seconds (params.packetInterval), Seconds (params.calculateInterval),
+                    1 + params.peripheralNodes);
+  client.SetAttribute ("Attraction", DoubleValue (params.a));
+  client.SetAttribute ("Repulsion", DoubleValue (params.r));
+  client.SetAttribute ("DisseminationMode", StringValue (params.disseminationMode));
+  client.SetAttribute ("LazyCalculate", BooleanValue (params.lazyCalculate));
+  client.SetAttribute ("LazyTolerance", DoubleValue (params.lazyTolerance));
+  client.SetAttribute ("NeighborTimeout", TimeValue (Seconds (params.neighborTimeout)));
 #if 0
     uint32_t startCount = 2;
 #else
@@ -226,7 +284,8 @@ main (int argc, char *argv[])
                                   Ipv4AddressValue (assignedAddresses.GetAddress (i)));
       apps.Get (0)->SetAttribute ("LocalAddress",
                                   Ipv4AddressValue (assignedAddresses.GetAddress (i)));
-      apps.Start (Seconds (1.0));
+      apps.Start (Seconds (PERIPHERAL_START));
+      sim.uavs.Add (apps);
     }
 
   MobilityHelper mobility;
@@ -234,15 +293,15 @@ main (int argc, char *argv[])
   Ptr<ListPositionAllocator> alloc = CreateObject<ListPositionAllocator> ();
   //For central node
   alloc->Add (Vector (0, 0, 0));
-  std::default_random_engine rng (s_Parameters.seed);
+  std::default_random_engine rng (params.seed);
   //std::default_random_engine rng(std::random_device{}());
-  std::uniform_real_distribution<double> dist (-s_Parameters.spawnRadius, s_Parameters.spawnRadius);
+  std::uniform_real_distribution<double> dist (-params.spawnRadius, params.spawnRadius);
 
   uint32_t count = 0;
-  while (count < s_Parameters.peripheralNodes)
+  while (count < params.peripheralNodes)
     {
       Vector pos = {dist (rng), dist (rng), dist (rng)};
-      if (pos.GetLength () < s_Parameters.spawnRadius)
+      if (pos.GetLength () < params.spawnRadius)
         {
           alloc->Add (pos);
           count++;
@@ -251,28 +310,512 @@ main (int argc, char *argv[])
 
   mobility.SetPositionAllocator (alloc);
 
-  mobility.SetMobilityModel ("ns3::WaypointMobilityModel", "InitialPositionIsWaypoint",
-                             BooleanValue (true));
+  //UAV::Calculate starts a new trajectory segment at every step, which schedules no events
+  mobility.SetMobilityModel ("ns3::ConstantAccelerationMobilityModel");
 
   mobility.Install (nodes);
   Config::Connect ("/NodeList/*/$ns3::MobilityModel/CourseChange", MakeCallback (&CourseChange));
 
   // Now, do the actual simulation.
-  NS_LOG_INFO ("Running simulation for " << s_Parameters.duration << " seconds...");
-  Simulator::Stop (Seconds (s_Parameters.duration));
+  NS_LOG_INFO ("Running simulation for " << params.duration << " seconds...");
+  Simulator::Stop (Seconds (params.duration));
 
-  AsciiTraceHelper ascii;
-  wifiPhy.EnablePcap ("UAV", nodes);
+  if (params.pcap)
+    {
+      wifiPhy.EnablePcap ("UAV", nodes);
+    }
 
-  Simulator::Schedule (Seconds (0), &LogPositions, nodes);
+  std::unique_ptr<PositionLog> &positionLog = sim.positionLog;
+  if (params.logPositions)
+    {
+      positionLog.reset (new PositionLog (params.positionsFile, positionsFormat));
+      for (uint32_t i = 0; i < nodes.GetN (); i++)
+        {
+          positionLog->AddNode (nodes.Get (i)->GetObject<MobilityModel> (),
+                                assignedAddresses.GetAddress (i));
+          for (uint32_t j = 0; j < nodes.Get (i)->GetNApplications (); j++)
+            {
+              nodes.Get (i)->GetApplication (j)->TraceConnectWithoutContext (
+                  "ColorChange", MakeBoundCallback (&LogColor, positionLog.get ()));
+            }
+        }
+      Simulator::Schedule (Seconds (0), &LogPositions, positionLog.get ());
+    }
 
-  Simulator::Run ();
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      sim.metric.AddNode (nodes.Get (i)->GetObject<MobilityModel> (), i == 0);
+    }
+  Simulator::Schedule (Seconds (0), &SampleMetric, &sim.metric);
+}
+
+/**
+ * Tears down the simulation \p sim after it ran and returns its swarm statistics, so
+ * another simulation can follow in the same process.
+ */
+static SwarmMetric::Summary
+FinishSimulation (const SimulationParameters &params, Simulation &sim)
+{
   NS_LOG_INFO ("Run Finished.");
 
   Simulator::Destroy ();
   NS_LOG_INFO ("Done.");
 
   //Save file
-  s_csvFile->flush ();
-  s_csvFile.reset (nullptr);
+  if (sim.positionLog)
+    {
+      sim.positionLog->Flush ();
+    }
+
+  SwarmMetric::Summary summary = sim.metric.GetSummary (params.targetDistance);
+  if (!params.summaryFile.empty ())
+    {
+      std::ofstream summaryFile (params.summaryFile);
+      if (!summaryFile)
+        {
+          NS_FATAL_ERROR ("Failed to open summary file " << params.summaryFile);
+        }
+      SwarmMetric::PrintJson (summaryFile, summary);
+    }
+  return summary;
+}
+
+/**
+ * Runs one complete simulation and tears it down again so another one can follow
+ * in the same process.
+ */
+static SwarmMetric::Summary
+RunSimulation (const SimulationParameters &params)
+{
+  Simulation sim;
+  BuildSimulation (params, sim);
+  Simulator::Run ();
+  return FinishSimulation (params, sim);
+}
+
+/**
+ * Parses one line of a batch file into \p params.
+ * \return false for blank lines and lines starting with '#'
+ */
+static bool
+ParseTrial (const std::string &line, SimulationParameters &params)
+{
+  std::istringstream tokens (line);
+  std::vector<std::string> args = {"non-ideal"};
+  std::string token;
+  while (tokens >> token)
+    {
+      args.push_back (token);
+    }
+  if (args.size () == 1 || args[1][0] == '#')
+    {
+      return false;
+    }
+
+  CommandLine cmd;
+  AddParameters (cmd, params);
+  cmd.Parse (args);
+  return true;
+}
+
+static void
+WriteResultHeader (std::ostream &output)
+{
+  output << "trial,a,r,seed,pNodes,error,meanCentralDistance,peripheralDistanceMad,meanVelocity"
+         << std::endl;
+}
+
+/// Formats one result row, without the trailing newline, exactly enough to round trip
+static std::string
+FormatResult (uint32_t trial, const SimulationParameters &params,
+              const SwarmMetric::Summary &summary)
+{
+  std::ostringstream row;
+  row << std::setprecision (std::numeric_limits<double>::max_digits10);
+  row << trial << ',' << params.a << ',' << params.r << ',' << params.seed << ','
+      << params.peripheralNodes << ',' << summary.error << ',' << summary.meanCentralDistance
+      << ',' << summary.peripheralDistanceMad << ',' << summary.meanVelocity;
+  return row.str ();
+}
+
+/**
+ * Runs one simulation per line of \p input and writes one result row per trial to
+ * \p output as soon as it finishes. Each line holds command line options (for example
+ * `--a=0.3 --r=1.2 --seed=4`) applied on top of \p base.
+ */
+static void
+RunBatch (std::istream &input, std::ostream &output, const SimulationParameters &base)
+{
+  WriteResultHeader (output);
+
+  uint32_t trial = 0;
+  std::string line;
+  while (std::getline (input, line))
+    {
+      SimulationParameters params = base;
+      if (!ParseTrial (line, params))
+        {
+          continue;
+        }
+      output << FormatResult (trial, params, RunSimulation (params)) << std::endl;
+      trial++;
+    }
+}
+
+/// Reads the trials of every line of \p input, applied on top of \p base
+static std::vector<SimulationParameters>
+ReadTrials (std::istream &input, const SimulationParameters &base)
+{
+  std::vector<SimulationParameters> trials;
+  std::string line;
+  while (std::getline (input, line))
+    {
+      SimulationParameters params = base;
+      if (ParseTrial (line, params))
+        {
+          trials.push_back (params);
+        }
+    }
+  return trials;
+}
+
+/**
+ * Runs every trial of \p input on \p jobs worker processes and writes the result rows
+ * to \p output in input order.
+ *
+ * The ns-3 simulator, node list and packet allocators are process wide singletons, so
+ * each worker is a process forked after the module registry has been built. Workers
+ * share the registry copy on write and only pay for their own simulation state. Every
+ * trial resets the global counters in RunSimulation, so the rows are identical to the
+ * ones RunBatch produces for the same input.
+ */
+static void
+RunBatchParallel (std::istream &input, std::ostream &output, const SimulationParameters &base,
+                  uint32_t jobs)
+{
+  std::vector<SimulationParameters> trials = ReadTrials (input, base);
+
+  WriteResultHeader (output);
+  if (trials.empty ())
+    {
+      return;
+    }
+  jobs = std::min<uint32_t> (jobs, trials.size ());
+
+  //Trials are handed out through a counter shared by all workers so that workers
+  //which draw short trials pick up more of them
+  void *shared = mmap (nullptr, sizeof (std::atomic<uint32_t>), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  NS_ABORT_MSG_IF (shared == MAP_FAILED, "Failed to map the shared trial counter");
+  std::atomic<uint32_t> *nextTrial = new (shared) std::atomic<uint32_t> (0);
+
+  int results[2];
+  NS_ABORT_MSG_IF (pipe (results) != 0, "Failed to create the result pipe");
+
+  output.flush ();
+  std::vector<pid_t> workers;
+  for (uint32_t i = 0; i < jobs; i++)
+    {
+      pid_t pid = fork ();
+      NS_ABORT_MSG_IF (pid < 0, "Failed to fork batch worker");
+      if (pid == 0)
+        {
+          close (results[0]);
+          uint32_t trial;
+          while ((trial = nextTrial->fetch_add (1)) < trials.size ())
+            {
+              std::string row =
+                  FormatResult (trial, trials[trial], RunSimulation (trials[trial])) + '\n';
+              //Rows are shorter than PIPE_BUF, so rows from different workers never interleave
+              NS_ABORT_MSG_IF (write (results[1], row.data (), row.size ()) !=
+                                   static_cast<ssize_t> (row.size ()),
+                               "Failed to write batch result");
+            }
+          close (results[1]);
+          _exit (0);
+        }
+      workers.push_back (pid);
+    }
+  close (results[1]);
+
+  //Rows arrive in completion order, hold them back until all earlier trials are written
+  std::map<uint32_t, std::string> pending;
+  uint32_t nextOutput = 0;
+  std::string buffer;
+  char chunk[4096];
+  ssize_t count;
+  while ((count = read (results[0], chunk, sizeof (chunk))) != 0)
+    {
+      if (count < 0)
+        {
+          NS_ABORT_MSG_UNLESS (errno == EINTR, "Failed to read batch results");
+          continue;
+        }
+      buffer.append (chunk, count);
+      size_t end;
+      while ((end = buffer.find ('\n')) != std::string::npos)
+        {
+          std::string row = buffer.substr (0, end);
+          buffer.erase (0, end + 1);
+          pending[std::stoul (row)] = row;
+        }
+      for (auto it = pending.begin (); it != pending.end () && it->first == nextOutput;
+           it = pending.erase (it))
+        {
+          output << it->second << std::endl;
+          nextOutput++;
+        }
+    }
+  close (results[0]);
+
+  for (pid_t pid : workers)
+    {
+      int status;
+      waitpid (pid, &status, 0);
+      NS_ABORT_MSG_UNLESS (WIFEXITED (status) && WEXITSTATUS (status) == 0,
+                           "Batch worker " << pid << " failed");
+    }
+  munmap (shared, sizeof (std::atomic<uint32_t>));
+  NS_ABORT_MSG_UNLESS (nextOutput == trials.size (), "Missing batch results");
+}
+
+/**
+ * Returns everything that shapes a simulation before the peripheral uavs start. Trials
+ * with the same key only differ in the attraction and repulsion constants, which are
+ * first used at PERIPHERAL_START, and in how their result is summarized. Trials which
+ * log positions or write pcap traces have no key, see RunBatchWarm.
+ */
+static std::string
+WarmStartKey (const SimulationParameters &params)
+{
+  std::ostringstream key;
+  key << std::setprecision (std::numeric_limits<double>::max_digits10);
+  key << params.seed << ' ' << params.peripheralNodes << ' ' << params.spawnRadius << ' '
+      << params.duration << ' ' << params.packetInterval << ' ' << params.calculateInterval
+      << ' ' << params.lazyCalculate << ' ' << params.lazyTolerance << ' '
+      << params.disseminationMode << ' ' << params.radioRange << ' ' << params.neighborTimeout;
+  return key.str ();
+}
+
+/**
+ * Runs \p trial in a forked copy of the current process and returns the pipe its result
+ * row arrives on. The copy starts from whatever simulation state the process holds.
+ */
+static int
+ForkTrial (uint32_t trial, const SimulationParameters &params, Simulation *warm, pid_t &pid)
+{
+  int result[2];
+  NS_ABORT_MSG_IF (pipe (result) != 0, "Failed to create the result pipe");
+  pid = fork ();
+  NS_ABORT_MSG_IF (pid < 0, "Failed to fork trial");
+  if (pid == 0)
+    {
+      close (result[0]);
+      SwarmMetric::Summary summary;
+      if (warm)
+        {
+          for (uint32_t i = 0; i < warm->uavs.GetN (); i++)
+            {
+              warm->uavs.Get (i)->SetAttribute ("Attraction", DoubleValue (params.a));
+              warm->uavs.Get (i)->SetAttribute ("Repulsion", DoubleValue (params.r));
+            }
+          Simulator::Run ();
+          summary = FinishSimulation (params, *warm);
+        }
+      else
+        {
+          summary = RunSimulation (params);
+        }
+      std::string row = FormatResult (trial, params, summary) + '\n';
+      NS_ABORT_MSG_IF (write (result[1], row.data (), row.size ()) !=
+                           static_cast<ssize_t> (row.size ()),
+                       "Failed to write trial result");
+      close (result[1]);
+      _exit (0);
+    }
+  close (result[1]);
+  return result[0];
+}
+
+/// Reads the result row of the trial forked by ForkTrial and waits for it to exit
+static std::string
+ReadTrial (int fd, pid_t pid)
+{
+  std::string row;
+  char chunk[4096];
+  ssize_t count;
+  while ((count = read (fd, chunk, sizeof (chunk))) != 0)
+    {
+      if (count < 0)
+        {
+          NS_ABORT_MSG_UNLESS (errno == EINTR, "Failed to read trial result");
+          continue;
+        }
+      row.append (chunk, count);
+    }
+  close (fd);
+  int status;
+  waitpid (pid, &status, 0);
+  NS_ABORT_MSG_UNLESS (WIFEXITED (status) && WEXITSTATUS (status) == 0 && !row.empty (),
+                       "Trial process " << pid << " failed");
+  row.pop_back ();
+  return row;
+}
+
+/**
+ * Runs every trial of \p input and writes the result rows to \p output in input order,
+ * like RunBatch, but simulates the startup shared by trials with the same WarmStartKey
+ * only once.
+ *
+ * ns-3 events are closures over live objects, so the simulator state can not be saved to
+ * a file and loaded by another run. The warm state is instead the state of this process
+ * when it stops at PERIPHERAL_START: each trial of the group continues it in a forked
+ * copy, with its own attraction and repulsion constants, up to \p jobs at a time. The
+ * copy on write process image holds the scheduler queue, every object with its
+ * attributes and the random stream positions exactly, so the rows are identical to the
+ * ones RunBatch produces for the same input.
+ *
+ * Trials which log positions or write pcap traces run cold, each in its own group: the
+ * copies of a warm state would share the files it opened and write into them together.
+ */
+static void
+RunBatchWarm (std::istream &input, std::ostream &output, const SimulationParameters &base,
+              uint32_t jobs)
+{
+  std::vector<SimulationParameters> trials = ReadTrials (input, base);
+
+  WriteResultHeader (output);
+  std::vector<std::vector<uint32_t>> groups;
+  std::map<std::string, size_t> groupIndex;
+  for (uint32_t trial = 0; trial < trials.size (); trial++)
+    {
+      if (trials[trial].logPositions || trials[trial].pcap)
+        {
+          groups.emplace_back (1, trial);
+          continue;
+        }
+      auto it = groupIndex.insert (std::make_pair (WarmStartKey (trials[trial]), groups.size ()));
+      if (it.second)
+        {
+          groups.emplace_back ();
+        }
+      groups[it.first->second].push_back (trial);
+    }
+
+  std::vector<std::string> rows (trials.size ());
+  uint32_t nextOutput = 0;
+  for (const std::vector<uint32_t> &group : groups)
+    {
+      const SimulationParameters &first = trials[group[0]];
+      //Trials ending before the peripheral uavs start have nothing to share
+      std::unique_ptr<Simulation> warm;
+      if (group.size () > 1 && first.duration > PERIPHERAL_START)
+        {
+          warm.reset (new Simulation ());
+          BuildSimulation (first, *warm);
+          Simulator::Stop (Seconds (PERIPHERAL_START));
+          Simulator::Run ();
+        }
+
+      output.flush ();
+      std::deque<std::pair<uint32_t, std::pair<int, pid_t>>> running;
+      for (size_t i = 0; i < group.size () || !running.empty ();)
+        {
+          if (i < group.size () && running.size () < jobs)
+            {
+              uint32_t trial = group[i++];
+              pid_t pid;
+              int fd = ForkTrial (trial, trials[trial], warm.get (), pid);
+              running.push_back (std::make_pair (trial, std::make_pair (fd, pid)));
+              continue;
+            }
+          rows[running.front ().first] =
+              ReadTrial (running.front ().second.first, running.front ().second.second);
+          running.pop_front ();
+        }
+
+      if (warm)
+        {
+          Simulator::Destroy ();
+        }
+      for (; nextOutput < rows.size () && !rows[nextOutput].empty (); nextOutput++)
+        {
+          output << rows[nextOutput] << std::endl;
+        }
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+
+  LogComponentEnable ("UdpClient", LOG_LEVEL_INFO);
+  LogComponentEnable ("UdpServer", LOG_LEVEL_INFO);
+
+  //Parameters
+  CommandLine cmd (__FILE__);
+  SimulationParameters params;
+  AddParameters (cmd, params);
+
+  std::string batchFile;
+  uint32_t jobs = 1;
+  cmd.AddValue ("batch",
+                "Run one trial per line of this file (- for stdin) and print one result row "
+                "per trial. Trials do not log positions or pcap unless their line asks for it",
+                batchFile);
+  cmd.AddValue ("jobs", "Number of batch trials to run concurrently. 0 uses every core", jobs);
+  bool warmStart = false;
+  cmd.AddValue ("warmStart",
+                "Simulate the startup of batch trials which only differ in a and r once, "
+                "and branch every trial from that state when the peripheral uavs start",
+                warmStart);
+  bool checkForces = false;
+  cmd.AddValue ("checkForces",
+                "Check the SIMD virtual force implementations against the scalar math and exit",
+                checkForces);
+  cmd.Parse (argc, argv);
+
+  if (checkForces)
+    {
+      return SwarmTable::SelfTest (std::cout) ? 0 : 1;
+    }
+
+  if (batchFile.empty ())
+    {
+      SwarmMetric::Summary summary = RunSimulation (params);
+      NS_LOG_INFO ("Swarm error: " << summary.error);
+      return 0;
+    }
+
+  params.logPositions = false;
+  params.pcap = false;
+  if (jobs == 0)
+    {
+      jobs = std::max (1u, std::thread::hardware_concurrency ());
+    }
+
+  std::ifstream file;
+  if (batchFile != "-")
+    {
+      file.open (batchFile);
+      if (!file)
+        {
+          NS_FATAL_ERROR ("Failed to open batch file " << batchFile);
+        }
+    }
+  std::istream &input = batchFile == "-" ? std::cin : file;
+
+  if (warmStart)
+    {
+      RunBatchWarm (input, std::cout, params, jobs);
+    }
+  else if (jobs == 1)
+    {
+      RunBatch (input, std::cout, params);
+    }
+  else
+    {
+      RunBatchParallel (input, std::cout, params, jobs);
+    }
+  return 0;
 }
@@ -3,8 +3,6 @@
 #include <ns3/vector.h>
 #include <ns3/ipv4-address.h>
 
-void SetColor(const ns3::Ipv4Address& address, ns3::Vector color);
-
 bool ShouldDoCyberAttack();
 
 struct SimulationParameters
@@ -18,8 +16,16 @@ struct SimulationParameters
   double duration = 180;
   double packetInterval = 1.5;
   double calculateInterval = 0.01;
+  bool lazyCalculate = false;
+  double lazyTolerance = 0.01;
+  double targetDistance = 7.5;
+  std::string disseminationMode = "unicast";
+  double radioRange = 0;
+  double neighborTimeout = 0;
+  bool logPositions = true;
   std::string positionsFile = "positions.csv";
+  std::string positionsFormat = "csv";
+  bool pcap = true;
+  std::string summaryFile = "";
 };
 
-extern SimulationParameters s_Parameters;
-
@@ -0,0 +1,137 @@
+#include "position-log.h"
+
+#include "ns3/abort.h"
+
+using namespace ns3;
+
+const char PositionLog::BINARY_MAGIC[8] = {'U', 'A', 'V', 'P', 'O', 'S', '0', '1'};
+constexpr uint32_t PositionLog::RECORD_POSITIONS;
+constexpr uint32_t PositionLog::RECORD_COLOR;
+
+bool
+PositionLog::ParseFormat (const std::string &name, Format &format)
+{
+  if (name == "csv")
+    {
+      format = CSV;
+      return true;
+    }
+  if (name == "binary")
+    {
+      format = BINARY;
+      return true;
+    }
+  return false;
+}
+
+PositionLog::PositionLog (const std::string &path, Format format)
+    : m_format (format), m_streamBuffer (1 << 20)
+{
+  //The buffer must be installed before the file is opened to take effect
+  m_stream.rdbuf ()->pubsetbuf (m_streamBuffer.data (), m_streamBuffer.size ());
+  m_stream.open (path, format == BINARY ? std::ios::out | std::ios::binary : std::ios::out);
+  NS_ABORT_MSG_UNLESS (m_stream.is_open (), "Failed to open positions file " << path);
+}
+
+PositionLog::~PositionLog ()
+{
+  Flush ();
+}
+
+void
+PositionLog::AddNode (Ptr<MobilityModel> mobility, Ipv4Address address)
+{
+  NS_ABORT_MSG_IF (m_headerWritten, "Nodes must be added before the first sample is logged");
+  m_mobility.push_back (mobility);
+  m_addresses.push_back (address);
+}
+
+void
+PositionLog::WriteHeader ()
+{
+  if (m_headerWritten)
+    {
+      return;
+    }
+  m_headerWritten = true;
+
+  if (m_format == CSV)
+    {
+      m_stream << "Time (s),IP Address, X (m), Y (m), Z (m)\n";
+      return;
+    }
+
+  m_stream.write (BINARY_MAGIC, sizeof (BINARY_MAGIC));
+  Write (static_cast<uint32_t> (m_addresses.size ()));
+  for (const auto &address : m_addresses)
+    {
+      Write (address.Get ());
+    }
+  m_columns.resize (3 * m_addresses.size ());
+}
+
+void
+PositionLog::LogPositions (double time)
+{
+  WriteHeader ();
+
+  if (m_format == CSV)
+    {
+      for (uint32_t i = 0; i < m_mobility.size (); i++)
+        {
+          Vector position = m_mobility[i]->GetPosition ();
+          m_stream << time << ',';
+          m_addresses[i].Print (m_stream);
+          m_stream << ',' << position.x << ',' << position.y << ',' << position.z << ",\n";
+        }
+      return;
+    }
+
+  const size_t count = m_mobility.size ();
+  for (size_t i = 0; i < count; i++)
+    {
+      Vector position = m_mobility[i]->GetPosition ();
+      m_columns[i] = position.x;
+      m_columns[count + i] = position.y;
+      m_columns[2 * count + i] = position.z;
+    }
+  Write (RECORD_POSITIONS);
+  Write (time);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  for (float column : m_columns)
+    {
+      Write (column);
+    }
+#else
+  //The columns are already little endian, so they are written as one block
+  m_stream.write (reinterpret_cast<const char *> (m_columns.data ()),
+                  m_columns.size () * sizeof (float));
+#endif
+}
+
+void
+PositionLog::LogColor (double time, const Ipv4Address &address, const Vector &color)
+{
+  WriteHeader ();
+
+  if (m_format == CSV)
+    {
+      m_stream << "color," << time << ',';
+      address.Print (m_stream);
+      m_stream << ',' << color.x << ',' << color.y << ',' << color.z << ",\n";
+      return;
+    }
+
+  Write (RECORD_COLOR);
+  Write (time);
+  Write (address.Get ());
+  Write (static_cast<float> (color.x));
+  Write (static_cast<float> (color.y));
+  Write (static_cast<float> (color.z));
+}
+
+void
+PositionLog::Flush ()
+{
+  m_stream.flush ();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ns3/ipv4-address.h"
+#include "ns3/mobility-model.h"
+#include "ns3/ptr.h"
+#include "ns3/vector.h"
+
+/**
+ * \brief Buffered writer for the UAV positions file.
+ *
+ * Two layouts are supported:
+ *
+ * CSV (the original format, one row per node per sample):
+ * \verbatim
+   Time (s),IP Address, X (m), Y (m), Z (m)
+   <time>,<ip>,<x>,<y>,<z>,
+   color,<time>,<ip>,<r>,<g>,<b>,
+   \endverbatim
+ *
+ * Binary (columnar, all values little endian):
+ * \verbatim
+   header:   char[8] magic "UAVPOS01", uint32 nodeCount, uint32 address[nodeCount]
+   record:   uint32 tag, followed by the record body
+     tag 0 (positions): float64 time, float32 x[nodeCount], float32 y[nodeCount],
+                        float32 z[nodeCount]
+     tag 1 (color):     float64 time, uint32 address, float32 r, float32 g, float32 b
+   \endverbatim
+ * Addresses are stored as the host order value returned by Ipv4Address::Get ().
+ * The column order of each positions record matches the node table in the header.
+ */
+class PositionLog
+{
+public:
+  enum Format { CSV, BINARY };
+
+  static const char BINARY_MAGIC[8];
+  static constexpr uint32_t RECORD_POSITIONS = 0;
+  static constexpr uint32_t RECORD_COLOR = 1;
+
+  /**
+   * \brief Parse a format name as given on the command line
+   * \param name either "csv" or "binary"
+   * \param format set to the parsed format on success
+   * \return true if the name was recognized
+   */
+  static bool ParseFormat (const std::string &name, Format &format);
+
+  PositionLog (const std::string &path, Format format);
+  ~PositionLog ();
+
+  /**
+   * \brief Add a node to the node table. All nodes must be added before the first sample
+   * \param mobility the mobility model sampled by LogPositions
+   * \param address the address the node is reported under
+   */
+  void AddNode (ns3::Ptr<ns3::MobilityModel> mobility, ns3::Ipv4Address address);
+
+  /// Write the current position of every node in the node table
+  void LogPositions (double time);
+
+  /// Write a color change event for the node with the given address
+  void LogColor (double time, const ns3::Ipv4Address &address, const ns3::Vector &color);
+
+  /// Write all buffered data to disk
+  void Flush ();
+
+private:
+  void WriteHeader ();
+
+  /// Write \p value in little endian byte order, whatever the byte order of the host
+  template <typename T>
+  void
+  Write (const T &value)
+  {
+    char bytes[sizeof (T)];
+    std::memcpy (bytes, &value, sizeof (T));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    std::reverse (bytes, bytes + sizeof (T));
+#endif
+    m_stream.write (bytes, sizeof (T));
+  }
+
+  Format m_format;
+  /// Backing storage for m_stream so rows are written to disk in large chunks
+  std::vector<char> m_streamBuffer;
+  std::ofstream m_stream;
+  bool m_headerWritten = false;
+
+  std::vector<ns3::Ptr<ns3::MobilityModel>> m_mobility;
+  std::vector<ns3::Ipv4Address> m_addresses;
+
+  /// Scratch space for one positions record in the binary format
+  std::vector<float> m_columns;
+};
@@ -0,0 +1,123 @@
+#include "swarm-metric.h"
+
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+#include "ns3/abort.h"
+
+using namespace ns3;
+
+void
+SwarmMetric::AddNode (Ptr<MobilityModel> mobility, bool central)
+{
+  NS_ABORT_MSG_UNLESS (m_peripheralDistances.empty (),
+                       "Nodes must be added before the first sample is taken");
+  if (central)
+    {
+      m_central = m_mobility.size ();
+    }
+  m_mobility.push_back (mobility);
+}
+
+void
+SwarmMetric::Sample (double time)
+{
+  const uint32_t count = m_mobility.size ();
+  m_positions.resize (count);
+  for (uint32_t i = 0; i < count; i++)
+    {
+      m_positions[i] = m_mobility[i]->GetPosition ();
+    }
+
+  //Means of empty sets are zero, matching gsl_stats_mean used by the optimizer
+  double centralDistance = 0;
+  double peripheralDistance = 0;
+  uint32_t peripheralPairs = 0;
+  for (uint32_t i = 0; i < count; i++)
+    {
+      if (i == m_central)
+        {
+          continue;
+        }
+      centralDistance += CalculateDistance (m_positions[i], m_positions[m_central]);
+      for (uint32_t j = i + 1; j < count; j++)
+        {
+          if (j != m_central)
+            {
+              peripheralDistance += CalculateDistance (m_positions[i], m_positions[j]);
+              peripheralPairs++;
+            }
+        }
+    }
+  if (count > 1)
+    {
+      centralDistance /= count - 1;
+    }
+  if (peripheralPairs > 0)
+    {
+      peripheralDistance /= peripheralPairs;
+    }
+
+  double velocity = 0;
+  if (!m_lastPositions.empty ())
+    {
+      double dt = time - m_lastTime;
+      for (uint32_t i = 0; i < count; i++)
+        {
+          velocity += CalculateDistance (m_positions[i], m_lastPositions[i]) / dt;
+        }
+      velocity /= count;
+    }
+
+  m_centralDistanceSum += centralDistance;
+  m_velocitySum += velocity;
+  m_peripheralDistances.push_back (peripheralDistance);
+
+  m_lastPositions.swap (m_positions);
+  m_lastTime = time;
+}
+
+SwarmMetric::Summary
+SwarmMetric::GetSummary (double targetDistance) const
+{
+  Summary summary;
+  summary.samples = m_peripheralDistances.size ();
+  if (summary.samples == 0)
+    {
+      return summary;
+    }
+
+  summary.meanCentralDistance = m_centralDistanceSum / summary.samples;
+  summary.meanVelocity = m_velocitySum / summary.samples;
+
+  double peripheralMean = 0;
+  for (double distance : m_peripheralDistances)
+    {
+      peripheralMean += distance;
+    }
+  peripheralMean /= summary.samples;
+  for (double distance : m_peripheralDistances)
+    {
+      summary.peripheralDistanceMad += std::abs (distance - peripheralMean);
+    }
+  summary.peripheralDistanceMad /= summary.samples;
+
+  //Same weights as get_error in parameter_optimizer/src/optimization.rs
+  summary.error = 400.0 * summary.peripheralDistanceMad +
+                  400.0 * std::abs (targetDistance - summary.meanCentralDistance) +
+                  250.0 * summary.meanVelocity;
+  return summary;
+}
+
+void
+SwarmMetric::PrintJson (std::ostream &os, const Summary &summary)
+{
+  auto precision = os.precision (std::numeric_limits<double>::max_digits10);
+  os << "{\"error\": " << summary.error
+     << ", \"meanCentralDistance\": " << summary.meanCentralDistance
+     << ", \"peripheralDistanceMad\": " << summary.peripheralDistanceMad
+     << ", \"meanVelocity\": " << summary.meanVelocity << ", \"samples\": " << summary.samples
+     << "}\n";
+  os.precision (precision);
+}
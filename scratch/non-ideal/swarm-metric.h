@@ -0,0 +1,67 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "ns3/mobility-model.h"
+#include "ns3/ptr.h"
+#include "ns3/vector.h"
+
+/**
+ * \brief Swarm stability error computed while the simulation runs.
+ *
+ * Replaces replaying the positions file in parameter_optimizer at 0.1 s steps. At every sample
+ * the mean distance from the peripheral nodes to the central node, the mean distance
+ * between peripheral nodes and the mean speed of all nodes (from the previous sample)
+ * are recorded. The final error combines the deviation of the central distance from
+ * the target distance, the mean absolute deviation of the peripheral spacing over time
+ * and the mean speed, with the same weights as `get_error` in optimization.rs.
+ */
+class SwarmMetric
+{
+public:
+  struct Summary
+  {
+    double meanCentralDistance = 0;
+    double peripheralDistanceMad = 0;
+    double meanVelocity = 0;
+    double error = 0;
+    uint32_t samples = 0;
+  };
+
+  /**
+   * \brief Add a node to the swarm. All nodes must be added before the first sample
+   * \param mobility the mobility model to sample
+   * \param central true for the node the peripheral nodes are attracted to
+   */
+  void AddNode (ns3::Ptr<ns3::MobilityModel> mobility, bool central);
+
+  /// Record the statistics for the current node positions
+  void Sample (double time);
+
+  /**
+   * \param targetDistance the desired distance between peripheral and central nodes
+   * \return the statistics over all samples taken so far
+   */
+  Summary GetSummary (double targetDistance) const;
+
+  /**
+   * \brief Write a summary as a single JSON object, using the member names as keys
+   * \param os the stream to write to
+   * \param summary the summary to write
+   */
+  static void PrintJson (std::ostream &os, const Summary &summary);
+
+private:
+  std::vector<ns3::Ptr<ns3::MobilityModel>> m_mobility;
+  uint32_t m_central = 0;
+
+  std::vector<ns3::Vector> m_positions;
+  std::vector<ns3::Vector> m_lastPositions;
+  double m_lastTime = 0;
+
+  double m_centralDistanceSum = 0;
+  double m_velocitySum = 0;
+  /// Per sample peripheral spacing; the MAD needs the overall mean first
+  std::vector<double> m_peripheralDistances;
+};
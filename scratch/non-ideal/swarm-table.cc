@@ -0,0 +1,342 @@
+#include "swarm-table.h"
+#include "uav.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SWARM_TABLE_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace ns3;
+
+const uint8_t SwarmTable::NO_DATA;
+
+void
+SwarmTable::Reset (uint32_t count)
+{
+  m_x.assign (count, 0.0);
+  m_y.assign (count, 0.0);
+  m_z.assign (count, 0.0);
+  m_type.assign (count, NO_DATA);
+}
+
+void
+SwarmTable::Set (uint32_t index, const Vector &position, uint8_t type)
+{
+  m_x[index] = position.x;
+  m_y[index] = position.y;
+  m_z[index] = position.z;
+  m_type[index] = type;
+}
+
+void
+SwarmTable::Clear (uint32_t index)
+{
+  m_type[index] = NO_DATA;
+}
+
+uint8_t
+SwarmTable::GetType (uint32_t index) const
+{
+  return m_type[index];
+}
+
+void
+SwarmTable::ComputeForces (const Vector &position, Vector &attraction, Vector &repulsion) const
+{
+  static const ForcesImplementation implementation = SelectImplementation ();
+  (this->*implementation) (position, attraction, repulsion);
+}
+
+SwarmTable::ForcesImplementation
+SwarmTable::SelectImplementation (void)
+{
+#ifdef SWARM_TABLE_X86
+  if (__builtin_cpu_supports ("avx2"))
+    {
+      return &SwarmTable::ComputeForcesAvx2;
+    }
+  return &SwarmTable::ComputeForcesSse2;
+#else
+  return &SwarmTable::ComputeForcesScalar;
+#endif
+}
+
+void
+SwarmTable::AccumulateScalar (uint32_t begin, uint32_t end, const Vector &position,
+                              Vector &attraction, Vector &repulsion) const
+{
+  for (uint32_t i = begin; i < end; i++)
+    {
+      double dx = m_x[i] - position.x;
+      double dy = m_y[i] - position.y;
+      double dz = m_z[i] - position.z;
+      if (m_type[i] == UAVDataType::VIRTUAL_FORCES_CENTRAL_POSITION)
+        {
+          //Unit vector times a force equal to the distance
+          attraction.x += dx;
+          attraction.y += dy;
+          attraction.z += dz;
+        }
+      else if (m_type[i] == UAVDataType::VIRTUAL_FORCES_POSITION)
+        {
+          //Unit vector away from the other node times a force of 1 / distance
+          double inverseSquare = 1.0 / (dx * dx + dy * dy + dz * dz);
+          repulsion.x -= dx * inverseSquare;
+          repulsion.y -= dy * inverseSquare;
+          repulsion.z -= dz * inverseSquare;
+        }
+    }
+}
+
+void
+SwarmTable::ComputeForcesScalar (const Vector &position, Vector &attraction,
+                                 Vector &repulsion) const
+{
+  attraction = Vector (0, 0, 0);
+  repulsion = Vector (0, 0, 0);
+  AccumulateScalar (0, m_type.size (), position, attraction, repulsion);
+}
+
+#ifdef SWARM_TABLE_X86
+
+void
+SwarmTable::ComputeForcesSse2 (const Vector &position, Vector &attraction,
+                               Vector &repulsion) const
+{
+  const uint32_t count = m_type.size ();
+  const __m128d px = _mm_set1_pd (position.x);
+  const __m128d py = _mm_set1_pd (position.y);
+  const __m128d pz = _mm_set1_pd (position.z);
+  const __m128d one = _mm_set1_pd (1.0);
+
+  __m128d ax = _mm_setzero_pd (), ay = _mm_setzero_pd (), az = _mm_setzero_pd ();
+  __m128d rx = _mm_setzero_pd (), ry = _mm_setzero_pd (), rz = _mm_setzero_pd ();
+
+  uint32_t i = 0;
+  for (; i + 2 <= count; i += 2)
+    {
+      __m128d dx = _mm_sub_pd (_mm_loadu_pd (&m_x[i]), px);
+      __m128d dy = _mm_sub_pd (_mm_loadu_pd (&m_y[i]), py);
+      __m128d dz = _mm_sub_pd (_mm_loadu_pd (&m_z[i]), pz);
+
+      //SSE2 has no 64 bit integer compare, so build the lane masks directly
+      __m128d attract = _mm_castsi128_pd (_mm_set_epi64x (
+          -int64_t (m_type[i + 1] == UAVDataType::VIRTUAL_FORCES_CENTRAL_POSITION),
+          -int64_t (m_type[i] == UAVDataType::VIRTUAL_FORCES_CENTRAL_POSITION)));
+      __m128d repel = _mm_castsi128_pd (
+          _mm_set_epi64x (-int64_t (m_type[i + 1] == UAVDataType::VIRTUAL_FORCES_POSITION),
+                          -int64_t (m_type[i] == UAVDataType::VIRTUAL_FORCES_POSITION)));
+
+      ax = _mm_add_pd (ax, _mm_and_pd (attract, dx));
+      ay = _mm_add_pd (ay, _mm_and_pd (attract, dy));
+      az = _mm_add_pd (az, _mm_and_pd (attract, dz));
+
+      __m128d square =
+          _mm_add_pd (_mm_add_pd (_mm_mul_pd (dx, dx), _mm_mul_pd (dy, dy)), _mm_mul_pd (dz, dz));
+      //Divide by one in lanes that do not repel so empty entries cannot produce NaN
+      square = _mm_or_pd (_mm_and_pd (repel, square), _mm_andnot_pd (repel, one));
+      __m128d inverseSquare = _mm_and_pd (repel, _mm_div_pd (one, square));
+      rx = _mm_sub_pd (rx, _mm_mul_pd (dx, inverseSquare));
+      ry = _mm_sub_pd (ry, _mm_mul_pd (dy, inverseSquare));
+      rz = _mm_sub_pd (rz, _mm_mul_pd (dz, inverseSquare));
+    }
+
+  double lanes[2];
+  _mm_storeu_pd (lanes, ax);
+  attraction.x = lanes[0] + lanes[1];
+  _mm_storeu_pd (lanes, ay);
+  attraction.y = lanes[0] + lanes[1];
+  _mm_storeu_pd (lanes, az);
+  attraction.z = lanes[0] + lanes[1];
+  _mm_storeu_pd (lanes, rx);
+  repulsion.x = lanes[0] + lanes[1];
+  _mm_storeu_pd (lanes, ry);
+  repulsion.y = lanes[0] + lanes[1];
+  _mm_storeu_pd (lanes, rz);
+  repulsion.z = lanes[0] + lanes[1];
+
+  AccumulateScalar (i, count, position, attraction, repulsion);
+}
+
+/// Sum the four lanes of \p v
+__attribute__ ((target ("avx2"))) static double
+HorizontalSum (__m256d v)
+{
+  __m128d pair = _mm_add_pd (_mm256_castpd256_pd128 (v), _mm256_extractf128_pd (v, 1));
+  return _mm_cvtsd_f64 (_mm_add_sd (pair, _mm_unpackhi_pd (pair, pair)));
+}
+
+__attribute__ ((target ("avx2"))) void
+SwarmTable::ComputeForcesAvx2 (const Vector &position, Vector &attraction,
+                               Vector &repulsion) const
+{
+  const uint32_t count = m_type.size ();
+  const __m256d px = _mm256_set1_pd (position.x);
+  const __m256d py = _mm256_set1_pd (position.y);
+  const __m256d pz = _mm256_set1_pd (position.z);
+  const __m256d one = _mm256_set1_pd (1.0);
+  const __m256i central = _mm256_set1_epi64x (UAVDataType::VIRTUAL_FORCES_CENTRAL_POSITION);
+  const __m256i peripheral = _mm256_set1_epi64x (UAVDataType::VIRTUAL_FORCES_POSITION);
+
+  __m256d ax = _mm256_setzero_pd (), ay = _mm256_setzero_pd (), az = _mm256_setzero_pd ();
+  __m256d rx = _mm256_setzero_pd (), ry = _mm256_setzero_pd (), rz = _mm256_setzero_pd ();
+
+  uint32_t i = 0;
+  for (; i + 4 <= count; i += 4)
+    {
+      __m256d dx = _mm256_sub_pd (_mm256_loadu_pd (&m_x[i]), px);
+      __m256d dy = _mm256_sub_pd (_mm256_loadu_pd (&m_y[i]), py);
+      __m256d dz = _mm256_sub_pd (_mm256_loadu_pd (&m_z[i]), pz);
+
+      int32_t packedTypes;
+      std::memcpy (&packedTypes, &m_type[i], sizeof (packedTypes));
+      __m256i types = _mm256_cvtepu8_epi64 (_mm_cvtsi32_si128 (packedTypes));
+      __m256d attract = _mm256_castsi256_pd (_mm256_cmpeq_epi64 (types, central));
+      __m256d repel = _mm256_castsi256_pd (_mm256_cmpeq_epi64 (types, peripheral));
+
+      ax = _mm256_add_pd (ax, _mm256_and_pd (attract, dx));
+      ay = _mm256_add_pd (ay, _mm256_and_pd (attract, dy));
+      az = _mm256_add_pd (az, _mm256_and_pd (attract, dz));
+
+      __m256d square = _mm256_add_pd (
+          _mm256_add_pd (_mm256_mul_pd (dx, dx), _mm256_mul_pd (dy, dy)), _mm256_mul_pd (dz, dz));
+      //Divide by one in lanes that do not repel so empty entries cannot produce NaN
+      square = _mm256_blendv_pd (one, square, repel);
+      __m256d inverseSquare = _mm256_and_pd (repel, _mm256_div_pd (one, square));
+      rx = _mm256_sub_pd (rx, _mm256_mul_pd (dx, inverseSquare));
+      ry = _mm256_sub_pd (ry, _mm256_mul_pd (dy, inverseSquare));
+      rz = _mm256_sub_pd (rz, _mm256_mul_pd (dz, inverseSquare));
+    }
+
+  attraction = Vector (HorizontalSum (ax), HorizontalSum (ay), HorizontalSum (az));
+  repulsion = Vector (HorizontalSum (rx), HorizontalSum (ry), HorizontalSum (rz));
+
+  AccumulateScalar (i, count, position, attraction, repulsion);
+}
+
+#else
+
+void
+SwarmTable::ComputeForcesSse2 (const Vector &position, Vector &attraction,
+                               Vector &repulsion) const
+{
+  ComputeForcesScalar (position, attraction, repulsion);
+}
+
+void
+SwarmTable::ComputeForcesAvx2 (const Vector &position, Vector &attraction,
+                               Vector &repulsion) const
+{
+  ComputeForcesScalar (position, attraction, repulsion);
+}
+
+#endif
+
+/**
+ * The force loop UAV::Calculate used before SwarmTable: per neighbor unit vectors
+ * scaled by a single precision force.
+ */
+static void
+ReferenceForces (const std::vector<Vector> &positions, const std::vector<uint8_t> &types,
+                 const Vector &position, Vector &attraction, Vector &repulsion)
+{
+  attraction = Vector (0, 0, 0);
+  repulsion = Vector (0, 0, 0);
+  for (uint32_t i = 0; i < positions.size (); i++)
+    {
+      Vector toOther = positions[i] - position;
+      double length = toOther.GetLength ();
+      toOther = Vector (toOther.x / length, toOther.y / length, toOther.z / length);
+      if (types[i] == UAVDataType::VIRTUAL_FORCES_CENTRAL_POSITION)
+        {
+          float force = length;
+          attraction = attraction + Vector (toOther.x * force, toOther.y * force, toOther.z * force);
+        }
+      if (types[i] == UAVDataType::VIRTUAL_FORCES_POSITION)
+        {
+          float force = 1.0 / length;
+          repulsion = repulsion - Vector (toOther.x * force, toOther.y * force, toOther.z * force);
+        }
+    }
+}
+
+static bool
+IsClose (const Vector &a, const Vector &b)
+{
+  //The reference rounds every force to float
+  double tolerance = 1e-5 * std::max (1.0, std::max (a.GetLength (), b.GetLength ()));
+  return CalculateDistance (a, b) <= tolerance;
+}
+
+bool
+SwarmTable::SelfTest (std::ostream &os)
+{
+  struct Implementation
+  {
+    const char *name;
+    ForcesImplementation function;
+  };
+  std::vector<Implementation> implementations = {{"scalar", &SwarmTable::ComputeForcesScalar}};
+#ifdef SWARM_TABLE_X86
+  implementations.push_back ({"sse2", &SwarmTable::ComputeForcesSse2});
+  if (__builtin_cpu_supports ("avx2"))
+    {
+      implementations.push_back ({"avx2", &SwarmTable::ComputeForcesAvx2});
+    }
+#endif
+
+  std::mt19937 rng (1);
+  std::uniform_real_distribution<double> coordinate (-20.0, 20.0);
+  std::uniform_int_distribution<int> type (0, 3);
+
+  bool passed = true;
+  //Sizes on both sides of the vector widths exercise the scalar tails
+  for (uint32_t count = 0; count < 70; count++)
+    {
+      SwarmTable table;
+      table.Reset (count);
+      std::vector<Vector> positions;
+      std::vector<uint8_t> types;
+      for (uint32_t i = 0; i < count; i++)
+        {
+          int t = type (rng);
+          if (t > 1)
+            {
+              //Leave some entries without data, as before the first packet arrives
+              continue;
+            }
+          Vector p (coordinate (rng), coordinate (rng), coordinate (rng));
+          table.Set (i, p, t);
+          positions.push_back (p);
+          types.push_back (t);
+        }
+      Vector position (coordinate (rng), coordinate (rng), coordinate (rng));
+
+      Vector expectedAttraction, expectedRepulsion;
+      ReferenceForces (positions, types, position, expectedAttraction, expectedRepulsion);
+      for (const Implementation &implementation : implementations)
+        {
+          Vector attraction, repulsion;
+          (table.*implementation.function) (position, attraction, repulsion);
+          if (!IsClose (attraction, expectedAttraction) || !IsClose (repulsion, expectedRepulsion))
+            {
+              os << implementation.name << " mismatch with " << count << " entries: attraction "
+                 << attraction << " expected " << expectedAttraction << ", repulsion "
+                 << repulsion << " expected " << expectedRepulsion << std::endl;
+              passed = false;
+            }
+        }
+    }
+
+  os << "Checked forces implementations:";
+  for (const Implementation &implementation : implementations)
+    {
+      os << ' ' << implementation.name;
+    }
+  os << (passed ? " - PASS" : " - FAIL") << std::endl;
+  return passed;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <ostream>
+#include <stdint.h>
+#include <vector>
+
+#include "ns3/vector.h"
+
+/**
+ * \brief Last known position and type of every uav in the swarm, stored as a
+ * structure of arrays so the virtual forces can be accumulated with SIMD.
+ *
+ * Entries are indexed by UAV::GetSwarmIndex. Entries that have not received data
+ * yet, or were cleared, have type NO_DATA and are skipped by ComputeForces.
+ */
+class SwarmTable
+{
+public:
+  /// Type of entries without data
+  static const uint8_t NO_DATA = 0xFF;
+
+  /// Resize the table to \p count entries, all without data
+  void Reset (uint32_t count);
+
+  /// Store the position and UAVDataType reported by the uav at \p index
+  void Set (uint32_t index, const ns3::Vector &position, uint8_t type);
+
+  /// Forget the data of the uav at \p index
+  void Clear (uint32_t index);
+
+  /// \return the UAVDataType at \p index, or NO_DATA
+  uint8_t GetType (uint32_t index) const;
+
+  /**
+   * \brief Sum the virtual forces acting on a peripheral uav at \p position.
+   *
+   * Central entries attract with a force proportional to their distance, peripheral
+   * entries repel with a force inversely proportional to their distance. Uses AVX2 or
+   * SSE2 when the processor supports it.
+   *
+   * \param position the position of the uav the forces act on
+   * \param attraction set to the sum of the attraction forces
+   * \param repulsion set to the sum of the repulsion forces
+   */
+  void ComputeForces (const ns3::Vector &position, ns3::Vector &attraction,
+                      ns3::Vector &repulsion) const;
+
+  /**
+   * \brief Check every force implementation available on this processor against the
+   * original per neighbor vector math on random swarms.
+   * \param os where to report mismatches
+   * \return true if all implementations agree
+   */
+  static bool SelfTest (std::ostream &os);
+
+private:
+  typedef void (SwarmTable::*ForcesImplementation) (const ns3::Vector &position,
+                                                    ns3::Vector &attraction,
+                                                    ns3::Vector &repulsion) const;
+
+  /// \return the fastest implementation supported by this processor
+  static ForcesImplementation SelectImplementation (void);
+
+  void ComputeForcesScalar (const ns3::Vector &position, ns3::Vector &attraction,
+                            ns3::Vector &repulsion) const;
+  void ComputeForcesSse2 (const ns3::Vector &position, ns3::Vector &attraction,
+                          ns3::Vector &repulsion) const;
+  void ComputeForcesAvx2 (const ns3::Vector &position, ns3::Vector &attraction,
+                          ns3::Vector &repulsion) const;
+
+  /// Accumulate entries [begin, end) one at a time
+  void AccumulateScalar (uint32_t begin, uint32_t end, const ns3::Vector &position,
+                         ns3::Vector &attraction, ns3::Vector &repulsion) const;
+
+  std::vector<double> m_x;
+  std::vector<double> m_y;
+  std::vector<double> m_z;
+  std::vector<uint8_t> m_type;
+};
@@ -1,4 +1,7 @@
 #include <math.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include "uav.h"
 #include "main.h"
 
@@ -19,8 +22,12 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
+#include "ns3/ipv4.h"
 #include "ns3/mobility-model.h"
-#include "ns3/waypoint-mobility-model.h"
+#include "ns3/constant-acceleration-mobility-model.h"
 
 using namespace ns3;
 
@@ -61,12 +68,66 @@ UAV::GetTypeId (void)
           .AddAttribute("CalculateInterval", "", TimeValue(Seconds(0.1)),
                            MakeTimeAccessor(&UAV::m_calculateInterval),
                            MakeTimeChecker())
+          .AddAttribute ("Attraction", "Attraction constant between central and peripheral nodes",
+                         DoubleValue (1.0),
+                         MakeDoubleAccessor (&UAV::m_attraction),
+                         MakeDoubleChecker<double> ())
+          .AddAttribute ("Repulsion", "Repulsion constant between peripheral nodes",
+                         DoubleValue (1.0),
+                         MakeDoubleAccessor (&UAV::m_repulsion),
+                         MakeDoubleChecker<double> ())
           .AddAttribute ("UavCount", "The number of UAV's in the simulation. Used for finding ip addresses. Always >= 2 because of the central node + 1 client node", UintegerValue (2),
                          MakeUintegerAccessor (&UAV::m_uavCount),
                          MakeUintegerChecker<uint32_t> ())
           .AddAttribute ("UavType", "What type this uav is", UintegerValue (2),
                          MakeUintegerAccessor (&UAV::m_uavType),
                          MakeUintegerChecker<UAVDataType_> ())
+          .AddAttribute ("LazyCalculate",
+                         "Integrate the trajectory ahead and only recalculate when neighbor "
+                         "data changes or LazyHorizon passes, instead of scheduling every "
+                         "CalculateInterval",
+                         BooleanValue (false),
+                         MakeBooleanAccessor (&UAV::m_lazyCalculate),
+                         MakeBooleanChecker ())
+          .AddAttribute ("LazyTolerance",
+                         "Largest distance in meters the lazy trajectory may be from the "
+                         "position of any CalculateInterval step",
+                         DoubleValue (0.01),
+                         MakeDoubleAccessor (&UAV::m_lazyTolerance),
+                         MakeDoubleChecker<double> (0.0))
+          .AddAttribute ("LazyHorizon", "How far ahead the lazy trajectory is integrated",
+                         TimeValue (Seconds (1.0)),
+                         MakeTimeAccessor (&UAV::m_lazyHorizon),
+                         MakeTimeChecker ())
+          .AddAttribute ("DisseminationMode", "How position packets are sent to the other uavs",
+                         EnumValue (UAV::UNICAST),
+                         MakeEnumAccessor (&UAV::m_disseminationMode),
+                         MakeEnumChecker (UAV::UNICAST, "unicast",
+                                          UAV::BROADCAST, "broadcast",
+                                          UAV::MULTICAST, "multicast"))
+          .AddAttribute ("MulticastGroup",
+                         "The link local multicast group position packets are sent to in "
+                         "multicast mode",
+                         Ipv4AddressValue ("224.0.0.200"),
+                         MakeIpv4AddressAccessor (&UAV::m_multicastGroup),
+                         MakeIpv4AddressChecker ())
+          .AddAttribute ("MaxSendJitter",
+                         "Broadcast and multicast sends are delayed by a random time up to this "
+                         "long, so uavs started together do not keep colliding. Not used in "
+                         "unicast mode",
+                         TimeValue (MilliSeconds (100)),
+                         MakeTimeAccessor (&UAV::m_maxSendJitter),
+                         MakeTimeChecker ())
+          .AddAttribute ("NeighborTimeout",
+                         "How long the position reported by a uav keeps acting on the forces "
+                         "after it was received. Zero, the default, keeps it until the uav "
+                         "reports again",
+                         TimeValue (Seconds (0)),
+                         MakeTimeAccessor (&UAV::m_neighborTimeout),
+                         MakeTimeChecker ())
+          .AddTraceSource ("ColorChange", "The color this uav is drawn with has changed",
+                           MakeTraceSourceAccessor (&UAV::m_colorTrace),
+                           "UAV::ColorTracedCallback")
 
           ;
 
@@ -74,6 +135,7 @@ UAV::GetTypeId (void)
 }
 
 UAV::UAV ()
+  : m_sent (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -83,12 +145,16 @@ UAV::~UAV ()
   NS_LOG_FUNCTION (this);
   m_socket = 0;
   NS_LOG_INFO("UAV: " << m_uavAddress << "received"); 
-  for (const auto& entry : m_packetRecvCount) {
-    NS_LOG_INFO("  " << entry.first << " - " << entry.second);
+  for (uint32_t i = 0; i < m_packetRecvCount.size(); i++) {
+    if (m_packetRecvCount[i] != 0) {
+      NS_LOG_INFO("  " << Ipv4Address(m_rootAddress.Get() + i) << " - " << m_packetRecvCount[i]);
+    }
   }
   NS_LOG_INFO("UAV: " << m_uavAddress << "sent"); 
-  for (const auto& entry : m_packetSendCount) {
-    NS_LOG_INFO("  " << entry.first << " - " << entry.second);
+  for (uint32_t i = 0; i < m_packetSendCount.size(); i++) {
+    if (m_packetSendCount[i] != 0) {
+      NS_LOG_INFO("  " << Ipv4Address(m_rootAddress.Get() + i) << " - " << m_packetSendCount[i]);
+    }
   }
   NS_LOG_INFO(""); 
 }
@@ -109,11 +175,27 @@ UAV::StartApplication (void)
     {
       TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
       m_socket = Socket::CreateSocket (GetNode (), tid);
-      InetSocketAddress local = InetSocketAddress (m_uavAddress, m_port);
+      //Sockets bound to a unicast address do not receive broadcast or multicast packets
+      Ipv4Address bindAddress =
+          m_disseminationMode == UNICAST ? m_uavAddress : Ipv4Address::GetAny ();
+      InetSocketAddress local = InetSocketAddress (bindAddress, m_port);
       if (m_socket->Bind (local) == -1)
         {
           NS_FATAL_ERROR ("Failed to bind socket");
         }
+      if (m_disseminationMode != UNICAST)
+        {
+          //Keeps broadcasts off the loopback interface and gives link local multicast a route
+          m_socket->BindToNetDevice (GetUAVDevice ());
+          //Created here so unicast runs keep their random stream assignment
+          m_sendJitter = CreateObject<UniformRandomVariable> ();
+        }
+      if (m_disseminationMode == MULTICAST)
+        {
+          NS_ABORT_MSG_UNLESS (m_multicastGroup.IsLocalMulticast (),
+                               "MulticastGroup must be a link local multicast address");
+          DynamicCast<UdpSocket> (m_socket)->MulticastJoinGroup (0, m_multicastGroup);
+        }
       if (addressUtils::IsMulticast (m_local))
         {
           Ptr<UdpSocket> udpSocket = DynamicCast<UdpSocket> (m_socket);
@@ -132,11 +214,23 @@ UAV::StartApplication (void)
   m_socket->SetRecvCallback (MakeCallback (&UAV::HandleRead, this));
   m_socket->SetAllowBroadcast(true);
 
-  m_sendEvent = Simulator::Schedule (Seconds(0.0), &UAV::Send, this);
-  m_calculateEvent = Simulator::Schedule (Seconds(0.0), &UAV::Calculate, this);
+  m_swarmPositions.Reset (m_uavCount);
+  m_lastSeen.assign (m_uavCount, Time ());
+  m_packetRecvCount.assign (m_uavCount, 0);
+  m_packetSendCount.assign (m_uavCount, 0);
+
+  //Cancel the interval in GetNextSendDelay so the first send only waits for its jitter
+  m_lastJitter = m_packetInterval;
+  Time firstSend = m_sendJitter ? GetNextSendDelay() : Seconds(0.0);
+  m_sendEvent = Simulator::Schedule (firstSend, &UAV::Send, this);
+  if (m_lazyCalculate) {
+    m_calculateEvent = Simulator::Schedule (Seconds(0.0), &UAV::CalculateLazy, this);
+  } else {
+    m_calculateEvent = Simulator::Schedule (Seconds(0.0), &UAV::Calculate, this);
+  }
 
   if (m_uavType == UAVDataType::VIRTUAL_FORCES_CENTRAL_POSITION) {
-    SetColor(m_uavAddress, { 0.3, 0.7, 1.0 });
+    m_colorTrace(m_uavAddress, { 0.3, 0.7, 1.0 });
   }
 
   uint32_t lowAddress = m_uavAddress.Get() & 0xFF;
@@ -149,7 +243,8 @@ UAV::StartApplication (void)
 void UAV::Cyberattack() {
   NS_LOG_INFO("CYBERATTACK");
   m_uavType = UAVDataType::VIRTUAL_FORCES_CENTRAL_POSITION;
-  SetColor(m_uavAddress, Vector(1.0, 0.2, 0.2));
+  m_colorTrace(m_uavAddress, Vector(1.0, 0.2, 0.2));
+  InvalidatePlan();
 }
 
 void
@@ -164,6 +259,32 @@ UAV::StopApplication ()
     }
 }
 
+Ptr<NetDevice>
+UAV::GetUAVDevice (void) const
+{
+  Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
+  int32_t interface = ipv4->GetInterfaceForAddress (m_uavAddress);
+  NS_ABORT_MSG_IF (interface < 0, "No interface has the address " << m_uavAddress);
+  return ipv4->GetNetDevice (interface);
+}
+
+Time
+UAV::GetNextSendDelay (void)
+{
+  Time jitter = Seconds(m_sendJitter->GetValue(0.0, m_maxSendJitter.GetSeconds()));
+  Time delay = m_packetInterval - m_lastJitter + jitter;
+  m_lastJitter = jitter;
+  return delay;
+}
+
+uint32_t
+UAV::GetSwarmIndex (Ipv4Address address) const
+{
+  uint32_t offset = address.Get () - m_rootAddress.Get ();
+  //Addresses below the root wrap around to large offsets
+  return offset < m_uavCount ? offset : m_uavCount;
+}
+
 void
 UAV::HandleRead (Ptr<Socket> socket)
 {
@@ -176,7 +297,6 @@ UAV::HandleRead (Ptr<Socket> socket)
     socket->GetSockName (localAddress);
     m_rxTrace (packet);
     m_rxTraceWithAddresses (packet, from, localAddress);
-    Ptr<WaypointMobilityModel> mobility = GetNode()->GetObject<WaypointMobilityModel>(MobilityModel::GetTypeId());
     if (InetSocketAddress::IsMatchingType (from))
     {
       if (packet->GetSize() != sizeof(UAVData)) {
@@ -187,13 +307,23 @@ UAV::HandleRead (Ptr<Socket> socket)
       if (ipv4Addr == m_uavAddress) {
         continue;
       }
-      m_packetRecvCount[ipv4Addr]++;
+      uint32_t index = GetSwarmIndex(ipv4Addr);
+      if (index >= m_uavCount) {
+        //Drop packets from outside the swarm
+        continue;
+      }
+      m_packetRecvCount[index]++;
       
+      //Read the payload in place when the sender's block made it through the stack intact
       UAVData data;
-      packet->CopyData(reinterpret_cast<uint8_t*>(&data), sizeof(UAVData));
-      
-      auto& entry = m_swarmData[ipv4Addr];
-      entry.data = data;
+      const UAVData *view = packet->PeekView<UAVData>();
+      if (view == nullptr) {
+        packet->CopyData(reinterpret_cast<uint8_t*>(&data), sizeof(UAVData));
+        view = &data;
+      }
+      m_swarmPositions.Set(index, view->position, view->type);
+      m_lastSeen[index] = Simulator::Now();
+      InvalidatePlan();
     }
     packet->RemoveAllPacketTags ();
     packet->RemoveAllByteTags ();
@@ -241,16 +371,37 @@ void
 UAV::Send (void)
 {
   NS_ASSERT (m_sendEvent.IsExpired ());
-  auto mobilityModel = this->GetNode()->GetObject<ns3::WaypointMobilityModel>();
+  auto mobilityModel = this->GetNode()->GetObject<MobilityModel>();
   NS_ASSERT(mobilityModel->IsInitialized());
 
   UAVData payload;
   payload.position = mobilityModel->GetPosition();
   payload.type = m_uavType;
+  //Serialize the payload once into a shared block. Copies and receivers reference it without
+  //copying, so only the packet and its tag lists are allocated per destination
+  Ptr<PayloadBlock> block = Create<PayloadBlock>(sizeof(payload));
+  memcpy(block->GetData(), &payload, sizeof(payload));
+  Ptr<Packet> prototype = Create<Packet>(block);
 
   Address localAddress;
   m_socket->GetSockName (localAddress);
 
+  if (m_disseminationMode != UNICAST) {
+    //One transmission reaches every neighbor in range
+    Ipv4Address group = m_disseminationMode == BROADCAST ? Ipv4Address::GetBroadcast() : m_multicastGroup;
+    m_socket->SendTo(prototype, 0, InetSocketAddress(group, m_port));
+    m_sent++;
+    uint32_t self = GetSwarmIndex(m_uavAddress);
+    for (uint32_t i = 0; i < m_uavCount; i++) {
+      if (i != self) {
+        m_packetSendCount[i]++;
+      }
+    }
+
+    m_sendEvent = Simulator::Schedule (GetNextSendDelay(), &UAV::Send, this);
+    return;
+  }
+
   for (uint32_t i = 0; i < m_uavCount; i++) {
     Ipv4Address currentPeer(m_rootAddress.Get() + i);
 
@@ -259,8 +410,9 @@ UAV::Send (void)
       continue;
     }
     auto addr = InetSocketAddress(currentPeer, m_port);
-    m_socket->SendTo(reinterpret_cast<uint8_t*>(&payload), sizeof(payload), 0, addr);
-    m_packetSendCount[currentPeer]++;
+    //The socket adds tags to the packet it is given, so each destination needs its own copy
+    m_socket->SendTo(prototype->Copy(), 0, addr);
+    m_packetSendCount[i]++;
     m_sent++;
 
   }
@@ -295,51 +447,35 @@ T map(T value, T leftMin, T leftMax, T rightMin, T rightMax) {
 
 
 void UAV::Calculate() {
-  auto mobilityModel = this->GetNode()->GetObject<ns3::WaypointMobilityModel>();
+  auto mobilityModel = this->GetNode()->GetObject<ns3::ConstantAccelerationMobilityModel>();
 
+  ExpireNeighbors();
   Vector myPosition = mobilityModel->GetPosition();
+  //The model evaluates the position on demand, so this schedules no mobility events
+  mobilityModel->StartSegment(myPosition, Step(myPosition), Vector());
+
+  m_calculateEvent = Simulator::Schedule (m_calculateInterval, &UAV::Calculate, this);
+
+}
 
+Vector UAV::Step(const Vector& myPosition) {
   //NS_LOG_INFO("Me at " << myPosition);
   Vector attraction = { 0, 0, 0};
   Vector repulsion = { 0, 0, 0};
-  for (auto& pair : m_swarmData) {
-    auto& data = pair.second;
-
-    //Unit vector points from us to the other node
-    auto toOther = data.data.position - myPosition;
-    double length = toOther.GetLength();
-    toOther = toOther / length;
-
-    //NS_LOG_INFO("  other at " << data.data.position << " other at " << toOther);
-    if (m_uavType == UAVDataType::VIRTUAL_FORCES_POSITION && data.data.type == UAVDataType::VIRTUAL_FORCES_CENTRAL_POSITION) {
-
-      //NS_LOG_INFO("  attracting to center" << toOther);
-      //This could be simplified to attraction += data.data.position - myPosition;
-      //But I leave it like this to clearly show the magnitude of the force and the direction seperately
-      float force = length;
-      attraction += toOther * force;
-
-      //attraction += toOther;
-    }
-    if (m_uavType == UAVDataType::VIRTUAL_FORCES_POSITION && data.data.type == UAVDataType::VIRTUAL_FORCES_POSITION) {
-      //Force is inversely proportional to length
-      float force = 1.0 / length;
-      //And points away from the other node
-      repulsion += -toOther * force;
-      //NS_LOG_INFO("  repulsing from other force: " << force << " in dir: " << toOther);
-    }
+  if (m_uavType == UAVDataType::VIRTUAL_FORCES_POSITION) {
+    //Central nodes attract with a force equal to the distance, peripheral nodes
+    //repel with a force of 1 / distance
+    m_swarmPositions.ComputeForces(myPosition, attraction, repulsion);
   }
 
   //Apply phisics and integrate
   double dt = m_calculateInterval.GetSeconds();
   double mass = 1;
   //a=F/m
-  Vector acceleration = (attraction * s_Parameters.a + repulsion * s_Parameters.r) / mass;
+  Vector acceleration = (attraction * m_attraction + repulsion * m_repulsion) / mass;
   m_velocity += acceleration * dt;
 
-  auto now = Simulator::Now();
-  auto later = now + m_calculateInterval;
-  mobilityModel->AddWaypoint(Waypoint(later, myPosition + m_velocity * dt));
+  Vector stepVelocity = m_velocity;
 
   //Slight velocity dampening if high enough
   double velocity = m_velocity.GetLength();
@@ -359,9 +495,116 @@ void UAV::Calculate() {
   }
 
   m_velocity -= m_velocity * dampening;
-  
-  m_calculateEvent = Simulator::Schedule (m_calculateInterval, &UAV::Calculate, this);
+  return stepVelocity;
+}
+
+void UAV::CalculateLazy() {
+  auto mobilityModel = this->GetNode()->GetObject<ns3::ConstantAccelerationMobilityModel>();
+
+  //Continue exactly from where the last segment ended or was cut short
+  Vector start = m_planPositions.empty() ? mobilityModel->GetPosition() : m_planPositions.back();
+
+  //The segment ends at the step a neighbor expires, so it is integrated without it from there on
+  Time expiry = ExpireNeighbors();
+  m_planStart = Simulator::Now();
+  m_planPositions.assign(1, start);
+  m_planVelocities.assign(1, m_velocity);
+
+  //Run the same integrator as Calculate until the line from the start would be more than
+  //m_lazyTolerance from a step, and only move straight to the last step that fit. A line through step k
+  //passes close enough to step j when its slope per step is within the tolerance box around
+  //(step j - start) / j on every axis, so intersecting those boxes checks all earlier steps at once
+  const int64_t steps = std::max<int64_t>(1, m_lazyHorizon.GetTimeStep() / m_calculateInterval.GetTimeStep());
+  const double axisTolerance = m_lazyTolerance / std::sqrt(3.0);
+  const double inf = std::numeric_limits<double>::infinity();
+  Vector lowSlope(-inf, -inf, -inf);
+  Vector highSlope(inf, inf, inf);
+  for (int64_t k = 1; k <= steps; k++) {
+    if (GetPlanTime(k - 1) >= expiry) {
+      break;
+    }
+    const Vector& position = m_planPositions.back();
+    Vector next = position + Step(position) * m_calculateInterval.GetSeconds();
+
+    Vector offset = next - start;
+    Vector slope = offset / double(k);
+    if (slope.x < lowSlope.x || slope.x > highSlope.x ||
+        slope.y < lowSlope.y || slope.y > highSlope.y ||
+        slope.z < lowSlope.z || slope.z > highSlope.z) {
+      //The next segment starts from the last step that fit, so this one is calculated again
+      m_velocity = m_planVelocities.back();
+      break;
+    }
+    lowSlope.x = std::max(lowSlope.x, (offset.x - axisTolerance) / k);
+    lowSlope.y = std::max(lowSlope.y, (offset.y - axisTolerance) / k);
+    lowSlope.z = std::max(lowSlope.z, (offset.z - axisTolerance) / k);
+    highSlope.x = std::min(highSlope.x, (offset.x + axisTolerance) / k);
+    highSlope.y = std::min(highSlope.y, (offset.y + axisTolerance) / k);
+    highSlope.z = std::min(highSlope.z, (offset.z + axisTolerance) / k);
+
+    m_planPositions.push_back(next);
+    m_planVelocities.push_back(m_velocity);
+  }
+
+  Time end = GetPlanTime(m_planPositions.size() - 1);
+  Vector velocity = (m_planPositions.back() - start) / (end - m_planStart).GetSeconds();
+  mobilityModel->StartSegment(start, velocity, Vector());
+  m_calculateEvent = Simulator::Schedule (end - Simulator::Now(), &UAV::CalculateLazy, this);
+}
+
+Time UAV::GetPlanTime(uint32_t step) const {
+  return m_planStart + TimeStep(m_calculateInterval.GetTimeStep() * step);
+}
+
+Time UAV::ExpireNeighbors() {
+  Time next = Time::Max();
+  if (m_neighborTimeout.IsZero()) {
+    return next;
+  }
+  Time now = Simulator::Now();
+  for (uint32_t index = 0; index < m_uavCount; index++) {
+    if (m_swarmPositions.GetType(index) == SwarmTable::NO_DATA) {
+      continue;
+    }
+    Time expiry = m_lastSeen[index] + m_neighborTimeout;
+    if (expiry <= now) {
+      NS_LOG_INFO("Uav " << index << " not heard from since " << m_lastSeen[index].GetSeconds() << " s");
+      m_swarmPositions.Clear(index);
+    } else {
+      next = std::min(next, expiry);
+    }
+  }
+  return next;
+}
+
+void UAV::InvalidatePlan() {
+  if (!m_lazyCalculate || m_planPositions.empty()) {
+    return;
+  }
+
+  //Calculate would pick up the change at its next tick, so keep the segment up to there
+  const Time now = Simulator::Now();
+  const int64_t interval = m_calculateInterval.GetTimeStep();
+  uint32_t k = (now - m_planStart).GetTimeStep() / interval;
+  if (GetPlanTime(k) < now) {
+    k++;
+  }
+  NS_ASSERT(k < m_planPositions.size());
+
+  if (GetPlanTime(k) > now) {
+    //Head straight for step k from wherever the old segment got to
+    auto mobilityModel = this->GetNode()->GetObject<ns3::ConstantAccelerationMobilityModel>();
+    Vector current = mobilityModel->GetPosition();
+    Vector velocity = (m_planPositions[k] - current) / (GetPlanTime(k) - now).GetSeconds();
+    mobilityModel->StartSegment(current, velocity, Vector());
+  }
+
+  m_velocity = m_planVelocities[k];
+  m_planPositions.resize(k + 1);
+  m_planVelocities.resize(k + 1);
 
+  Simulator::Cancel(m_calculateEvent);
+  m_calculateEvent = Simulator::Schedule (GetPlanTime(k) - now, &UAV::CalculateLazy, this);
 }
 
 // ========== Helper stuff ==========
@@ -3,6 +3,7 @@
 #include "ns3/udp-echo-helper.h"
 
 #include <stdint.h>
+#include <vector>
 #include "ns3/application-container.h"
 #include "ns3/application.h"
 #include "ns3/node-container.h"
@@ -12,9 +13,11 @@
 #include "ns3/ipv6-address.h"
 #include "ns3/uinteger.h"
 #include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
 #include "ns3/address.h"
 #include "ns3/traced-callback.h"
 #include "ns3/vector.h"
+#include "swarm-table.h"
 
 using namespace ns3;
 namespace ns3 {
@@ -37,14 +40,17 @@ struct UAVData
 };
 
 
-struct SwarmEntry
-{
-  UAVData data;
-};
-
 class UAV : public Application
 {
 public:
+  /// How position packets reach the rest of the swarm
+  enum DisseminationMode
+  {
+    UNICAST, //!< One datagram addressed to every other uav
+    BROADCAST, //!< One datagram to the limited broadcast address
+    MULTICAST //!< One datagram to MulticastGroup
+  };
+
   /**
    * \brief Get the type ID.
    * \return the object TypeId
@@ -55,6 +61,14 @@ public:
 
   virtual UAVDataType_ GetUAVType() { return UAVDataType::VIRTUAL_FORCES_CENTRAL_POSITION; }
 
+  /**
+   * TracedCallback signature for color changes.
+   *
+   * \param [in] address The address of the UAV changing color.
+   * \param [in] color The new color as r, g, b in [0, 1].
+   */
+  typedef void (*ColorTracedCallback) (Ipv4Address address, Vector color);
+
 protected:
   virtual void DoDispose (void);
 
@@ -64,6 +78,39 @@ protected:
 
   void Calculate();
 
+  /**
+   * \brief Integrate the next straight segment of the trajectory in CalculateInterval steps.
+   *
+   * The segment grows until a straight line would be more than LazyTolerance from one of the
+   * steps or it is LazyHorizon long, and the mobility model then moves along that line. The
+   * steps are kept so InvalidatePlan can restart from any of them.
+   */
+  void CalculateLazy();
+
+  /**
+   * \brief Apply one CalculateInterval step of the virtual forces to m_velocity.
+   * \param myPosition the position at the start of the step
+   * \return the velocity to move at during the step, before dampening
+   */
+  Vector Step(const Vector& myPosition);
+
+  /**
+   * \brief Restart the lazy segment at the next step because the forces changed.
+   *
+   * Does nothing unless LazyCalculate is set.
+   */
+  void InvalidatePlan();
+
+  /// \return the time of \p step in the current lazy segment
+  Time GetPlanTime(uint32_t step) const;
+
+  /**
+   * \brief Drop the uavs not heard from for NeighborTimeout from the swarm table, so the
+   * forces no longer act towards their last reported positions.
+   * \return the time the next remaining uav expires, or Time::Max () if none will
+   */
+  Time ExpireNeighbors();
+
 private:
   virtual void StartApplication (void);
   virtual void StopApplication (void);
@@ -77,18 +124,57 @@ private:
    */
   void HandleRead (Ptr<Socket> socket);
 
+  /**
+   * \brief Get the index of a uav in the swarm tables.
+   *
+   * Addresses are assigned contiguously starting at m_rootAddress, so the host offset
+   * from the root is a dense index.
+   *
+   * \param address the address of the uav
+   * \return the index, or m_uavCount if the address is not part of the swarm
+   */
+  uint32_t GetSwarmIndex (Ipv4Address address) const;
+
+  /// \return the device the interface with m_uavAddress is on
+  Ptr<NetDevice> GetUAVDevice (void) const;
+
+  /**
+   * \brief Get the delay from the last broadcast or multicast send to the next one.
+   *
+   * Sends are due every m_packetInterval, each delayed by a new random jitter so the
+   * average interval is unchanged.
+   *
+   * \return the delay
+   */
+  Time GetNextSendDelay (void);
+
   UAVDataType_ m_uavType;
   Ipv4Address m_uavAddress;
   Time m_packetInterval;
   Time m_calculateInterval;
+  double m_attraction; //!< Attraction constant between central and peripheral nodes
+  double m_repulsion; //!< Repulsion constant between peripheral nodes
   uint32_t m_uavCount;
   Ipv4Address m_rootAddress;
+  DisseminationMode m_disseminationMode;
+  Ipv4Address m_multicastGroup; //!< Link local group used in MULTICAST mode
+  Time m_maxSendJitter; //!< Upper bound of the random delay of broadcast and multicast sends
+  Ptr<UniformRandomVariable> m_sendJitter; //!< Only created outside UNICAST mode
+  Time m_lastJitter; //!< How late the last send was relative to its nominal time
 
-  std::map<Ipv4Address, int> m_packetRecvCount;
-  std::map<Ipv4Address, int> m_packetSendCount;
+  std::vector<uint32_t> m_packetRecvCount; //!< Indexed by GetSwarmIndex
+  /// Indexed by GetSwarmIndex. Broadcast and multicast packets count for every other uav
+  std::vector<uint32_t> m_packetSendCount;
 
   Vector m_velocity = {};
 
+  bool m_lazyCalculate;
+  double m_lazyTolerance;
+  Time m_lazyHorizon;
+  Time m_planStart; //!< Time of the first step of the lazy segment
+  std::vector<Vector> m_planPositions; //!< Position at every step of the lazy segment
+  std::vector<Vector> m_planVelocities; //!< m_velocity at every step of the lazy segment
+
   uint32_t m_sent;
   EventId m_sendEvent, m_calculateEvent;
   
@@ -96,13 +182,18 @@ private:
   Ptr<Socket> m_socket; //!< IPv4 Socket
   Ipv4Address m_local; //!< local multicast address
 
-  std::map<Ipv4Address, SwarmEntry> m_swarmData;
+  SwarmTable m_swarmPositions; //!< Last reported position of each uav, indexed by GetSwarmIndex
+  std::vector<Time> m_lastSeen; //!< When data was last received, indexed by GetSwarmIndex
+  Time m_neighborTimeout; //!< How long the data of a uav is used after it was received
 
   /// Callbacks for tracing the packet Rx events
   TracedCallback<Ptr<const Packet>> m_rxTrace;
 
   /// Callbacks for tracing the packet Rx events, includes source and destination addresses
   TracedCallback<Ptr<const Packet>, const Address &, const Address &> m_rxTraceWithAddresses;
+
+  /// Callbacks for tracing changes to the color this uav is drawn with
+  TracedCallback<Ipv4Address, Vector> m_colorTrace;
 };
 
 
@@ -146,8 +146,8 @@ def register_types(module):
     module.add_class('Item', import_from_module='ns.network', outer_class=root_module['ns3::PacketTagIterator'])
     ## packet-tag-list.h (module 'network'): ns3::PacketTagList [class]
     module.add_class('PacketTagList', import_from_module='ns.network')
-    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::TagData [struct]
-    module.add_class('TagData', import_from_module='ns.network', outer_class=root_module['ns3::PacketTagList'])
+    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::Item [struct]
+    module.add_class('Item', import_from_module='ns.network', outer_class=root_module['ns3::PacketTagList'])
     ## log.h (module 'core'): ns3::ParameterLogger [class]
     module.add_class('ParameterLogger', import_from_module='ns.core')
     ## rectangle.h (module 'mobility'): ns3::Rectangle [class]
@@ -604,7 +604,7 @@ def register_methods(root_module):
     register_Ns3PacketTagIterator_methods(root_module, root_module['ns3::PacketTagIterator'])
     register_Ns3PacketTagIteratorItem_methods(root_module, root_module['ns3::PacketTagIterator::Item'])
     register_Ns3PacketTagList_methods(root_module, root_module['ns3::PacketTagList'])
-    register_Ns3PacketTagListTagData_methods(root_module, root_module['ns3::PacketTagList::TagData'])
+    register_Ns3PacketTagListItem_methods(root_module, root_module['ns3::PacketTagList::Item'])
     register_Ns3ParameterLogger_methods(root_module, root_module['ns3::ParameterLogger'])
     register_Ns3Rectangle_methods(root_module, root_module['ns3::Rectangle'])
     register_Ns3SimpleRefCount__Ns3Object_Ns3ObjectBase_Ns3ObjectDeleter_methods(root_module, root_module['ns3::SimpleRefCount< ns3::Object, ns3::ObjectBase, ns3::ObjectDeleter >'])
@@ -2619,10 +2619,10 @@ def register_Ns3PacketTagList_methods(root_module, cls):
                    'uint32_t', 
                    [], 
                    is_const=True)
-    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::TagData const * ns3::PacketTagList::Head() const [member function]
-    cls.add_method('Head', 
-                   'ns3::PacketTagList::TagData const *', 
-                   [], 
+    ## packet-tag-list.h (module 'network'): bool ns3::PacketTagList::Next(uint32_t & offset, ns3::PacketTagList::Item & item) const [member function]
+    cls.add_method('Next', 
+                   'bool', 
+                   [param('uint32_t &', 'offset'), param('ns3::PacketTagList::Item &', 'item')], 
                    is_const=True)
     ## packet-tag-list.h (module 'network'): bool ns3::PacketTagList::Peek(ns3::Tag & tag) const [member function]
     cls.add_method('Peek', 
@@ -2648,20 +2648,16 @@ def register_Ns3PacketTagList_methods(root_module, cls):
                    is_const=True)
     return
 
-def register_Ns3PacketTagListTagData_methods(root_module, cls):
-    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::TagData::TagData() [constructor]
+def register_Ns3PacketTagListItem_methods(root_module, cls):
+    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::Item::Item() [constructor]
     cls.add_constructor([])
-    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::TagData::TagData(ns3::PacketTagList::TagData const & arg0) [constructor]
-    cls.add_constructor([param('ns3::PacketTagList::TagData const &', 'arg0')])
-    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::TagData::count [variable]
-    cls.add_instance_attribute('count', 'uint32_t', is_const=False)
-    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::TagData::data [variable]
-    cls.add_instance_attribute('data', 'uint8_t [ 1 ]', is_const=False)
-    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::TagData::next [variable]
-    cls.add_instance_attribute('next', 'ns3::PacketTagList::TagData *', is_const=False)
-    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::TagData::size [variable]
+    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::Item::Item(ns3::PacketTagList::Item const & arg0) [constructor]
+    cls.add_constructor([param('ns3::PacketTagList::Item const &', 'arg0')])
+    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::Item::data [variable]
+    cls.add_instance_attribute('data', 'uint8_t const *', is_const=False)
+    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::Item::size [variable]
     cls.add_instance_attribute('size', 'uint32_t', is_const=False)
-    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::TagData::tid [variable]
+    ## packet-tag-list.h (module 'network'): ns3::PacketTagList::Item::tid [variable]
     cls.add_instance_attribute('tid', 'ns3::TypeId', is_const=False)
     return
 
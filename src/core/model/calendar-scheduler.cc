@@ -171,6 +171,29 @@ CalendarScheduler::Insert (const Event &ev)
   m_qSize++;
   ResizeUp ();
 }
+void
+CalendarScheduler::InsertBatch (const std::vector<Event> &events)
+{
+  NS_LOG_FUNCTION (this << events.size ());
+  // Resize for the whole batch before inserting it: the buckets of the
+  // current queue would get about events.size () / m_nBuckets events each.
+  uint32_t nBuckets = m_nBuckets;
+  while (m_qSize + events.size () > nBuckets * 2
+         && nBuckets < 32768)
+    {
+      nBuckets *= 2;
+    }
+  if (nBuckets != m_nBuckets)
+    {
+      Resize (nBuckets);
+    }
+  for (const Event &ev : events)
+    {
+      DoInsert (ev);
+    }
+  m_qSize += events.size ();
+}
+
 bool
 CalendarScheduler::IsEmpty (void) const
 {
@@ -61,6 +61,7 @@ class EventImpl;
  * Operation    | Amortized %Time | Reason
  * :----------- | :-------------- | :-----
  * Insert()     | ~Constant       | Ordering within bucket; possible resize
+ * InsertBatch()| ~Constant       | Ordering within bucket; at most one resize
  * IsEmpty()    | Constant        | Explicit queue size
  * PeekNext()   | ~Constant       | Search buckets
  * Remove()     | ~Constant       | Search within bucket; possible resize
@@ -105,6 +106,7 @@ public:
 
   // Inherited
   virtual void Insert (const Scheduler::Event &ev);
+  virtual void InsertBatch (const std::vector<Scheduler::Event> &events);
   virtual bool IsEmpty (void) const;
   virtual Scheduler::Event PeekNext (void) const;
   virtual Scheduler::Event RemoveNext (void);
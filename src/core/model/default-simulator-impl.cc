@@ -22,6 +22,8 @@
 #include "default-simulator-impl.h"
 #include "scheduler.h"
 #include "event-impl.h"
+#include "event-profiler.h"
+#include "string.h"
 
 #include "ptr.h"
 #include "pointer.h"
@@ -53,6 +55,15 @@ DefaultSimulatorImpl::GetTypeId (void)
     .SetParent<SimulatorImpl> ()
     .SetGroupName ("Core")
     .AddConstructor<DefaultSimulatorImpl> ()
+    .AddAttribute ("ProfileFile",
+                   "If not empty, profile the wall clock time of the events "
+                   "per function and context, and write the profile to this "
+                   "file at Simulator::Destroy, as JSON if its name ends in "
+                   ".json and as CSV otherwise.",
+                   StringValue (""),
+                   MakeStringAccessor (&DefaultSimulatorImpl::SetProfileFile,
+                                       &DefaultSimulatorImpl::GetProfileFile),
+                   MakeStringChecker ())
   ;
   return tid;
 }
@@ -72,7 +83,7 @@ DefaultSimulatorImpl::DefaultSimulatorImpl ()
   m_currentContext = Simulator::NO_CONTEXT;
   m_unscheduledEvents = 0;
   m_eventCount = 0;
-  m_eventsWithContextEmpty = true;
+  m_eventsWithContext = 0;
   m_main = SystemThread::Self ();
 }
 
@@ -109,6 +120,31 @@ DefaultSimulatorImpl::Destroy ()
           ev->Invoke ();
         }
     }
+  if (m_profiler != 0)
+    {
+      m_profiler->Write (m_profileFile);
+    }
+}
+
+void
+DefaultSimulatorImpl::SetProfileFile (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  m_profileFile = filename;
+  if (filename.empty ())
+    {
+      m_profiler.reset ();
+    }
+  else if (m_profiler == 0)
+    {
+      m_profiler.reset (new EventProfiler ());
+    }
+}
+
+std::string
+DefaultSimulatorImpl::GetProfileFile (void) const
+{
+  return m_profileFile;
 }
 
 void
@@ -119,11 +155,12 @@ DefaultSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
 
   if (m_events != 0)
     {
+      std::vector<Scheduler::Event> events;
       while (!m_events->IsEmpty ())
         {
-          Scheduler::Event next = m_events->RemoveNext ();
-          scheduler->Insert (next);
+          events.push_back (m_events->RemoveNext ());
         }
+      scheduler->InsertBatch (events);
     }
   m_events = scheduler;
 }
@@ -148,7 +185,14 @@ DefaultSimulatorImpl::ProcessOneEvent (void)
   m_currentTs = next.key.m_ts;
   m_currentContext = next.key.m_context;
   m_currentUid = next.key.m_uid;
-  next.impl->Invoke ();
+  if (m_profiler == 0)
+    {
+      next.impl->Invoke ();
+    }
+  else
+    {
+      m_profiler->Invoke (next.impl, next.key.m_context);
+    }
   next.impl->Unref ();
 
   ProcessEventsWithContext ();
@@ -163,31 +207,59 @@ DefaultSimulatorImpl::IsFinished (void) const
 void
 DefaultSimulatorImpl::ProcessEventsWithContext (void)
 {
-  if (m_eventsWithContextEmpty)
+  // Cheap test first, to only pay for the exchange when needed
+  if (m_eventsWithContext.load (std::memory_order_relaxed) == 0)
     {
       return;
     }
 
-  // swap queues
-  EventsWithContext eventsWithContext;
-  {
-    CriticalSection cs (m_eventsWithContextMutex);
-    m_eventsWithContext.swap (eventsWithContext);
-    m_eventsWithContextEmpty = true;
-  }
-  while (!eventsWithContext.empty ())
+  // take all events, and put them back in the order they were scheduled
+  EventWithContext *event = m_eventsWithContext.exchange (0, std::memory_order_acquire);
+  EventWithContext *ordered = 0;
+  std::size_t count = 0;
+  while (event != 0)
+    {
+      EventWithContext *next = event->next;
+      event->next = ordered;
+      ordered = event;
+      event = next;
+      count++;
+    }
+
+  std::vector<Scheduler::Event> batch;
+  batch.reserve (count);
+  while (ordered != 0)
     {
-      EventWithContext event = eventsWithContext.front ();
-      eventsWithContext.pop_front ();
       Scheduler::Event ev;
-      ev.impl = event.event;
-      ev.key.m_ts = m_currentTs + event.timestamp;
-      ev.key.m_context = event.context;
+      ev.impl = ordered->event;
+      ev.key.m_ts = m_currentTs + ordered->timestamp;
+      ev.key.m_context = ordered->context;
       ev.key.m_uid = m_uid;
       m_uid++;
-      m_unscheduledEvents++;
-      m_events->Insert (ev);
+      batch.push_back (ev);
+      if (m_profiler != 0)
+        {
+          m_profiler->RecordSchedule (ev.impl, ev.key.m_context, ordered->timestamp);
+        }
+      EventWithContext *next = ordered->next;
+      delete ordered;
+      ordered = next;
     }
+  m_unscheduledEvents += batch.size ();
+  m_events->InsertBatch (batch);
+}
+
+void
+DefaultSimulatorImpl::PushEventsWithContext (EventWithContext *first, EventWithContext *last)
+{
+  EventWithContext *head = m_eventsWithContext.load (std::memory_order_relaxed);
+  do
+    {
+      last->next = head;
+    }
+  while (!m_eventsWithContext.compare_exchange_weak (head, first,
+                                                     std::memory_order_release,
+                                                     std::memory_order_relaxed));
 }
 
 void
@@ -243,6 +315,10 @@ DefaultSimulatorImpl::Schedule (Time const &delay, EventImpl *event)
   m_uid++;
   m_unscheduledEvents++;
   m_events->Insert (ev);
+  if (m_profiler != 0)
+    {
+      m_profiler->RecordSchedule (event, ev.key.m_context, delay.GetTimeStep ());
+    }
   return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
 }
 
@@ -262,19 +338,66 @@ DefaultSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &delay,
       m_uid++;
       m_unscheduledEvents++;
       m_events->Insert (ev);
+      if (m_profiler != 0)
+        {
+          m_profiler->RecordSchedule (event, context, delay.GetTimeStep ());
+        }
     }
   else
     {
-      EventWithContext ev;
-      ev.context = context;
+      EventWithContext *ev = new EventWithContext ();
+      ev->context = context;
       // Current time added in ProcessEventsWithContext()
-      ev.timestamp = delay.GetTimeStep ();
-      ev.event = event;
-      {
-        CriticalSection cs (m_eventsWithContextMutex);
-        m_eventsWithContext.push_back (ev);
-        m_eventsWithContextEmpty = false;
-      }
+      ev->timestamp = delay.GetTimeStep ();
+      ev->event = event;
+      PushEventsWithContext (ev, ev);
+    }
+}
+
+void
+DefaultSimulatorImpl::ScheduleBatchWithContext (const std::vector<Simulator::ContextEvent> &events)
+{
+  NS_LOG_FUNCTION (this << events.size ());
+
+  if (SystemThread::Equals (m_main))
+    {
+      std::vector<Scheduler::Event> batch (events.size ());
+      for (std::size_t i = 0; i < events.size (); i++)
+        {
+          Time tAbsolute = events[i].delay + TimeStep (m_currentTs);
+          batch[i].impl = events[i].event;
+          batch[i].key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
+          batch[i].key.m_context = events[i].context;
+          batch[i].key.m_uid = m_uid;
+          m_uid++;
+          if (m_profiler != 0)
+            {
+              m_profiler->RecordSchedule (events[i].event, events[i].context, events[i].delay.GetTimeStep ());
+            }
+        }
+      m_unscheduledEvents += events.size ();
+      m_events->InsertBatch (batch);
+    }
+  else if (!events.empty ())
+    {
+      // chain the events from the last one, and push them at once
+      EventWithContext *first = 0;
+      EventWithContext *last = 0;
+      for (const Simulator::ContextEvent &event : events)
+        {
+          EventWithContext *ev = new EventWithContext ();
+          ev->context = event.context;
+          // Current time added in ProcessEventsWithContext()
+          ev->timestamp = event.delay.GetTimeStep ();
+          ev->event = event.event;
+          ev->next = first;
+          first = ev;
+          if (last == 0)
+            {
+              last = ev;
+            }
+        }
+      PushEventsWithContext (first, last);
     }
 }
 
@@ -291,6 +414,10 @@ DefaultSimulatorImpl::ScheduleNow (EventImpl *event)
   m_uid++;
   m_unscheduledEvents++;
   m_events->Insert (ev);
+  if (m_profiler != 0)
+    {
+      m_profiler->RecordSchedule (event, ev.key.m_context, 0);
+    }
   return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
 }
 
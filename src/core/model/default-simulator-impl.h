@@ -25,11 +25,13 @@
 #include "scheduler.h"
 #include "event-impl.h"
 #include "system-thread.h"
-#include "system-mutex.h"
 
 #include "ptr.h"
 
+#include <atomic>
 #include <list>
+#include <memory>
+#include <string>
 
 /**
  * \file
@@ -39,10 +41,16 @@
 
 namespace ns3 {
 
+class EventProfiler;
+
 /**
  * \ingroup simulator
  *
  * The default single process simulator implementation.
+ *
+ * When the ProfileFile attribute is set, the wall clock time of the
+ * events is profiled by an EventProfiler and written to that file at
+ * Simulator::Destroy().
  */
 class DefaultSimulatorImpl : public SimulatorImpl
 {
@@ -65,6 +73,7 @@ public:
   virtual void Stop (const Time &delay);
   virtual EventId Schedule (const Time &delay, EventImpl *event);
   virtual void ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event);
+  virtual void ScheduleBatchWithContext (const std::vector<Simulator::ContextEvent> &events);
   virtual EventId ScheduleNow (EventImpl *event);
   virtual EventId ScheduleDestroy (EventImpl *event);
   virtual void Remove (const EventId &id);
@@ -86,6 +95,16 @@ private:
   void ProcessOneEvent (void);
   /** Move events from a different context into the main event queue. */
   void ProcessEventsWithContext (void);
+  /**
+   * Set the file the event profile is written to, and start profiling.
+   * \param [in] filename The file name, empty to not profile.
+   */
+  void SetProfileFile (std::string filename);
+  /**
+   * Get the file the event profile is written to.
+   * \returns The file name.
+   */
+  std::string GetProfileFile (void) const;
 
   /** Wrap an event with its execution context. */
   struct EventWithContext
@@ -96,18 +115,21 @@ private:
     uint64_t timestamp;
     /** The event implementation. */
     EventImpl *event;
+    /** The event scheduled before this one. */
+    EventWithContext *next;
   };
-  /** Container type for the events from a different context. */
-  typedef std::list<struct EventWithContext> EventsWithContext;
-  /** The container of events from a different context. */
-  EventsWithContext m_eventsWithContext;
   /**
-   * Flag \c true if all events with context have been moved to the
-   * primary event queue.
+   * Push a chain of events from a different context.
+   * \param [in] first The last scheduled event of the chain.
+   * \param [in] last The first scheduled event of the chain.
+   */
+  void PushEventsWithContext (EventWithContext *first, EventWithContext *last);
+  /**
+   * The events from a different context, as a lock-free stack from the
+   * last scheduled one: other threads push to it with a
+   * compare-and-swap and the main thread takes all of them at once.
    */
-  bool m_eventsWithContextEmpty;
-  /** Mutex to control access to the list of events with context. */
-  SystemMutex m_eventsWithContextMutex;
+  std::atomic<EventWithContext *> m_eventsWithContext;
 
   /** Container type for the events to run at Simulator::Destroy() */
   typedef std::list<EventId> DestroyEvents;
@@ -136,6 +158,11 @@ private:
 
   /** Main execution thread. */
   SystemThread::ThreadId m_main;
+
+  /** The file the event profile is written to, empty to not profile. */
+  std::string m_profileFile;
+  /** The event profiler, when profiling. */
+  std::unique_ptr<EventProfiler> m_profiler;
 };
 
 } // namespace ns3
@@ -20,6 +20,8 @@
 
 #include "event-impl.h"
 #include "log.h"
+#include "system-mutex.h"
+#include <new>
 
 /**
  * \file
@@ -31,6 +33,178 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("EventImpl");
 
+namespace {
+
+/** Size classes are multiples of this, which also is their alignment. */
+const std::size_t POOL_GRANULARITY = 16;
+/** Number of size classes. */
+const std::size_t POOL_CLASSES = EventImpl::MAX_POOLED_SIZE / POOL_GRANULARITY;
+/** Number of blocks carved out of each chunk. */
+const std::size_t POOL_CHUNK_BLOCKS = 64;
+/**
+ * Blocks are handed back to the shared reserve when a thread holds
+ * more than this many free blocks of one class, so that memory does
+ * not pile up in a thread which frees the events created by others.
+ */
+const std::size_t POOL_MAX_FREE = 4096;
+
+/** A free block, linked to the next one of its class. */
+struct PoolBlock
+{
+  PoolBlock *next;  /**< Next free block. */
+};
+
+/** A list of free blocks. */
+struct PoolList
+{
+  PoolBlock *head;    /**< First block. */
+  std::size_t count;  /**< Number of blocks. */
+};
+
+/**
+ * Free blocks of the calling thread.  A plain aggregate, so that it
+ * is still usable when events are freed during thread or program exit.
+ */
+thread_local PoolList g_free[POOL_CLASSES];
+/** Set once the free blocks of the calling thread were given back. */
+thread_local bool g_exited = false;
+
+/**
+ * The reserve of blocks shared by all threads, fed by exiting threads
+ * and by threads holding too many free blocks.
+ */
+PoolList g_reserve[POOL_CLASSES];
+
+/**
+ * Get the mutex protecting the reserve.  It is never destroyed, since
+ * events may still be freed by static destructors.
+ * \returns The mutex.
+ */
+SystemMutex &
+GetReserveMutex (void)
+{
+  static SystemMutex *mutex = new SystemMutex ();
+  return *mutex;
+}
+
+/**
+ * Move the first blocks of a list to the reserve.
+ * \param [in] index The size class.
+ * \param [in,out] list The list.
+ * \param [in] count The number of blocks to move.
+ */
+void
+PoolRelease (std::size_t index, PoolList &list, std::size_t count)
+{
+  if (count == 0)
+    {
+      return;
+    }
+  PoolBlock *first = list.head;
+  PoolBlock *last = first;
+  for (std::size_t i = 1; i < count; i++)
+    {
+      last = last->next;
+    }
+  list.head = last->next;
+  list.count -= count;
+  CriticalSection cs (GetReserveMutex ());
+  last->next = g_reserve[index].head;
+  g_reserve[index].head = first;
+  g_reserve[index].count += count;
+}
+
+/** Gives the free blocks of a thread back to the reserve when it exits. */
+struct PoolGuard
+{
+  ~PoolGuard ()
+  {
+    for (std::size_t i = 0; i < POOL_CLASSES; i++)
+      {
+        PoolRelease (i, g_free[i], g_free[i].count);
+      }
+    g_exited = true;
+  }
+};
+
+/**
+ * Refill an empty free list, from the reserve if it has blocks or
+ * else from a new chunk.  Chunks are never released.
+ * \param [in] index The size class.
+ */
+void
+PoolRefill (std::size_t index)
+{
+  // The first refill of each thread arranges for its free blocks to be
+  // given back when it exits
+  static thread_local PoolGuard guard;
+  PoolList &list = g_free[index];
+  {
+    CriticalSection cs (GetReserveMutex ());
+    if (g_reserve[index].head != 0)
+      {
+        list = g_reserve[index];
+        g_reserve[index].head = 0;
+        g_reserve[index].count = 0;
+        return;
+      }
+  }
+  std::size_t size = (index + 1) * POOL_GRANULARITY;
+  char *chunk = static_cast<char *> (::operator new (size * POOL_CHUNK_BLOCKS));
+  for (std::size_t i = 0; i < POOL_CHUNK_BLOCKS; i++)
+    {
+      PoolBlock *block = reinterpret_cast<PoolBlock *> (chunk + i * size);
+      block->next = list.head;
+      list.head = block;
+    }
+  list.count = POOL_CHUNK_BLOCKS;
+}
+
+} // unnamed namespace
+
+void *
+EventImpl::operator new (std::size_t size)
+{
+  if (size > MAX_POOLED_SIZE)
+    {
+      return ::operator new (size);
+    }
+  std::size_t index = (size - 1) / POOL_GRANULARITY;
+  PoolList &list = g_free[index];
+  if (list.head == 0)
+    {
+      PoolRefill (index);
+    }
+  PoolBlock *block = list.head;
+  list.head = block->next;
+  list.count--;
+  return block;
+}
+
+void
+EventImpl::operator delete (void *p, std::size_t size)
+{
+  if (size > MAX_POOLED_SIZE)
+    {
+      ::operator delete (p);
+      return;
+    }
+  std::size_t index = (size - 1) / POOL_GRANULARITY;
+  PoolList &list = g_free[index];
+  PoolBlock *block = static_cast<PoolBlock *> (p);
+  block->next = list.head;
+  list.head = block;
+  list.count++;
+  if (g_exited)
+    {
+      PoolRelease (index, list, list.count);
+    }
+  else if (list.count > POOL_MAX_FREE)
+    {
+      PoolRelease (index, list, list.count / 2);
+    }
+}
+
 EventImpl::~EventImpl ()
 {
   NS_LOG_FUNCTION (this);
@@ -66,4 +240,10 @@ EventImpl::IsCancelled (void)
   return m_cancel;
 }
 
+const void *
+EventImpl::GetFunction (void) const
+{
+  return 0;
+}
+
 } // namespace ns3
@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <cstddef>
 #include "simple-ref-count.h"
 
 /**
@@ -40,6 +41,12 @@ namespace ns3 {
  * when it reaches the time associated to this event. Most subclasses
  * are usually created by one of the many Simulator::Schedule
  * methods.
+ *
+ * Events are created and destroyed at a very high rate, so the storage
+ * of small events does not come from the global heap: each thread
+ * keeps free lists of blocks of a few size classes, carved out of
+ * larger chunks.  Blocks freed by a thread are reused by its next
+ * events, whichever thread allocated them.
  */
 class EventImpl : public SimpleRefCount<EventImpl>
 {
@@ -65,6 +72,36 @@ public:
    * Checked by the simulation engine before calling Invoke().
    */
   bool IsCancelled (void);
+  /**
+   * Get the function or class method run by this event, to identify
+   * the events when profiling.  The object a class method runs on is
+   * not accessed, so that the event may outlive it.
+   *
+   * \returns The address of the code of a function or non-virtual
+   * class method, one plus the offset of a virtual class method in the
+   * virtual table, or 0 if unknown.
+   */
+  virtual const void * GetFunction (void) const;
+
+  /**
+   * Allocate the storage of an event.
+   *
+   * Events of up to MAX_POOLED_SIZE bytes come from the free lists of
+   * the calling thread, larger ones from the global heap.
+   *
+   * \param [in] size The size of the event.
+   * \returns The storage.
+   */
+  static void * operator new (std::size_t size);
+  /**
+   * Release the storage of an event to the free lists of the calling thread.
+   * \param [in] p The storage.
+   * \param [in] size The size of the event, as passed to operator new.
+   */
+  static void operator delete (void *p, std::size_t size);
+
+  /** Largest event size served from the free lists. */
+  static const std::size_t MAX_POOLED_SIZE = 128;
 
 protected:
   /**
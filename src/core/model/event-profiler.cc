@@ -0,0 +1,338 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "event-profiler.h"
+#include "event-impl.h"
+#include "nstime.h"
+#include "simulator.h"
+#include "abort.h"
+#include "log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#if (__GNUC__ >= 3)
+#include <cxxabi.h>
+#endif
+// dladdr is in the C library from glibc 2.34 on, and in libdl before
+#if (defined (__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 34)) || defined (__APPLE__)
+#define EVENT_PROFILER_DLADDR 1
+#include <dlfcn.h>
+#endif
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::EventProfiler implementation.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("EventProfiler");
+
+namespace {
+
+/**
+ * Demangle a C++ symbol or type name.
+ * \param [in] mangled The mangled name.
+ * \returns The demangled name, or the mangled one if it is not valid.
+ */
+std::string
+Demangle (const char *mangled)
+{
+  std::string name = mangled;
+#if (__GNUC__ >= 3)
+  int status;
+  char *demangled = abi::__cxa_demangle (mangled, NULL, NULL, &status);
+  if (status == 0)
+    {
+      name = demangled;
+    }
+  std::free (demangled);
+#endif
+  return name;
+}
+
+/**
+ * Quote a string for JSON.
+ * \param [in] s The string.
+ * \returns The quoted string.
+ */
+std::string
+JsonQuote (const std::string &s)
+{
+  std::ostringstream oss;
+  oss << '"';
+  for (char c : s)
+    {
+      if (c == '"' || c == '\\')
+        {
+          oss << '\\' << c;
+        }
+      else if (static_cast<unsigned char> (c) < 0x20)
+        {
+          oss << "\\u" << std::hex << std::setw (4) << std::setfill ('0') << int (c) << std::dec;
+        }
+      else
+        {
+          oss << c;
+        }
+    }
+  oss << '"';
+  return oss.str ();
+}
+
+/**
+ * Quote a string for CSV.
+ * \param [in] s The string.
+ * \returns The quoted string.
+ */
+std::string
+CsvQuote (const std::string &s)
+{
+  std::string quoted = "\"";
+  for (char c : s)
+    {
+      if (c == '"')
+        {
+          quoted += '"';
+        }
+      quoted += c;
+    }
+  return quoted + '"';
+}
+
+} // unnamed namespace
+
+EventProfiler::EventProfiler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+EventProfiler::Record &
+EventProfiler::GetRecord (const EventImpl *event, uint32_t context)
+{
+  // The type tells apart the virtual methods of different classes, which
+  // share their virtual table offsets
+  Key key;
+  key.function = event->GetFunction ();
+  key.type = &typeid (*event);
+  key.context = context;
+  std::unordered_map<Key, Record, KeyHash>::iterator i = m_records.find (key);
+  if (i == m_records.end ())
+    {
+      Record record = {};
+      i = m_records.insert (std::make_pair (key, record)).first;
+    }
+  return i->second;
+}
+
+void
+EventProfiler::RecordSchedule (const EventImpl *event, uint32_t context, uint64_t delay)
+{
+  uint32_t bucket = 0;
+  while (delay != 0)
+    {
+      delay >>= 1;
+      bucket++;
+    }
+  GetRecord (event, context).delays[bucket]++;
+}
+
+void
+EventProfiler::Invoke (EventImpl *event, uint32_t context)
+{
+  if (event->IsCancelled ())
+    {
+      event->Invoke ();
+      return;
+    }
+  Record &record = GetRecord (event, context);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  event->Invoke ();
+  uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now () - start).count ();
+  record.count++;
+  record.totalNs += ns;
+  record.maxNs = std::max (record.maxNs, ns);
+}
+
+std::string
+EventProfiler::GetName (const Key &key)
+{
+  uintptr_t function = reinterpret_cast<uintptr_t> (key.function);
+  std::ostringstream oss;
+  // Code is aligned on two bytes, so odd values are virtual table offsets
+  if (function & 1)
+    {
+      oss << Demangle (key.type->name ()) << " virtual+" << function - 1;
+      return oss.str ();
+    }
+#ifdef EVENT_PROFILER_DLADDR
+  Dl_info info;
+  if (key.function != 0
+      && dladdr (key.function, &info) != 0
+      && info.dli_sname != 0
+      && info.dli_saddr == key.function)
+    {
+      return Demangle (info.dli_sname);
+    }
+#endif
+  oss << Demangle (key.type->name ());
+  if (key.function != 0)
+    {
+      oss << " @" << key.function;
+    }
+  return oss.str ();
+}
+
+EventProfiler::Profile
+EventProfiler::GetProfile (void) const
+{
+  Profile profile;
+  for (const std::pair<const Key, Record> &item : m_records)
+    {
+      const Record &record = item.second;
+      Record &merged = profile[std::make_pair (GetName (item.first), item.first.context)];
+      merged.count += record.count;
+      merged.totalNs += record.totalNs;
+      merged.maxNs = std::max (merged.maxNs, record.maxNs);
+      for (uint32_t i = 0; i < DELAY_BUCKETS; i++)
+        {
+          merged.delays[i] += record.delays[i];
+        }
+    }
+  return profile;
+}
+
+double
+EventProfiler::GetDelayQuantile (const Record &record, double quantile)
+{
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < DELAY_BUCKETS; i++)
+    {
+      total += record.delays[i];
+    }
+  if (total == 0)
+    {
+      return 0;
+    }
+  uint64_t rank = static_cast<uint64_t> (std::ceil (quantile * total));
+  uint64_t count = 0;
+  uint32_t bucket = 0;
+  for (; bucket < DELAY_BUCKETS - 1; bucket++)
+    {
+      count += record.delays[bucket];
+      if (count >= rank)
+        {
+          break;
+        }
+    }
+  // Bucket 0 holds the events without delay, bucket i the delays below 2^i
+  return bucket == 0 ? 0 : std::ldexp (TimeStep (1).GetSeconds (), bucket);
+}
+
+void
+EventProfiler::WriteCsv (std::ostream &os) const
+{
+  NS_LOG_FUNCTION (this);
+  os << "function,context,count,total_s,mean_s,max_s,delay_p50_s,delay_p90_s,delay_p99_s" << std::endl;
+  os << std::setprecision (9);
+  for (const Profile::value_type &item : GetProfile ())
+    {
+      const Record &record = item.second;
+      os << CsvQuote (item.first.first) << ',';
+      if (item.first.second != Simulator::NO_CONTEXT)
+        {
+          os << item.first.second;
+        }
+      os << ',' << record.count
+         << ',' << record.totalNs * 1e-9
+         << ',' << (record.count == 0 ? 0 : record.totalNs * 1e-9 / record.count)
+         << ',' << record.maxNs * 1e-9
+         << ',' << GetDelayQuantile (record, 0.5)
+         << ',' << GetDelayQuantile (record, 0.9)
+         << ',' << GetDelayQuantile (record, 0.99)
+         << std::endl;
+    }
+}
+
+void
+EventProfiler::WriteJson (std::ostream &os) const
+{
+  NS_LOG_FUNCTION (this);
+  os << std::setprecision (9);
+  os << "{" << std::endl
+     << " \"time_step_s\" : " << TimeStep (1).GetSeconds () << "," << std::endl
+     << " \"events\" : [";
+  bool first = true;
+  for (const Profile::value_type &item : GetProfile ())
+    {
+      const Record &record = item.second;
+      os << (first ? "" : ",") << std::endl
+         << "  {\"function\" : " << JsonQuote (item.first.first)
+         << ", \"context\" : ";
+      first = false;
+      if (item.first.second != Simulator::NO_CONTEXT)
+        {
+          os << item.first.second;
+        }
+      else
+        {
+          os << "null";
+        }
+      os << ", \"count\" : " << record.count
+         << ", \"total_s\" : " << record.totalNs * 1e-9
+         << ", \"max_s\" : " << record.maxNs * 1e-9
+         << ", \"delay_histogram\" : [";
+      // Pairs of the upper bound of the bucket, in time steps, and count
+      bool firstBucket = true;
+      for (uint32_t i = 0; i < DELAY_BUCKETS; i++)
+        {
+          if (record.delays[i] != 0)
+            {
+              os << (firstBucket ? "" : ", ") << "[" << std::ldexp (1.0, i) - 1 << ", " << record.delays[i] << "]";
+              firstBucket = false;
+            }
+        }
+      os << "]}";
+    }
+  os << std::endl << " ]" << std::endl << "}" << std::endl;
+}
+
+void
+EventProfiler::Write (const std::string &filename) const
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ofstream os (filename.c_str ());
+  NS_ABORT_MSG_UNLESS (os.is_open (), "Can not open event profile file " << filename);
+  std::string extension = ".json";
+  if (filename.size () >= extension.size ()
+      && filename.compare (filename.size () - extension.size (), extension.size (), extension) == 0)
+    {
+      WriteJson (os);
+    }
+  else
+    {
+      WriteCsv (os);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+#include <stdint.h>
+#include <map>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::EventProfiler declaration.
+ */
+
+namespace ns3 {
+
+class EventImpl;
+
+/**
+ * \ingroup simulator
+ * \brief Attributes the wall clock time of the event loop to the
+ * functions run by the events and to the contexts they run in.
+ *
+ * For each function and context, the profiler counts the events and
+ * accumulates the total and maximum wall clock time of their
+ * execution, as well as the distribution of their scheduling delay,
+ * the simulated time between their scheduling and their execution, in
+ * buckets of powers of two time steps.
+ *
+ * Events are identified by the type of the event and by the function
+ * or class method they run, as returned by EventImpl::GetFunction(),
+ * which is turned into a symbol name when the profile is written.
+ * Virtual class methods, and functions without an exported symbol,
+ * such as the functions of programs not linked with \c -rdynamic, are
+ * named after the type of the event, which includes the class, and
+ * their virtual table offset or address.  Cancelled events are neither
+ * counted nor timed, but their scheduling delay, recorded when they are
+ * scheduled, is part of the distribution.
+ *
+ * The DefaultSimulatorImpl profiles its events when its ProfileFile
+ * attribute is set, and writes the profile at Simulator::Destroy():
+ * \verbatim
+   $ ./waf --run "my-program --ns3::DefaultSimulatorImpl::ProfileFile=profile.json" \endverbatim
+ *
+ * The profiler is not thread-safe: it must only be used from the
+ * thread running the events.
+ */
+class EventProfiler
+{
+public:
+  /** Number of buckets of the scheduling delay distribution. */
+  static const uint32_t DELAY_BUCKETS = 65;
+
+  /** Constructor. */
+  EventProfiler ();
+
+  /**
+   * Record the scheduling of an event.
+   * \param [in] event The event.
+   * \param [in] context The context the event will run in.
+   * \param [in] delay The scheduling delay, in time steps.
+   */
+  void RecordSchedule (const EventImpl *event, uint32_t context, uint64_t delay);
+  /**
+   * Invoke an event and record its wall clock time.
+   * \param [in] event The event.
+   * \param [in] context The context the event runs in.
+   */
+  void Invoke (EventImpl *event, uint32_t context);
+
+  /**
+   * Write the profile as CSV, one line per function and context.
+   * \param [in] os The output stream.
+   */
+  void WriteCsv (std::ostream &os) const;
+  /**
+   * Write the profile as JSON, including the full scheduling delay
+   * distributions.
+   * \param [in] os The output stream.
+   */
+  void WriteJson (std::ostream &os) const;
+  /**
+   * Write the profile to a file, as JSON if its name ends in \c .json
+   * and as CSV otherwise.
+   * \param [in] filename The file name.
+   */
+  void Write (const std::string &filename) const;
+
+private:
+  /** What identifies the events of a profile record. */
+  struct Key
+  {
+    const void *function;         /**< The function run by the events, as returned by EventImpl::GetFunction(). */
+    const std::type_info *type;   /**< The type of the events. */
+    uint32_t context;             /**< The context of the events. */
+    /**
+     * \param [in] other Another key.
+     * \returns \c true if both keys are equal.
+     */
+    bool operator == (const Key &other) const
+    {
+      return function == other.function && context == other.context
+             && (type == other.type || *type == *other.type);
+    }
+  };
+  /** Hash of a Key. */
+  struct KeyHash
+  {
+    /**
+     * \param [in] key The key.
+     * \returns The hash of the key.
+     */
+    std::size_t operator () (const Key &key) const
+    {
+      return std::hash<const void *> () (key.function) ^ key.type->hash_code ()
+             ^ (key.context * 0x9e3779b9U);
+    }
+  };
+  /** The statistics of the events of a key. */
+  struct Record
+  {
+    uint64_t count;                   /**< Number of events run. */
+    uint64_t totalNs;                 /**< Total wall clock time, in ns. */
+    uint64_t maxNs;                   /**< Maximum wall clock time, in ns. */
+    uint64_t delays[DELAY_BUCKETS];   /**< Number of events scheduled with a delay of [2^(i-1), 2^i) time steps. */
+  };
+
+  /**
+   * Get the record of an event, created if needed.
+   * \param [in] event The event.
+   * \param [in] context The context the event runs in.
+   * \returns The record.
+   */
+  Record & GetRecord (const EventImpl *event, uint32_t context);
+  /**
+   * Get the name of the events of a record.
+   * \param [in] key The key of the record.
+   * \returns The name of the function, or of the type of the events.
+   */
+  static std::string GetName (const Key &key);
+  /** The records to write, by name and context. */
+  typedef std::map<std::pair<std::string, uint32_t>, Record> Profile;
+  /**
+   * Merge the records of the events which run the same function, but
+   * are made by different templates for different argument types.
+   * \returns The records, by name and context.
+   */
+  Profile GetProfile (void) const;
+  /**
+   * Get an approximate quantile of the scheduling delay of a record.
+   * \param [in] record The record.
+   * \param [in] quantile The quantile, between 0 and 1.
+   * \returns The upper bound of the bucket of the quantile, in seconds.
+   */
+  static double GetDelayQuantile (const Record &record, double quantile);
+
+  /** The records. */
+  std::unordered_map<Key, Record, KeyHash> m_records;
+};
+
+} // namespace ns3
+
+#endif /* EVENT_PROFILER_H */
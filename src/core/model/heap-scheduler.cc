@@ -142,6 +142,24 @@ HeapScheduler::Smallest (std::size_t a, std::size_t b) const
   return IsLessStrictly (a,b) ? a : b;
 }
 
+void
+HeapScheduler::InsertBatch (const std::vector<Event> &events)
+{
+  NS_LOG_FUNCTION (this << events.size ());
+  if (events.size () < Last ())
+    {
+      Scheduler::InsertBatch (events);
+      return;
+    }
+  // Floyd's bottom-up construction is linear in the total size,
+  // cheaper than one logarithmic insertion per event here
+  m_heap.insert (m_heap.end (), events.begin (), events.end ());
+  for (std::size_t index = Parent (Last ()); index >= Root (); index--)
+    {
+      TopDown (index);
+    }
+}
+
 bool
 HeapScheduler::IsEmpty (void) const
 {
@@ -236,6 +254,14 @@ HeapScheduler::Remove (const Event &ev)
           NS_ASSERT (m_heap[i].impl == ev.impl);
           Exch (i, Last ());
           m_heap.pop_back ();
+          // the last event may come from another subtree, so it may
+          // have to move up instead of down
+          while (!IsBottom (i) && !IsRoot (i)
+                 && IsLessStrictly (i, Parent (i)))
+            {
+              Exch (i, Parent (i));
+              i = Parent (i);
+            }
           TopDown (i);
           return;
         }
@@ -57,6 +57,7 @@ namespace ns3 {
  * Operation    | Amortized %Time | Reason
  * :----------- | :-------------- | :-----
  * Insert()     | Logarithmic     | Heapify
+ * InsertBatch()| Linear          | Rebuild the heap when the batch is larger than it
  * IsEmpty()    | Constant        | Explicit queue size
  * PeekNext()   | Constant        | Heap kept sorted
  * Remove()     | Logarithmic     | Search, heapify
@@ -85,6 +86,7 @@ public:
 
   // Inherited
   virtual void Insert (const Scheduler::Event &ev);
+  virtual void InsertBatch (const std::vector<Scheduler::Event> &events);
   virtual bool IsEmpty (void) const;
   virtual Scheduler::Event PeekNext (void) const;
   virtual Scheduler::Event RemoveNext (void);
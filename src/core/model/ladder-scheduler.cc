@@ -0,0 +1,322 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ladder-scheduler.h"
+#include "event-impl.h"
+#include "assert.h"
+#include "log.h"
+#include "uinteger.h"
+#include <algorithm>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * Implementation of ns3::LadderScheduler class.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LadderScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<LadderScheduler> ()
+    .AddAttribute ("Threshold",
+                   "Buckets with more events than this are spread over a new rung "
+                   "instead of being sorted into Bottom.",
+                   UintegerValue (50),
+                   MakeUintegerAccessor (&LadderScheduler::m_threshold),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+LadderScheduler::LadderScheduler ()
+  : m_topMin (0),
+    m_topMax (0),
+    m_topStart (0),
+    m_bottomLimit (50),
+    m_size (0),
+    m_threshold (50)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LadderScheduler::~LadderScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LadderScheduler::Location
+LadderScheduler::Locate (uint64_t ts)
+{
+  Location location = {0, 0};
+  if (ts >= m_topStart)
+    {
+      location.bucket = &m_top;
+      return location;
+    }
+  // Each rung covers the bucket of its parent which is being consumed,
+  // so the first rung whose current bucket starts at or before ts is
+  // the one holding it
+  for (Rung &rung : m_rungs)
+    {
+      if (ts >= rung.start + rung.current * rung.width)
+        {
+          std::size_t index = (ts - rung.start) / rung.width;
+          NS_ASSERT (index < rung.buckets.size ());
+          location.bucket = &rung.buckets[index];
+          location.rung = &rung;
+          return location;
+        }
+    }
+  return location;
+}
+
+void
+LadderScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  Location location = Locate (ev.key.m_ts);
+  if (location.bucket == &m_top)
+    {
+      if (m_top.empty ())
+        {
+          m_topMin = ev.key.m_ts;
+          m_topMax = ev.key.m_ts;
+        }
+      m_topMin = std::min (m_topMin, ev.key.m_ts);
+      m_topMax = std::max (m_topMax, ev.key.m_ts);
+      m_top.push_back (ev);
+    }
+  else if (location.bucket != 0)
+    {
+      location.bucket->push_back (ev);
+      location.rung->count++;
+    }
+  else
+    {
+      InsertBottom (ev);
+    }
+  m_size++;
+  if (m_bottom.empty ())
+    {
+      FillBottom ();
+    }
+}
+
+void
+LadderScheduler::InsertBottom (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  m_bottom.insert (std::upper_bound (m_bottom.begin (), m_bottom.end (), ev), ev);
+  // Events at a single time stamp can not be spread
+  if (m_bottom.size () > m_bottomLimit
+      && m_bottom.front ().key.m_ts != m_bottom.back ().key.m_ts)
+    {
+      SpawnRungFromBottom ();
+    }
+}
+
+void
+LadderScheduler::SpawnRungFromBottom (void)
+{
+  NS_LOG_FUNCTION (this << m_bottom.size ());
+  // The new rung must reach up to where the ladder or Top takes over,
+  // so that events inserted later in its range find their place
+  uint64_t start = m_bottom.front ().key.m_ts;
+  uint64_t end = m_topStart;
+  if (!m_rungs.empty ())
+    {
+      const Rung &rung = m_rungs.back ();
+      end = rung.start + rung.current * rung.width;
+    }
+  NS_ASSERT (m_bottom.back ().key.m_ts < end);
+  uint64_t width = (end - start) / m_bottom.size () + 1;
+  Bucket events (m_bottom.begin (), m_bottom.end ());
+  m_bottom.clear ();
+  SpawnRung (events, start, width, (end - start - 1) / width + 1);
+  FillBottom ();
+}
+
+void
+LadderScheduler::SpawnRung (Bucket &events, uint64_t start, uint64_t width, std::size_t nBuckets)
+{
+  NS_LOG_FUNCTION (this << events.size () << start << width << nBuckets);
+  Rung rung;
+  rung.start = start;
+  rung.width = width;
+  rung.current = 0;
+  rung.count = events.size ();
+  rung.buckets.resize (nBuckets);
+  for (const Event &ev : events)
+    {
+      std::size_t index = (ev.key.m_ts - start) / width;
+      NS_ASSERT (index < nBuckets);
+      rung.buckets[index].push_back (ev);
+    }
+  events.clear ();
+  m_rungs.push_back (std::move (rung));
+}
+
+void
+LadderScheduler::MoveToBottom (Bucket &events)
+{
+  NS_LOG_FUNCTION (this << events.size ());
+  NS_ASSERT (m_bottom.empty ());
+  std::sort (events.begin (), events.end ());
+  m_bottom.assign (events.begin (), events.end ());
+  events.clear ();
+  m_bottomLimit = std::max<std::size_t> (m_threshold, 2 * m_bottom.size ());
+}
+
+void
+LadderScheduler::FillBottom (void)
+{
+  NS_LOG_FUNCTION (this);
+  while (m_bottom.empty () && m_size > 0)
+    {
+      if (m_rungs.empty ())
+        {
+          // Everything left is in Top: it becomes the first rung, and
+          // later events go to a new Top
+          NS_ASSERT (!m_top.empty ());
+          m_topStart = m_topMax + 1;
+          if (m_top.size () <= m_threshold || m_topMin == m_topMax)
+            {
+              MoveToBottom (m_top);
+            }
+          else
+            {
+              uint64_t width = (m_topMax - m_topMin) / m_top.size () + 1;
+              SpawnRung (m_top, m_topMin, width, (m_topMax - m_topMin) / width + 1);
+            }
+          continue;
+        }
+
+      Rung &rung = m_rungs.back ();
+      while (rung.current < rung.buckets.size () && rung.buckets[rung.current].empty ())
+        {
+          rung.current++;
+        }
+      if (rung.current == rung.buckets.size ())
+        {
+          NS_ASSERT (rung.count == 0);
+          m_rungs.pop_back ();
+          continue;
+        }
+
+      Bucket &bucket = rung.buckets[rung.current];
+      uint64_t bucketStart = rung.start + rung.current * rung.width;
+      uint64_t width = rung.width;
+      rung.count -= bucket.size ();
+      rung.current++;
+      if (bucket.size () > m_threshold && width > 1)
+        {
+          uint64_t minTs = bucket.front ().key.m_ts;
+          uint64_t maxTs = minTs;
+          for (const Event &ev : bucket)
+            {
+              minTs = std::min (minTs, ev.key.m_ts);
+              maxTs = std::max (maxTs, ev.key.m_ts);
+            }
+          if (minTs != maxTs)
+            {
+              // The new rung covers the whole bucket, so that events
+              // inserted later in its range find their place
+              uint64_t childWidth = (width + bucket.size () - 1) / bucket.size ();
+              Bucket events;
+              events.swap (bucket);
+              SpawnRung (events, bucketStart, childWidth, (width + childWidth - 1) / childWidth);
+              continue;
+            }
+        }
+      MoveToBottom (bucket);
+    }
+}
+
+bool
+LadderScheduler::IsEmpty (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_size == 0;
+}
+
+Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!m_bottom.empty ());
+  return m_bottom.front ();
+}
+
+Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!m_bottom.empty ());
+  Event ev = m_bottom.front ();
+  m_bottom.pop_front ();
+  m_size--;
+  if (m_bottom.empty ())
+    {
+      FillBottom ();
+    }
+  NS_LOG_DEBUG ("remove " << ev.impl << ", " << ev.key.m_ts << ", " << ev.key.m_uid);
+  return ev;
+}
+
+void
+LadderScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  Location location = Locate (ev.key.m_ts);
+  if (location.bucket == 0)
+    {
+      std::deque<Event>::iterator i = std::lower_bound (m_bottom.begin (), m_bottom.end (), ev);
+      NS_ASSERT (i != m_bottom.end () && i->key.m_uid == ev.key.m_uid);
+      NS_ASSERT (i->impl == ev.impl);
+      m_bottom.erase (i);
+    }
+  else
+    {
+      Bucket &events = *location.bucket;
+      Bucket::iterator i = std::find_if (events.begin (), events.end (),
+                                         [&ev] (const Event &other) { return other.key.m_uid == ev.key.m_uid; });
+      NS_ASSERT (i != events.end ());
+      NS_ASSERT (i->impl == ev.impl);
+      // Top and the buckets are not sorted
+      *i = events.back ();
+      events.pop_back ();
+      if (location.rung != 0)
+        {
+          location.rung->count--;
+        }
+    }
+  m_size--;
+  if (m_bottom.empty ())
+    {
+      FillBottom ();
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,180 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * Declaration of ns3::LadderScheduler class.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This class implements the Ladder Queue of W. T. Tang, R. S. M. Goh
+ * and I. L.-J. Thng, "Ladder Queue: An O(1) Priority Queue Structure
+ * for Large-Scale Discrete Event Simulation", ACM TOMACS 15(3), 2005.
+ *
+ * Events are kept in three tiers:
+ *  - Top: an unsorted list of the events furthest in the future.
+ *  - Ladder: rungs of buckets of equal width. When the ladder runs
+ *    empty, the whole Top is spread over a new rung with one bucket
+ *    per event on average.  The earliest non-empty bucket of the
+ *    innermost rung either moves to Bottom or, if it holds more than
+ *    the Threshold, is spread over a new, finer rung.
+ *  - Bottom: a short sorted list of the next events to run.  When
+ *    insertions make it twice as long as when it was last filled, it
+ *    is spread over a new innermost rung.
+ *
+ * Unlike the CalendarScheduler, bucket widths are derived from the
+ * events actually present, so there is no resizing and bursts of
+ * events at identical time stamps simply end up together in Bottom.
+ *
+ * \par Time Complexity
+ *
+ * Operation    | Amortized %Time | Reason
+ * :----------- | :-------------- | :-----
+ * Insert()     | ~Constant       | Append to Top or a bucket; sorted insertion in the short Bottom
+ * IsEmpty()    | Constant        | Explicit queue size
+ * PeekNext()   | Constant        | Bottom kept sorted
+ * Remove()     | Linear          | Search in Top, a bucket or Bottom
+ * RemoveNext() | ~Constant       | Each event is moved down a bounded number of rungs
+ *
+ * \par Memory Complexity
+ *
+ * Category  | Memory                           | Reason
+ * :-------- | :------------------------------- | :-----
+ * Overhead  | 3 x `std::vector`<br/>(~100 bytes) | Top, rungs and Bottom
+ * Per Event | ~24 bytes                        | Bucket `std::vector` per event on average
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  LadderScheduler ();
+  /** Destructor. */
+  virtual ~LadderScheduler ();
+
+  // Inherited
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event &ev);
+
+private:
+  /** Container type for the events of Top and of each bucket. */
+  typedef std::vector<Scheduler::Event> Bucket;
+
+  /** One rung of the ladder. */
+  struct Rung
+  {
+    uint64_t start;               /**< Time stamp of the start of the first bucket. */
+    uint64_t width;               /**< Width of each bucket. */
+    std::size_t current;          /**< Index of the earliest bucket which may hold events. */
+    std::size_t count;            /**< Number of events in the rung. */
+    std::vector<Bucket> buckets;  /**< The buckets. */
+  };
+
+  /**
+   * Where an event belongs in the queue.
+   *
+   * The location only depends on the time stamp and on the current
+   * state of the ladder, so it is the same when an event is inserted
+   * and when it is removed.
+   */
+  struct Location
+  {
+    Bucket *bucket;  /**< Top or a bucket, 0 for Bottom. */
+    Rung *rung;      /**< Rung of the bucket, 0 for Top or Bottom. */
+  };
+
+  /**
+   * Find where an event with a given time stamp belongs.
+   * \param [in] ts The time stamp.
+   * \returns The location of the event.
+   */
+  Location Locate (uint64_t ts);
+
+  /**
+   * Insert an event in Bottom, keeping it sorted.
+   * \param [in] ev The event.
+   */
+  void InsertBottom (const Scheduler::Event &ev);
+
+  /** Spread Bottom over a new innermost rung. */
+  void SpawnRungFromBottom (void);
+
+  /**
+   * Spread events over a new innermost rung.
+   * \param [in] events The events, emptied on return.
+   * \param [in] start The time stamp of the start of the rung.
+   * \param [in] width The width of each bucket.
+   * \param [in] nBuckets The number of buckets.
+   */
+  void SpawnRung (Bucket &events, uint64_t start, uint64_t width, std::size_t nBuckets);
+
+  /**
+   * Move events to Bottom, sorted.
+   * \param [in] events The events, emptied on return.
+   */
+  void MoveToBottom (Bucket &events);
+
+  /** Refill Bottom from the ladder or from Top if it is empty. */
+  void FillBottom (void);
+
+  /** Unsorted events with time stamps from m_topStart on. */
+  Bucket m_top;
+  /** Smallest time stamp in Top. */
+  uint64_t m_topMin;
+  /** Largest time stamp in Top. */
+  uint64_t m_topMax;
+  /** Events with this time stamp or later are inserted in Top. */
+  uint64_t m_topStart;
+  /** The rungs, from the coarsest (outermost) to the finest. */
+  std::vector<Rung> m_rungs;
+  /**
+   * The next events to run, sorted.  A deque, because new events
+   * usually go either right after the current time or at the end.
+   */
+  std::deque<Scheduler::Event> m_bottom;
+  /** Bottom is spread over a new rung when it grows larger than this. */
+  std::size_t m_bottomLimit;
+  /** Number of events in the queue. */
+  std::size_t m_size;
+  /** Largest bucket moved to Bottom without being spread over a new rung. */
+  uint32_t m_threshold;
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
@@ -23,6 +23,7 @@
 #include "log.h"
 #include <utility>
 #include <string>
+#include <algorithm>
 #include "assert.h"
 
 /**
@@ -69,6 +70,23 @@ ListScheduler::Insert (const Event &ev)
     }
   m_events.push_back (ev);
 }
+void
+ListScheduler::InsertBatch (const std::vector<Event> &events)
+{
+  NS_LOG_FUNCTION (this << events.size ());
+  std::vector<Event> sorted (events);
+  std::sort (sorted.begin (), sorted.end ());
+  EventsI i = m_events.begin ();
+  for (const Event &ev : sorted)
+    {
+      while (i != m_events.end () && !(ev.key < i->key))
+        {
+          i++;
+        }
+      m_events.insert (i, ev);
+    }
+}
+
 bool
 ListScheduler::IsEmpty (void) const
 {
@@ -48,6 +48,7 @@ class EventImpl;
  * Operation    | Amortized %Time | Reason
  * :----------- | :-------------- | :-----
  * Insert()     | Linear          | Linear search in `std::list`
+ * InsertBatch()| Linear          | Sorted, then merged in one pass over `std::list`
  * IsEmpty()    | Constant        | `std::list::size()`
  * PeekNext()   | Constant        | `std::list::front()`
  * Remove()     | Linear          | Linear search in `std::list`
@@ -77,6 +78,7 @@ public:
 
   // Inherited
   virtual void Insert (const Scheduler::Event &ev);
+  virtual void InsertBatch (const std::vector<Scheduler::Event> &events);
   virtual bool IsEmpty (void) const;
   virtual Scheduler::Event PeekNext (void) const;
   virtual Scheduler::Event RemoveNext (void);
@@ -52,6 +52,11 @@ EventImpl * MakeEvent (void (*f)(void))
       (*m_function)();
     }
 
+    virtual const void * GetFunction (void) const
+    {
+      return reinterpret_cast<const void *> (m_function);
+    }
+
   private:
     F m_function;
   } *ev = new EventFunctionImpl0 (f);
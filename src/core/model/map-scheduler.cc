@@ -24,6 +24,7 @@
 #include "assert.h"
 #include "log.h"
 #include <string>
+#include <algorithm>
 
 /**
  * \file
@@ -66,6 +67,23 @@ MapScheduler::Insert (const Event &ev)
   NS_ASSERT (result.second);
 }
 
+void
+MapScheduler::InsertBatch (const std::vector<Event> &events)
+{
+  NS_LOG_FUNCTION (this << events.size ());
+  std::vector<Event> sorted (events);
+  std::sort (sorted.begin (), sorted.end ());
+  // Events of a batch usually share a time stamp and carry the newest
+  // uids, so each one goes right after the previous one: the hint makes
+  // those insertions constant time
+  EventMapI hint = m_list.end ();
+  for (const Event &ev : sorted)
+    {
+      hint = m_list.insert (hint, std::make_pair (ev.key, ev.impl));
+      ++hint;
+    }
+}
+
 bool
 MapScheduler::IsEmpty (void) const
 {
@@ -46,6 +46,7 @@ namespace ns3 {
  * Operation    | Amortized %Time | Reason
  * :----------- | :-------------- | :-----
  * Insert()     | Logarithmic     | `std::map::insert()`
+ * InsertBatch()| ~Constant       | Sorted, then hinted `std::map::insert()`
  * IsEmpty()    | Constant        | `std::map::empty()`
  * PeekNext()   | Constant        | `std::map::begin()`
  * Remove()     | Logarithmic     | `std::map::find()`
@@ -75,6 +76,7 @@ public:
 
   // Inherited
   virtual void Insert (const Scheduler::Event &ev);
+  virtual void InsertBatch (const std::vector<Scheduler::Event> &events);
   virtual bool IsEmpty (void) const;
   virtual Scheduler::Event PeekNext (void) const;
   virtual Scheduler::Event RemoveNext (void);
@@ -0,0 +1,600 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "parallel-simulator-impl.h"
+#include "simulator.h"
+#include "scheduler.h"
+#include "event-impl.h"
+#include "uinteger.h"
+
+#include "ptr.h"
+#include "assert.h"
+#include "log.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::ParallelSimulatorImpl implementation.
+ */
+
+namespace ns3 {
+
+// Note:  Logging in this file is largely avoided due to the
+// number of calls that are made to these functions and the possibility
+// of causing recursions leading to stack overflow
+NS_LOG_COMPONENT_DEFINE ("ParallelSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (ParallelSimulatorImpl);
+
+namespace {
+
+/**
+ * The partition whose events the calling thread is running, 0 outside
+ * of ParallelSimulatorImpl::Run().  A void pointer, since the
+ * partition type is private.
+ */
+thread_local void *g_partition = 0;
+
+/** Timestamp of the events which never run. */
+const uint64_t NEVER = std::numeric_limits<uint64_t>::max ();
+
+} // unnamed namespace
+
+TypeId
+ParallelSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ParallelSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .SetGroupName ("Core")
+    .AddConstructor<ParallelSimulatorImpl> ()
+    .AddAttribute ("Threads",
+                   "The number of partitions, each run by its own thread; "
+                   "0 for the number of hardware threads.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ParallelSimulatorImpl::m_threads),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Lookahead",
+                   "The smallest delay of an event scheduled in another "
+                   "partition, which is also the duration of each window.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&ParallelSimulatorImpl::m_lookahead),
+                   MakeTimeChecker (Seconds (0)))
+  ;
+  return tid;
+}
+
+ParallelSimulatorImpl::ParallelSimulatorImpl ()
+  : m_threads (0),
+    m_stop (false),
+    m_stopTs (NEVER),
+    m_running (false),
+    m_currentTs (0),
+    m_currentContext (Simulator::NO_CONTEXT),
+    m_windowEnd (0),
+    m_done (false),
+    m_barrierCount (0),
+    m_barrierGeneration (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+ParallelSimulatorImpl::~ParallelSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+ParallelSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (const std::unique_ptr<Partition> &partition : m_partitions)
+    {
+      for (const Scheduler::Event &ev : partition->inbox)
+        {
+          ev.impl->Unref ();
+        }
+      partition->inbox.clear ();
+      while (!partition->events->IsEmpty ())
+        {
+          Scheduler::Event next = partition->events->RemoveNext ();
+          next.impl->Unref ();
+        }
+    }
+  m_partitions.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+ParallelSimulatorImpl::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+ParallelSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  NS_LOG_FUNCTION (this << schedulerFactory);
+  NS_ASSERT_MSG (!m_running, "ParallelSimulatorImpl::SetScheduler(): Called while running");
+
+  if (m_partitions.empty ())
+    {
+      // The attributes are set once the object is constructed, so the
+      // partitions are created with the first scheduler
+      uint32_t threads = m_threads;
+      if (threads == 0)
+        {
+          threads = std::max (std::thread::hardware_concurrency (), 1U);
+        }
+      for (uint32_t i = 0; i < threads; i++)
+        {
+          std::unique_ptr<Partition> partition (new Partition ());
+          partition->index = i;
+          // uids are allocated from 4, see DefaultSimulatorImpl
+          partition->uid = 4;
+          partition->currentUid = 0;
+          partition->currentTs = 0;
+          partition->currentContext = Simulator::NO_CONTEXT;
+          partition->nextTs = NEVER;
+          partition->eventCount = 0;
+          m_partitions.push_back (std::move (partition));
+        }
+    }
+
+  for (const std::unique_ptr<Partition> &partition : m_partitions)
+    {
+      Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+      if (partition->events != 0)
+        {
+          std::vector<Scheduler::Event> events;
+          while (!partition->events->IsEmpty ())
+            {
+              events.push_back (partition->events->RemoveNext ());
+            }
+          scheduler->InsertBatch (events);
+        }
+      partition->events = scheduler;
+    }
+}
+
+// System ID for non-distributed simulation is always zero
+uint32_t
+ParallelSimulatorImpl::GetSystemId (void) const
+{
+  return 0;
+}
+
+ParallelSimulatorImpl::Partition *
+ParallelSimulatorImpl::GetPartition (uint32_t context) const
+{
+  if (context == Simulator::NO_CONTEXT)
+    {
+      return m_partitions[0].get ();
+    }
+  return m_partitions[context % m_partitions.size ()].get ();
+}
+
+ParallelSimulatorImpl::Partition *
+ParallelSimulatorImpl::GetSource (void) const
+{
+  Partition *partition = static_cast<Partition *> (g_partition);
+  if (partition == 0)
+    {
+      NS_ASSERT_MSG (!m_running, "ParallelSimulatorImpl: Thread-unsafe invocation from a thread "
+                     "which does not run a partition");
+      return m_partitions[0].get ();
+    }
+  return partition;
+}
+
+Scheduler::Event
+ParallelSimulatorImpl::MakeSchedulerEvent (Partition *source, uint64_t ts, uint32_t context,
+                                           EventImpl *event)
+{
+  // Interleave the uids of the partitions, so that the uids only
+  // depend on the events run by the source partition, and not on the
+  // relative progress of the threads
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = ts;
+  ev.key.m_context = context;
+  ev.key.m_uid = source->uid * m_partitions.size () + source->index;
+  source->uid++;
+  return ev;
+}
+
+void
+ParallelSimulatorImpl::ProcessOneEvent (Partition *partition)
+{
+  Scheduler::Event next = partition->events->RemoveNext ();
+
+  NS_ASSERT (next.key.m_ts >= partition->currentTs);
+  partition->eventCount++;
+
+  NS_LOG_LOGIC ("handle " << next.key.m_ts);
+  partition->currentTs = next.key.m_ts;
+  partition->currentContext = next.key.m_context;
+  partition->currentUid = next.key.m_uid;
+  // Events scheduled from now on must come after the current one
+  partition->uid = std::max<uint32_t> (partition->uid, next.key.m_uid / m_partitions.size () + 1);
+  next.impl->Invoke ();
+  next.impl->Unref ();
+}
+
+bool
+ParallelSimulatorImpl::IsFinished (void) const
+{
+  if (m_stop)
+    {
+      return true;
+    }
+  for (const std::unique_ptr<Partition> &partition : m_partitions)
+    {
+      if (!partition->events->IsEmpty () || !partition->inbox.empty ())
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+ParallelSimulatorImpl::Synchronize (bool computeWindow)
+{
+  std::unique_lock<std::mutex> lock (m_barrierMutex);
+  uint64_t generation = m_barrierGeneration;
+  m_barrierCount++;
+  if (m_barrierCount == m_partitions.size ())
+    {
+      if (computeWindow)
+        {
+          ComputeWindow ();
+        }
+      m_barrierCount = 0;
+      m_barrierGeneration++;
+      m_barrierCondition.notify_all ();
+    }
+  else
+    {
+      m_barrierCondition.wait (lock, [this, generation] { return m_barrierGeneration != generation; });
+    }
+}
+
+void
+ParallelSimulatorImpl::ComputeWindow (void)
+{
+  uint64_t start = NEVER;
+  for (const std::unique_ptr<Partition> &partition : m_partitions)
+    {
+      start = std::min (start, partition->nextTs);
+    }
+  uint64_t stopTs = m_stopTs;
+  if (m_stop || start == NEVER || start > stopTs)
+    {
+      m_done = true;
+      if (start != NEVER && start > stopTs)
+        {
+          // The simulation ran up to the stop time
+          m_currentTs = stopTs;
+          m_stopTs = NEVER;
+        }
+      return;
+    }
+  // With no lookahead, a window holds the events of a single timestamp:
+  // the events scheduled without delay in other partitions run in the
+  // next window, at the same timestamp
+  uint64_t duration = std::max<uint64_t> (m_lookahead.GetTimeStep (), 1);
+  m_windowEnd = start + std::min (duration, NEVER - start);
+  m_done = false;
+}
+
+void
+ParallelSimulatorImpl::RunPartition (Partition *partition)
+{
+  g_partition = partition;
+  while (true)
+    {
+      // Insert the events scheduled by the other partitions in the
+      // previous window and publish the time of the next event
+      {
+        CriticalSection cs (partition->inboxMutex);
+        partition->events->InsertBatch (partition->inbox);
+        partition->inbox.clear ();
+      }
+      partition->nextTs = partition->events->IsEmpty () ? NEVER : partition->events->PeekNext ().key.m_ts;
+      Synchronize (true);
+      if (m_done)
+        {
+          break;
+        }
+
+      while (!partition->events->IsEmpty ())
+        {
+          uint64_t ts = partition->events->PeekNext ().key.m_ts;
+          if (ts >= m_windowEnd || ts > m_stopTs)
+            {
+              break;
+            }
+          ProcessOneEvent (partition);
+        }
+      // Nobody may touch its inbox before all are done with the window
+      Synchronize (false);
+    }
+  g_partition = 0;
+}
+
+void
+ParallelSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+#ifndef ENABLE_THREAD_SAFE_OBJECTS
+  if (m_partitions.size () > 1)
+    {
+      NS_FATAL_ERROR ("ParallelSimulatorImpl::Run(): " << m_partitions.size () << " threads need ns-3 "
+                      << "configured with --enable-thread-safe-objects, without which the reference "
+                      << "counts and packets shared by the threads are not thread-safe");
+    }
+#endif
+  m_stop = false;
+  m_done = false;
+  m_running = true;
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < m_partitions.size (); i++)
+    {
+      threads.push_back (std::thread (&ParallelSimulatorImpl::RunPartition, this, m_partitions[i].get ()));
+    }
+  RunPartition (m_partitions[0].get ());
+  for (std::thread &thread : threads)
+    {
+      thread.join ();
+    }
+
+  m_running = false;
+  for (const std::unique_ptr<Partition> &partition : m_partitions)
+    {
+      m_currentTs = std::max (m_currentTs, partition->currentTs);
+    }
+}
+
+void
+ParallelSimulatorImpl::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_stop = true;
+}
+
+void
+ParallelSimulatorImpl::Stop (Time const &delay)
+{
+  NS_LOG_FUNCTION (this << delay.GetTimeStep ());
+  NS_ASSERT_MSG (delay.IsPositive (), "ParallelSimulatorImpl::Stop(): Negative delay");
+  // The other partitions may already have run their events up to the
+  // end of the current window
+  if (m_running && m_partitions.size () > 1 && delay < m_lookahead)
+    {
+      NS_FATAL_ERROR ("ParallelSimulatorImpl::Stop(): Delay " << delay.As (Time::S)
+                      << " is smaller than the Lookahead " << m_lookahead.As (Time::S));
+    }
+  uint64_t stopTs = (Now () + delay).GetTimeStep ();
+  uint64_t current = m_stopTs;
+  while (stopTs < current && !m_stopTs.compare_exchange_weak (current, stopTs))
+    {
+    }
+}
+
+//
+// Schedule an event for a _relative_ time in the future.
+//
+EventId
+ParallelSimulatorImpl::Schedule (Time const &delay, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << delay.GetTimeStep () << event);
+  NS_ASSERT_MSG (delay.IsPositive (), "ParallelSimulatorImpl::Schedule(): Negative delay");
+
+  Partition *source = GetSource ();
+  uint32_t context = GetContext ();
+  Partition *target = GetPartition (context);
+  NS_ASSERT (!m_running || target == source);
+  Time tAbsolute = delay + Now ();
+  Scheduler::Event ev = MakeSchedulerEvent (source, tAbsolute.GetTimeStep (), context, event);
+  target->events->Insert (ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+void
+ParallelSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &delay, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << delay.GetTimeStep () << event);
+  NS_ASSERT_MSG (delay.IsPositive (), "ParallelSimulatorImpl::ScheduleWithContext(): Negative delay");
+
+  Partition *source = GetSource ();
+  Partition *target = GetPartition (context);
+  Time tAbsolute = delay + Now ();
+  Scheduler::Event ev = MakeSchedulerEvent (source, tAbsolute.GetTimeStep (), context, event);
+  if (!m_running || target == source)
+    {
+      target->events->Insert (ev);
+    }
+  else
+    {
+      if (delay < m_lookahead)
+        {
+          NS_FATAL_ERROR ("ParallelSimulatorImpl::ScheduleWithContext(): Delay " << delay.As (Time::S)
+                          << " to context " << context << " in another partition is smaller than "
+                          << "the Lookahead " << m_lookahead.As (Time::S));
+        }
+      CriticalSection cs (target->inboxMutex);
+      target->inbox.push_back (ev);
+    }
+}
+
+EventId
+ParallelSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  return Schedule (Time (0), event);
+}
+
+EventId
+ParallelSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  EventId id (Ptr<EventImpl> (event, false), Now ().GetTimeStep (), 0xffffffff, 2);
+  CriticalSection cs (m_destroyEventsMutex);
+  m_destroyEvents.push_back (id);
+  return id;
+}
+
+Time
+ParallelSimulatorImpl::Now (void) const
+{
+  // Do not add function logging here, to avoid stack overflow
+  Partition *partition = static_cast<Partition *> (g_partition);
+  return TimeStep (partition == 0 ? m_currentTs : partition->currentTs);
+}
+
+Time
+ParallelSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs ()) - Now ();
+    }
+}
+
+void
+ParallelSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      CriticalSection cs (m_destroyEventsMutex);
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Partition *partition = GetPartition (id.GetContext ());
+  NS_ASSERT_MSG (!m_running || partition == GetSource (),
+                 "ParallelSimulatorImpl::Remove(): Event of another partition");
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  partition->events->Remove (event);
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+}
+
+void
+ParallelSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+ParallelSimulatorImpl::IsExpired (const EventId &id) const
+{
+  if (id.GetUid () == 2)
+    {
+      if (id.PeekEventImpl () == 0
+          || id.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      CriticalSection cs (m_destroyEventsMutex);
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  if (id.PeekEventImpl () == 0)
+    {
+      return true;
+    }
+  const Partition *partition = GetPartition (id.GetContext ());
+  if (id.GetTs () < partition->currentTs
+      || (id.GetTs () == partition->currentTs && id.GetUid () <= partition->currentUid)
+      || id.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  else
+    {
+      return false;
+    }
+}
+
+Time
+ParallelSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+ParallelSimulatorImpl::GetContext (void) const
+{
+  Partition *partition = static_cast<Partition *> (g_partition);
+  return partition == 0 ? m_currentContext : partition->currentContext;
+}
+
+uint64_t
+ParallelSimulatorImpl::GetEventCount (void) const
+{
+  uint64_t eventCount = 0;
+  for (const std::unique_ptr<Partition> &partition : m_partitions)
+    {
+      eventCount += partition->eventCount;
+    }
+  return eventCount;
+}
+
+} // namespace ns3
@@ -0,0 +1,242 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PARALLEL_SIMULATOR_IMPL_H
+#define PARALLEL_SIMULATOR_IMPL_H
+
+#include "simulator-impl.h"
+#include "scheduler.h"
+#include "event-impl.h"
+#include "system-mutex.h"
+#include "nstime.h"
+
+#include "ptr.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::ParallelSimulatorImpl declaration.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ *
+ * A conservative parallel simulator implementation running in a
+ * single process, on several threads sharing memory.
+ *
+ * Events are partitioned by context: the events of context \c c run in
+ * partition <tt>c % Threads</tt>, and events without context in
+ * partition 0.  Since the context of most events is the id of the node
+ * they belong to, this spreads the nodes over the threads.  Each
+ * partition has its own scheduler and its own clock, and runs in its
+ * own thread.
+ *
+ * The partitions advance in lockstep through time windows.  A window
+ * starts at the earliest pending event of all partitions and lasts the
+ * Lookahead; all partitions run their events of the window in parallel,
+ * then synchronize on a barrier and exchange the events they scheduled
+ * in each other.  This is safe as long as an event never schedules an
+ * event in another partition less than Lookahead in the future, which
+ * is checked.  The Lookahead is therefore the smallest delay between
+ * nodes of different partitions, typically the smallest propagation
+ * delay of the channels connecting them: for a wireless channel with a
+ * constant speed propagation delay, the minimum distance between nodes
+ * divided by the speed of light.  With a zero Lookahead, which is the
+ * default, each window only holds the events of a single time stamp.
+ *
+ * Running on several threads requires ns-3 to be configured with
+ * \c --enable-thread-safe-objects, and Run() aborts otherwise.  The
+ * option makes the reference counts of SimpleRefCount and Object
+ * atomic, so that the partitions can share objects such as the
+ * channels, the devices of other nodes they schedule events for, and
+ * the packets and PPDUs they send to each other, and makes copies of a
+ * packet in different threads never extend the storage they share.
+ * Packet uids are atomic and the packet free lists are per thread in
+ * all builds.
+ *
+ * Beyond these, models run in parallel must be thread-safe: the events
+ * of different partitions must not change shared state which is not
+ * protected against concurrent accesses.  In particular, a channel
+ * reads the state of the receivers in other partitions, such as their
+ * position, from the thread of the sender, and the MaxRange receiver
+ * grid of the YansWifiChannel is not thread-safe.  The order of the events of
+ * each partition does not depend on the progress of the other threads,
+ * so that runs with the same number of threads are reproducible, but
+ * the relative order of simultaneous events of different partitions is
+ * unspecified.
+ *
+ * Events may only be removed, cancelled or checked from the partition
+ * which runs them, or from the main thread outside of Run().
+ * Simulator::Stop(void) stops the simulation at the end of the current
+ * window; Simulator::Stop(const Time &) runs the events of all
+ * partitions up to the given time included, which, like the events
+ * scheduled in other partitions, must be at least Lookahead in the
+ * future when called from an event.
+ */
+class ParallelSimulatorImpl : public SimulatorImpl
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  ParallelSimulatorImpl ();
+  /** Destructor. */
+  ~ParallelSimulatorImpl ();
+
+  // Inherited
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Stop (void);
+  virtual void Stop (const Time &delay);
+  virtual EventId Schedule (const Time &delay, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &id);
+  virtual void Cancel (const EventId &id);
+  virtual bool IsExpired (const EventId &id) const;
+  virtual void Run (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+  virtual uint64_t GetEventCount (void) const;
+
+private:
+  virtual void DoDispose (void);
+
+  /** The events and the clock of one partition. */
+  struct Partition
+  {
+    /** The event priority queue. */
+    Ptr<Scheduler> events;
+    /** Events scheduled by other partitions, inserted between windows. */
+    std::vector<Scheduler::Event> inbox;
+    /** Mutex to control access to the inbox. */
+    SystemMutex inboxMutex;
+    /** Index of the partition. */
+    uint32_t index;
+    /** Next local event unique id. */
+    uint32_t uid;
+    /** Unique id of the current event. */
+    uint32_t currentUid;
+    /** Timestamp of the current event. */
+    uint64_t currentTs;
+    /** Execution context of the current event. */
+    uint32_t currentContext;
+    /** Timestamp of the next event, published before each window. */
+    uint64_t nextTs;
+    /** The event count. */
+    uint64_t eventCount;
+  };
+
+  /**
+   * Get the partition running the events of a context.
+   * \param [in] context The context.
+   * \returns The partition.
+   */
+  Partition *GetPartition (uint32_t context) const;
+  /**
+   * Get the partition of the calling thread, that is the partition
+   * running the current event or, outside of Run(), partition 0.
+   * \returns The partition.
+   */
+  Partition *GetSource (void) const;
+  /**
+   * Make the key of a new event and allocate its unique id.
+   * \param [in] source The partition scheduling the event.
+   * \param [in] ts The timestamp of the event.
+   * \param [in] context The context of the event.
+   * \param [in] event The event.
+   * \returns The event with its key.
+   */
+  Scheduler::Event MakeSchedulerEvent (Partition *source, uint64_t ts, uint32_t context, EventImpl *event);
+  /**
+   * Run the windows of a partition until the end of the simulation.
+   * \param [in] partition The partition.
+   */
+  void RunPartition (Partition *partition);
+  /**
+   * Process the next event of a partition.
+   * \param [in] partition The partition.
+   */
+  void ProcessOneEvent (Partition *partition);
+  /**
+   * Wait until all partitions reach this point.
+   * \param [in] computeWindow If \c true, the last partition to arrive
+   * computes the next window before the others are released.
+   */
+  void Synchronize (bool computeWindow);
+  /** Compute the next window from the next events of all partitions. */
+  void ComputeWindow (void);
+
+  /** The partitions, one per thread. */
+  std::vector<std::unique_ptr<Partition> > m_partitions;
+  /** Number of threads, 0 for the number of hardware threads. */
+  uint32_t m_threads;
+  /** Smallest delay of an event scheduled in another partition. */
+  Time m_lookahead;
+
+  /** Container type for the events to run at Simulator::Destroy() */
+  typedef std::list<EventId> DestroyEvents;
+  /** The container of events to run at Destroy. */
+  DestroyEvents m_destroyEvents;
+  /** Mutex to control access to the list of destroy events. */
+  mutable SystemMutex m_destroyEventsMutex;
+
+  /** Flag calling for the end of the simulation. */
+  std::atomic<bool> m_stop;
+  /** Events after this timestamp do not run. */
+  std::atomic<uint64_t> m_stopTs;
+  /** Flag \c true while the partitions are running. */
+  bool m_running;
+  /** Timestamp seen by the main thread outside of Run(). */
+  uint64_t m_currentTs;
+  /** Execution context seen by the main thread outside of Run(). */
+  uint32_t m_currentContext;
+
+  /** End of the current window, excluded. */
+  uint64_t m_windowEnd;
+  /** Flag \c true when the last window has run. */
+  bool m_done;
+  /** Mutex of the barrier between windows. */
+  std::mutex m_barrierMutex;
+  /** Condition signaled when all partitions reached the barrier. */
+  std::condition_variable m_barrierCondition;
+  /** Number of partitions which reached the barrier. */
+  uint32_t m_barrierCount;
+  /** Incremented each time all partitions reached the barrier. */
+  uint64_t m_barrierGeneration;
+};
+
+} // namespace ns3
+
+#endif /* PARALLEL_SIMULATOR_IMPL_H */
@@ -105,6 +105,16 @@ public:
    */
   static uint64_t GetNextStreamIndex (void);
 
+  /**
+   * Reset the automatically assigned stream index counter.
+   *
+   * Random variables created after this call are assigned the same
+   * streams as in a freshly started process, so several independent
+   * simulations can be run one after the other in the same process
+   * (separated by Simulator::Destroy) with reproducible results.
+   */
+  static void ResetNextStreamIndex (void);
+
 };
 
 /** Alias for compatibility. */
@@ -39,6 +39,16 @@ Scheduler::~Scheduler ()
   NS_LOG_FUNCTION (this);
 }
 
+void
+Scheduler::InsertBatch (const std::vector<Event> &events)
+{
+  NS_LOG_FUNCTION (this << events.size ());
+  for (const Event &ev : events)
+    {
+      Insert (ev);
+    }
+}
+
 TypeId
 Scheduler::GetTypeId (void)
 {
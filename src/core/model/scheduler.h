@@ -22,6 +22,7 @@
 #define SCHEDULER_H
 
 #include <stdint.h>
+#include <vector>
 #include "object.h"
 
 /**
@@ -110,6 +111,14 @@ class EventImpl;
  *      <td class="markdownTableBodyLeft"> 0 </td>
  * </tr>
  * <tr class="markdownTableBody">
+ *      <td class="markdownTableBodyLeft"> LadderScheduler </td>
+ *      <td class="markdownTableBodyLeft"> Rungs of `std::vector` buckets </td>
+ *      <td class="markdownTableBodyLeft"> ~Constant </td>
+ *      <td class="markdownTableBodyLeft"> ~Constant </td>
+ *      <td class="markdownTableBodyLeft"> ~100 bytes </td>
+ *      <td class="markdownTableBodyLeft"> ~24 bytes </td>
+ * </tr>
+ * <tr class="markdownTableBody">
  *      <td class="markdownTableBodyLeft"> ListScheduler </td>
  *      <td class="markdownTableBodyLeft"> `std::list` </td>
  *      <td class="markdownTableBodyLeft"> Linear </td>
@@ -193,6 +202,16 @@ public:
    * \param [in] ev Event to store in the event list
    */
   virtual void Insert (const Event &ev) = 0;
+  /**
+   * Insert several Events in the schedule.
+   *
+   * The default implementation calls Insert() for each event.
+   * Schedulers which can add a batch faster than one event at a
+   * time override it.
+   *
+   * \param [in] events Events to store in the event list
+   */
+  virtual void InsertBatch (const std::vector<Event> &events);
   /**
    * Test if the schedule is empty.
    *
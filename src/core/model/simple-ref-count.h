@@ -28,6 +28,9 @@
 #include "unused.h"
 #include <stdint.h>
 #include <limits>
+#ifdef ENABLE_THREAD_SAFE_OBJECTS
+#include <atomic>
+#endif
 
 /**
  * \file
@@ -37,6 +40,21 @@
 
 namespace ns3 {
 
+/**
+ * \ingroup ptr
+ * \brief The type of the reference counts of SimpleRefCount and of the
+ * storage shared by copies of packets.
+ *
+ * When ns-3 is configured with \c --enable-thread-safe-objects, the
+ * counts are atomic, so that the threads of the ParallelSimulatorImpl
+ * can share objects.  Otherwise, they are plain integers.
+ */
+#ifdef ENABLE_THREAD_SAFE_OBJECTS
+typedef std::atomic<uint32_t> ReferenceCount;
+#else
+typedef uint32_t ReferenceCount;
+#endif
+
 /**
  * \ingroup ptr
  * \brief A template-based reference counting class
@@ -115,8 +133,7 @@ public:
    */
   inline void Unref (void) const
   {
-    m_count--;
-    if (m_count == 0)
+    if (--m_count == 0)
       {
         DELETER::Delete (static_cast<T*> (const_cast<SimpleRefCount *> (this)));
       }
@@ -141,7 +158,7 @@ private:
    * Note we make this mutable so that the const methods can still
    * change it.
    */
-  mutable uint32_t m_count;
+  mutable ReferenceCount m_count;
 };
 
 } // namespace ns3
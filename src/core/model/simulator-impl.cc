@@ -42,4 +42,14 @@ SimulatorImpl::GetTypeId (void)
   return tid;
 }
 
+void
+SimulatorImpl::ScheduleBatchWithContext (const std::vector<Simulator::ContextEvent> &events)
+{
+  NS_LOG_FUNCTION (this << events.size ());
+  for (const Simulator::ContextEvent &ev : events)
+    {
+      ScheduleWithContext (ev.context, ev.delay, ev.event);
+    }
+}
+
 } // namespace ns3
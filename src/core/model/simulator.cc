@@ -226,6 +226,17 @@ Simulator::ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *
 #endif
   return GetImpl ()->ScheduleWithContext (context, delay, impl);
 }
+void
+Simulator::ScheduleBatchWithContext (const std::vector<ContextEvent> &events)
+{
+#ifdef ENABLE_DES_METRICS
+  for (const ContextEvent &ev : events)
+    {
+      DesMetrics::Get ()->TraceWithContext (ev.context, Now (), ev.delay);
+    }
+#endif
+  return GetImpl ()->ScheduleBatchWithContext (events);
+}
 EventId
 Simulator::ScheduleDestroy (const Ptr<EventImpl> &ev)
 {
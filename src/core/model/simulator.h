@@ -30,6 +30,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 /**
  * @file
@@ -468,6 +469,28 @@ public:
    */
   static void ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event);
 
+  /** An event to schedule in a given context, see ScheduleBatchWithContext(). */
+  struct ContextEvent
+  {
+    uint32_t context;  /**< Event context. */
+    Time delay;        /**< Delay until the event expires. */
+    EventImpl *event;  /**< The event to schedule. */
+  };
+
+  /**
+   * Schedule several future events, each in its own context.
+   *
+   * This is equivalent to calling ScheduleWithContext() for each
+   * event in turn, but lets the scheduler insert the whole batch at
+   * once. Channels delivering one transmission to many receivers
+   * should prefer it. This method is thread-safe: it can be called
+   * from any thread.
+   *
+   * @param [in] events The events to schedule, in the order
+   *             ScheduleWithContext() would have been called.
+   */
+  static void ScheduleBatchWithContext (const std::vector<ContextEvent> &events);
+
   /**
    * Schedule an event to run at the end of the simulation, after
    * the Stop() time or condition has been reached.
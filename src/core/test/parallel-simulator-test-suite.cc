@@ -0,0 +1,185 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Nodes in a ring, each ticking every millisecond and pinging the next
+ * node on every tick.  Each node only touches its own state, so that
+ * the scenario can run in parallel, and logs its events.
+ */
+class ParallelSimulatorRingTestCase : public TestCase
+{
+public:
+  ParallelSimulatorRingTestCase (uint32_t threads, Time lookahead, Time stop);
+  virtual void DoRun (void);
+
+private:
+  /** The events seen by a node, as (timestamp, value) pairs. */
+  typedef std::vector<std::pair<int64_t, uint32_t> > Log;
+
+  /**
+   * Run the scenario.
+   * \param [in] simulatorType The simulator implementation.
+   * \returns The logs of all nodes.
+   */
+  std::vector<Log> RunRing (std::string simulatorType);
+  void Tick (uint32_t node, uint32_t k);
+  void Ping (uint32_t node, uint32_t from, uint32_t k);
+  void Never (void);
+
+  uint32_t m_threads;
+  Time m_lookahead;
+  Time m_stop;
+  std::vector<Log> m_logs;
+  std::vector<std::thread::id> m_threadIds;
+  std::vector<int> m_ok;
+};
+
+static const uint32_t RING_NODES = 8;
+
+ParallelSimulatorRingTestCase::ParallelSimulatorRingTestCase (uint32_t threads, Time lookahead, Time stop)
+  : TestCase ("Check a ring of nodes with " + std::to_string (threads) + " threads and lookahead "
+              + std::to_string (lookahead.GetMicroSeconds ()) + " us"
+              + (stop.IsZero () ? "" : ", stopped at " + std::to_string (stop.GetMicroSeconds ()) + " us")),
+    m_threads (threads),
+    m_lookahead (lookahead),
+    m_stop (stop)
+{}
+
+void
+ParallelSimulatorRingTestCase::Tick (uint32_t node, uint32_t k)
+{
+  m_logs[node].push_back (std::make_pair (Simulator::Now ().GetTimeStep (), k));
+  m_threadIds[node] = std::this_thread::get_id ();
+  m_ok[node] = m_ok[node] && Simulator::GetContext () == node;
+
+  EventId never = Simulator::Schedule (MicroSeconds (500), &ParallelSimulatorRingTestCase::Never, this);
+  m_ok[node] = m_ok[node] && !Simulator::IsExpired (never);
+  Simulator::Remove (never);
+  m_ok[node] = m_ok[node] && Simulator::IsExpired (never);
+
+  if (k < 100)
+    {
+      Simulator::Schedule (MilliSeconds (1), &ParallelSimulatorRingTestCase::Tick, this, node, k + 1);
+      Simulator::ScheduleWithContext ((node + 1) % RING_NODES, m_lookahead,
+                                      &ParallelSimulatorRingTestCase::Ping, this,
+                                      (node + 1) % RING_NODES, node, k);
+    }
+}
+
+void
+ParallelSimulatorRingTestCase::Ping (uint32_t node, uint32_t from, uint32_t k)
+{
+  m_logs[node].push_back (std::make_pair (Simulator::Now ().GetTimeStep (), 1000 * (from + 1) + k));
+  m_ok[node] = m_ok[node] && Simulator::GetContext () == node;
+}
+
+void
+ParallelSimulatorRingTestCase::Never (void)
+{
+  m_ok[0] = 0;
+}
+
+std::vector<ParallelSimulatorRingTestCase::Log>
+ParallelSimulatorRingTestCase::RunRing (std::string simulatorType)
+{
+  Config::SetGlobal ("SimulatorImplementationType", StringValue (simulatorType));
+  Config::SetDefault ("ns3::ParallelSimulatorImpl::Threads", UintegerValue (m_threads));
+  Config::SetDefault ("ns3::ParallelSimulatorImpl::Lookahead", TimeValue (m_lookahead));
+
+  m_logs.assign (RING_NODES, Log ());
+  m_threadIds.assign (RING_NODES, std::thread::id ());
+  m_ok.assign (RING_NODES, 1);
+  for (uint32_t node = 0; node < RING_NODES; node++)
+    {
+      // Distinct time stamps in each node, so that its log does not
+      // depend on the order of simultaneous events
+      Simulator::ScheduleWithContext (node, MicroSeconds (node), &ParallelSimulatorRingTestCase::Tick,
+                                      this, node, 0);
+    }
+  if (!m_stop.IsZero ())
+    {
+      Simulator::Stop (m_stop);
+    }
+  Simulator::Run ();
+  int64_t end = m_stop.IsZero () ? (MilliSeconds (100) + MicroSeconds (RING_NODES - 1)).GetTimeStep ()
+    : m_stop.GetTimeStep ();
+  NS_TEST_EXPECT_MSG_EQ (Simulator::Now ().GetTimeStep (), end, "Wrong time at the end of " << simulatorType);
+  Simulator::Destroy ();
+
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+  for (uint32_t node = 0; node < RING_NODES; node++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_ok[node], 1, "Wrong context or event ids in node " << node
+                             << " with " << simulatorType);
+    }
+  return m_logs;
+}
+
+void
+ParallelSimulatorRingTestCase::DoRun (void)
+{
+  std::vector<Log> reference = RunRing ("ns3::DefaultSimulatorImpl");
+  std::vector<Log> logs = RunRing ("ns3::ParallelSimulatorImpl");
+  for (uint32_t node = 0; node < RING_NODES; node++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (logs[node].size (), reference[node].size (), "Wrong number of events in node " << node);
+      for (std::size_t i = 0; i < logs[node].size (); i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (logs[node][i].first, reference[node][i].first,
+                                 "Wrong time of event " << i << " in node " << node);
+          NS_TEST_ASSERT_MSG_EQ (logs[node][i].second, reference[node][i].second,
+                                 "Wrong event " << i << " in node " << node);
+        }
+    }
+  std::set<std::thread::id> threadIds (m_threadIds.begin (), m_threadIds.end ());
+  NS_TEST_EXPECT_MSG_EQ (threadIds.size (), std::min (m_threads, RING_NODES), "Nodes did not run on all threads");
+}
+
+/**
+ * The parallel simulator TestSuite.
+ */
+class ParallelSimulatorTestSuite : public TestSuite
+{
+public:
+  ParallelSimulatorTestSuite ()
+    : TestSuite ("parallel-simulator")
+  {
+    AddTestCase (new ParallelSimulatorRingTestCase (1, MicroSeconds (10), Time (0)), TestCase::QUICK);
+    // Running on several threads needs thread-safe objects
+#ifdef ENABLE_THREAD_SAFE_OBJECTS
+    AddTestCase (new ParallelSimulatorRingTestCase (4, MicroSeconds (10), Time (0)), TestCase::QUICK);
+    AddTestCase (new ParallelSimulatorRingTestCase (3, MicroSeconds (10), Time (0)), TestCase::QUICK);
+    AddTestCase (new ParallelSimulatorRingTestCase (4, Time (0), Time (0)), TestCase::QUICK);
+    AddTestCase (new ParallelSimulatorRingTestCase (4, MicroSeconds (10), MilliSeconds (50) + NanoSeconds (5500)),
+                 TestCase::QUICK);
+#endif
+  }
+};
+
+/** Static variable for test initialization. */
+static ParallelSimulatorTestSuite g_parallelSimulatorTestSuite;
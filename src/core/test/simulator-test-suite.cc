@@ -24,6 +24,16 @@
 #include "ns3/map-scheduler.h"
 #include "ns3/calendar-scheduler.h"
 #include "ns3/priority-queue-scheduler.h"
+#include "ns3/ladder-scheduler.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/make-event.h"
+#include "ns3/event-profiler.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
 
 using namespace ns3;
 
@@ -170,6 +180,330 @@ SimulatorEventsTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (m_destroy, true, "Event should have run");
 }
 
+class SimulatorBatchTestCase : public TestCase
+{
+public:
+  SimulatorBatchTestCase (ObjectFactory schedulerFactory);
+  virtual void DoRun (void);
+  void ScheduleAll (void);
+  void Record (uint32_t tag, uint32_t context);
+  /// Events in the order they were scheduled: delay and context
+  std::vector<std::pair<Time, uint32_t> > m_scheduled;
+  std::vector<uint32_t> m_order;
+  bool m_contextOk;
+  ObjectFactory m_schedulerFactory;
+};
+
+SimulatorBatchTestCase::SimulatorBatchTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check that batches of events run in order with " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_contextOk (true),
+    m_schedulerFactory (schedulerFactory)
+{}
+
+void
+SimulatorBatchTestCase::Record (uint32_t tag, uint32_t context)
+{
+  m_order.push_back (tag);
+  if (Simulator::GetContext () != context)
+    {
+      m_contextOk = false;
+    }
+}
+
+void
+SimulatorBatchTestCase::ScheduleAll (void)
+{
+  // single events first, then a batch larger than the schedule,
+  // then a batch smaller than it
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      Time delay = MicroSeconds ((i * 7) % 5);
+      uint32_t tag = m_scheduled.size ();
+      m_scheduled.push_back (std::make_pair (delay, Simulator::GetContext ()));
+      Simulator::Schedule (delay, &SimulatorBatchTestCase::Record, this, tag, Simulator::GetContext ());
+    }
+  for (uint32_t size : {25, 3})
+    {
+      std::vector<Simulator::ContextEvent> batch;
+      for (uint32_t i = 0; i < size; i++)
+        {
+          Time delay = MicroSeconds ((i * 3) % 5);
+          uint32_t context = 100 + i;
+          uint32_t tag = m_scheduled.size ();
+          m_scheduled.push_back (std::make_pair (delay, context));
+          batch.push_back ({context, delay, MakeEvent (&SimulatorBatchTestCase::Record, this, tag, context)});
+        }
+      Simulator::ScheduleBatchWithContext (batch);
+    }
+}
+
+void
+SimulatorBatchTestCase::DoRun (void)
+{
+  Simulator::SetScheduler (m_schedulerFactory);
+  Simulator::Schedule (MicroSeconds (3), &SimulatorBatchTestCase::ScheduleAll, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // events run by time stamp, then in the order they were scheduled
+  std::vector<uint32_t> expected (m_scheduled.size ());
+  for (uint32_t i = 0; i < expected.size (); i++)
+    {
+      expected[i] = i;
+    }
+  std::stable_sort (expected.begin (), expected.end (),
+                    [this] (uint32_t a, uint32_t b) { return m_scheduled[a].first < m_scheduled[b].first; });
+  NS_TEST_ASSERT_MSG_EQ (m_order.size (), expected.size (), "Some events did not run");
+  for (uint32_t i = 0; i < expected.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_order[i], expected[i], "Event " << i << " ran out of order");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_contextOk, true, "An event ran in the wrong context");
+}
+
+class SchedulerRandomTestCase : public TestCase
+{
+public:
+  SchedulerRandomTestCase (ObjectFactory schedulerFactory);
+  virtual void DoRun (void);
+  ObjectFactory m_schedulerFactory;
+};
+
+SchedulerRandomTestCase::SchedulerRandomTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check random inserts and removes against a std::map with " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory)
+{}
+
+void
+SchedulerRandomTestCase::DoRun (void)
+{
+  RngSeedManager::SetSeed (1);
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  Ptr<Scheduler> scheduler = m_schedulerFactory.Create<Scheduler> ();
+  std::map<Scheduler::EventKey, EventImpl *> reference;
+  uint32_t uid = 0;
+  uint64_t now = 0;
+  for (uint32_t round = 0; round < 20000; round++)
+    {
+      // grow the queue to a few thousand events, then drain it
+      double action = rng->GetValue () - (round < 10000 ? 0.1 : -0.15);
+      if (action < 0.5 || reference.empty ())
+        {
+          // bursts of identical time stamps mixed with spread out ones
+          Scheduler::Event ev;
+          ev.impl = 0;
+          ev.key.m_ts = now + (rng->GetValue () < 0.3 ? 1000 : rng->GetInteger (0, 100000));
+          ev.key.m_uid = uid++;
+          ev.key.m_context = 0;
+          scheduler->Insert (ev);
+          reference[ev.key] = ev.impl;
+        }
+      else if (action < 0.9)
+        {
+          Scheduler::Event next = scheduler->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (next.key.m_uid, reference.begin ()->first.m_uid, "Wrong next event");
+          now = next.key.m_ts;
+          reference.erase (reference.begin ());
+        }
+      else
+        {
+          auto i = reference.begin ();
+          std::advance (i, rng->GetInteger (0, reference.size () - 1));
+          Scheduler::Event ev;
+          ev.impl = i->second;
+          ev.key = i->first;
+          scheduler->Remove (ev);
+          reference.erase (i);
+        }
+      NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), reference.empty (), "Wrong size");
+      if (!reference.empty ())
+        {
+          NS_TEST_ASSERT_MSG_EQ (scheduler->PeekNext ().key.m_uid, reference.begin ()->first.m_uid,
+                                 "Wrong next event");
+        }
+    }
+}
+
+class EventImplPoolTestCase : public TestCase
+{
+public:
+  EventImplPoolTestCase ();
+  virtual void DoRun (void);
+  void Small (int a)
+  {
+    m_sum += a;
+  }
+  struct Large
+  {
+    uint64_t values[32];
+  };
+  void Big (Large large)
+  {
+    m_sum += large.values[31];
+  }
+  uint64_t m_sum;
+};
+
+EventImplPoolTestCase::EventImplPoolTestCase ()
+  : TestCase ("Check the reuse of the storage of events")
+{}
+
+void
+EventImplPoolTestCase::DoRun (void)
+{
+  m_sum = 0;
+  EventImpl *first = MakeEvent (&EventImplPoolTestCase::Small, this, 1);
+  EventImpl *second = MakeEvent (&EventImplPoolTestCase::Small, this, 2);
+  NS_TEST_ASSERT_MSG_NE (first, second, "Live events share storage");
+  first->Invoke ();
+  first->Unref ();
+  EventImpl *third = MakeEvent (&EventImplPoolTestCase::Small, this, 3);
+  NS_TEST_EXPECT_MSG_EQ (third, first, "Storage of a freed event was not reused");
+  second->Invoke ();
+  third->Invoke ();
+  second->Unref ();
+  third->Unref ();
+  NS_TEST_EXPECT_MSG_EQ (m_sum, 6, "Wrong events invoked");
+
+  // Events larger than the pooled sizes come from the heap
+  Large large;
+  large.values[31] = 10;
+  EventImpl *big = MakeEvent (&EventImplPoolTestCase::Big, this, large);
+  big->Invoke ();
+  big->Unref ();
+  NS_TEST_EXPECT_MSG_EQ (m_sum, 16, "Wrong large event invoked");
+
+  // Many events in flight take storage from several chunks
+  std::vector<EventImpl *> events;
+  for (int i = 0; i < 1000; i++)
+    {
+      events.push_back (MakeEvent (&EventImplPoolTestCase::Small, this, 1));
+    }
+  std::vector<EventImpl *> sorted = events;
+  std::sort (sorted.begin (), sorted.end ());
+  NS_TEST_EXPECT_MSG_EQ ((std::adjacent_find (sorted.begin (), sorted.end ()) == sorted.end ()), true,
+                         "Live events share storage");
+  for (EventImpl *event : events)
+    {
+      event->Invoke ();
+      event->Unref ();
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_sum, 1016, "Wrong events invoked");
+}
+
+class EventProfilerTestCase : public TestCase
+{
+public:
+  EventProfilerTestCase ();
+  virtual void DoRun (void);
+  void Node (uint32_t k);
+  void Timer (void);
+  virtual void Virtual (void);
+  /**
+   * Run the events with profiling.
+   * \param [in] filename The file to write the profile to.
+   * \returns The lines of the profile.
+   */
+  std::vector<std::string> RunProfile (std::string filename);
+};
+
+EventProfilerTestCase::EventProfilerTestCase ()
+  : TestCase ("Check the event profiler")
+{}
+
+void
+EventProfilerTestCase::Node (uint32_t k)
+{
+  if (k > 0)
+    {
+      Simulator::ScheduleWithContext (Simulator::GetContext (), MilliSeconds (k), &EventProfilerTestCase::Node, this, k - 1);
+    }
+}
+
+void
+EventProfilerTestCase::Timer (void)
+{}
+
+void
+EventProfilerTestCase::Virtual (void)
+{}
+
+std::vector<std::string>
+EventProfilerTestCase::RunProfile (std::string filename)
+{
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::ProfileFile", StringValue (filename));
+  Simulator::Destroy ();
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Simulator::Schedule (MicroSeconds (i), &EventProfilerTestCase::Timer, this);
+    }
+  // 4 events in context 7 and 3 events in context 2
+  Simulator::ScheduleWithContext (7, Seconds (0), &EventProfilerTestCase::Node, this, 3);
+  Simulator::ScheduleWithContext (2, Seconds (0), &EventProfilerTestCase::Node, this, 2);
+  // 2 events of a virtual method in context 5, and a cancelled one
+  // without context, whose scheduling is recorded but which does not run
+  Simulator::ScheduleWithContext (5, Seconds (0), &EventProfilerTestCase::Virtual, this);
+  Simulator::ScheduleWithContext (5, Seconds (1), &EventProfilerTestCase::Virtual, this);
+  EventId cancelled = Simulator::Schedule (Seconds (2), &EventProfilerTestCase::Virtual, this);
+  cancelled.Cancel ();
+  Simulator::Run ();
+  Simulator::Destroy ();
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::ProfileFile", StringValue (""));
+
+  std::vector<std::string> lines;
+  std::ifstream is (filename.c_str ());
+  std::string line;
+  while (std::getline (is, line))
+    {
+      lines.push_back (line);
+    }
+  return lines;
+}
+
+void
+EventProfilerTestCase::DoRun (void)
+{
+  std::vector<std::string> lines = RunProfile (CreateTempDirFilename ("profile.csv"));
+  NS_TEST_ASSERT_MSG_EQ (lines.size (), 6, "Wrong number of profile lines");
+  NS_TEST_EXPECT_MSG_EQ (lines[0], "function,context,count,total_s,mean_s,max_s,delay_p50_s,delay_p90_s,delay_p99_s",
+                         "Wrong profile header");
+  std::map<std::string, std::string> counts;
+  for (std::size_t i = 1; i < lines.size (); i++)
+    {
+      // The function name is quoted and the context and count follow it
+      std::size_t end = lines[i].find ("\",");
+      NS_TEST_ASSERT_MSG_NE (end, std::string::npos, "Wrong profile line " << lines[i]);
+      std::string name = lines[i].substr (1, end - 1);
+      std::string fields = lines[i].substr (end + 2);
+      std::string key = name.find (" virtual+") != std::string::npos ? "Virtual"
+        : name.find ("Node") != std::string::npos ? "Node"
+        : name.find ("Timer") != std::string::npos ? "Timer" : name;
+      counts[key + "," + fields.substr (0, fields.find (',', fields.find (',') + 1))] = lines[i];
+    }
+  NS_TEST_EXPECT_MSG_EQ (counts.count ("Timer,,3"), 1, "Wrong profile of the events without context");
+  NS_TEST_EXPECT_MSG_EQ (counts.count ("Node,7,4"), 1, "Wrong profile of the events of context 7");
+  NS_TEST_EXPECT_MSG_EQ (counts.count ("Node,2,3"), 1, "Wrong profile of the events of context 2");
+  NS_TEST_EXPECT_MSG_EQ (counts.count ("Virtual,5,2"), 1, "Wrong profile of the virtual method events");
+  NS_TEST_EXPECT_MSG_EQ (counts.count ("Virtual,,0"), 1, "Cancelled event counted");
+
+  lines = RunProfile (CreateTempDirFilename ("profile.json"));
+  NS_TEST_ASSERT_MSG_GT (lines.size (), 0, "Empty JSON profile");
+  NS_TEST_EXPECT_MSG_EQ (lines[0], "{", "Wrong JSON profile");
+  std::size_t found = 0;
+  for (const std::string &line : lines)
+    {
+      // Delays of 0, 1 and 2 us, in nanosecond time steps
+      if (line.find ("\"context\" : null, \"count\" : 3") != std::string::npos
+          && line.find ("[[0, 1], [1023, 1], [2047, 1]]") != std::string::npos)
+        {
+          found++;
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (found, 1, "Wrong JSON profile of the events without context");
+}
+
 class SimulatorTemplateTestCase : public TestCase
 {
 public:
@@ -475,13 +809,29 @@ public:
     factory.SetTypeId (ListScheduler::GetTypeId ());
 
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SimulatorBatchTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SchedulerRandomTestCase (factory), TestCase::QUICK);
     factory.SetTypeId (MapScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SimulatorBatchTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SchedulerRandomTestCase (factory), TestCase::QUICK);
     factory.SetTypeId (HeapScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SimulatorBatchTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SchedulerRandomTestCase (factory), TestCase::QUICK);
     factory.SetTypeId (CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SimulatorBatchTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SchedulerRandomTestCase (factory), TestCase::QUICK);
     factory.SetTypeId (PriorityQueueScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SimulatorBatchTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SchedulerRandomTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SimulatorBatchTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SchedulerRandomTestCase (factory), TestCase::QUICK);
+    AddTestCase (new EventImplPoolTestCase (), TestCase::QUICK);
+    AddTestCase (new EventProfilerTestCase (), TestCase::QUICK);
   }
 } g_simulatorTestSuite;
@@ -26,12 +26,14 @@
 #include "ns3/config.h"
 #include "ns3/string.h"
 #include "ns3/system-thread.h"
+#include "ns3/make-event.h"
 
 #include <chrono>  // seconds, milliseconds
 #include <ctime>
 #include <list>
 #include <thread>  // sleep_for
 #include <utility>
+#include <vector>
 
 using namespace ns3;
 
@@ -225,6 +227,134 @@ ThreadedSimulatorEventsTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (m_a, m_d, "Bad scheduling");
 }
 
+class ThreadedSimulatorStressTestCase : public TestCase
+{
+public:
+  ThreadedSimulatorStressTestCase (const std::string &simulatorType, unsigned int threads);
+  static void ProducerThread (std::pair<ThreadedSimulatorStressTestCase *, unsigned int> context);
+  void Receive (unsigned int threadno, uint32_t sequence);
+  void Poll (void);
+  unsigned int m_threads;
+  std::string m_simulatorType;
+  std::string m_error;
+  uint32_t m_next[MAXTHREADS];
+  uint64_t m_received;
+  std::list<Ptr<SystemThread> > m_threadlist;
+
+private:
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+};
+
+/** Number of events scheduled by each producer thread. */
+static const uint32_t STRESS_EVENTS = 20000;
+/** Size of the batches scheduled by the producer threads. */
+static const uint32_t STRESS_BATCH = 10;
+
+ThreadedSimulatorStressTestCase::ThreadedSimulatorStressTestCase (const std::string &simulatorType, unsigned int threads)
+  : TestCase ("Check that " + std::to_string (threads) + " threads scheduling events as fast as "
+              "they can lose none and keep their order, in " + simulatorType),
+    m_threads (threads),
+    m_simulatorType (simulatorType)
+{}
+
+void
+ThreadedSimulatorStressTestCase::ProducerThread (std::pair<ThreadedSimulatorStressTestCase *, unsigned int> context)
+{
+  ThreadedSimulatorStressTestCase *me = context.first;
+  unsigned int threadno = context.second;
+
+  uint32_t sequence = 0;
+  while (sequence < STRESS_EVENTS)
+    {
+      // alternate single events and batches
+      if ((sequence / STRESS_BATCH) % 2 == 0)
+        {
+          Simulator::ScheduleWithContext (threadno, Time (0),
+                                          &ThreadedSimulatorStressTestCase::Receive, me, threadno, sequence);
+          sequence++;
+        }
+      else
+        {
+          std::vector<Simulator::ContextEvent> events;
+          for (uint32_t i = 0; i < STRESS_BATCH; i++)
+            {
+              Simulator::ContextEvent event;
+              event.context = threadno;
+              event.delay = Time (0);
+              event.event = MakeEvent (&ThreadedSimulatorStressTestCase::Receive, me, threadno, sequence);
+              events.push_back (event);
+              sequence++;
+            }
+          Simulator::ScheduleBatchWithContext (events);
+        }
+    }
+}
+
+void
+ThreadedSimulatorStressTestCase::Receive (unsigned int threadno, uint32_t sequence)
+{
+  if (sequence != m_next[threadno] || Simulator::GetContext () != threadno)
+    {
+      m_error = "Event from thread " + std::to_string (threadno) + " lost or out of order";
+    }
+  m_next[threadno] = sequence + 1;
+  m_received++;
+}
+
+void
+ThreadedSimulatorStressTestCase::Poll (void)
+{
+  if (m_received < uint64_t (m_threads) * STRESS_EVENTS && m_error.empty ())
+    {
+      Simulator::Schedule (MicroSeconds (1), &ThreadedSimulatorStressTestCase::Poll, this);
+    }
+  else
+    {
+      // the realtime simulator does not stop by itself
+      Simulator::Stop ();
+    }
+}
+
+void
+ThreadedSimulatorStressTestCase::DoTeardown (void)
+{
+  m_threadlist.clear ();
+
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
+void
+ThreadedSimulatorStressTestCase::DoRun (void)
+{
+  Config::SetGlobal ("SimulatorImplementationType", StringValue (m_simulatorType));
+  m_error = "";
+  m_received = 0;
+  for (unsigned int i = 0; i < m_threads; ++i)
+    {
+      m_next[i] = 0;
+      m_threadlist.push_back (
+        Create<SystemThread> (MakeBoundCallback (
+                                &ThreadedSimulatorStressTestCase::ProducerThread,
+                                std::pair<ThreadedSimulatorStressTestCase *, unsigned int> (this, i) )) );
+    }
+
+  Simulator::Schedule (MicroSeconds (1), &ThreadedSimulatorStressTestCase::Poll, this);
+  for (std::list<Ptr<SystemThread> >::iterator it = m_threadlist.begin (); it != m_threadlist.end (); ++it)
+    {
+      (*it)->Start ();
+    }
+  Simulator::Run ();
+  for (std::list<Ptr<SystemThread> >::iterator it = m_threadlist.begin (); it != m_threadlist.end (); ++it)
+    {
+      (*it)->Join ();
+    }
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_error.empty (), true, m_error.c_str ());
+  NS_TEST_EXPECT_MSG_EQ (m_received, uint64_t (m_threads) * STRESS_EVENTS, "Lost events");
+}
+
 class ThreadedSimulatorTestSuite : public TestSuite
 {
 public:
@@ -241,7 +371,8 @@ public:
       "ns3::ListScheduler",
       "ns3::HeapScheduler",
       "ns3::MapScheduler",
-      "ns3::CalendarScheduler"
+      "ns3::CalendarScheduler",
+      "ns3::LadderScheduler"
     };
     unsigned int threadcounts[] = {
       0,
@@ -261,6 +392,7 @@ public:
                 AddTestCase (new ThreadedSimulatorEventsTestCase (factory, simulatorTypes[i], threadcounts[j]), TestCase::QUICK);
               }
           }
+        AddTestCase (new ThreadedSimulatorStressTestCase (simulatorTypes[i], 8), TestCase::QUICK);
       }
   }
 } g_threadedSimulatorTestSuite;
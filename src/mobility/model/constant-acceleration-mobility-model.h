@@ -27,6 +27,13 @@ namespace ns3 {
  * \ingroup mobility
  *
  * \brief Mobility model for which the current acceleration does not change once it has been set and until it is set again explicitly to a new value.
+ *
+ * The position is evaluated on demand from the start of the current
+ * segment, so the model schedules no events. A client that integrates its
+ * own trajectory can call StartSegment () once per integration step (or
+ * once per straight or parabolic piece of the trajectory) instead of
+ * queueing one ns3::Waypoint per step in a WaypointMobilityModel, which
+ * schedules an update event for every waypoint.
  */
 class ConstantAccelerationMobilityModel : public MobilityModel 
 {
@@ -48,6 +55,15 @@ public:
    * \param acceleration the acceleration (m/s^2)
    */
   void SetVelocityAndAcceleration (const Vector &velocity, const Vector &acceleration);
+  /**
+   * Start a new trajectory segment at the current time. Unlike calling
+   * SetPosition () followed by SetVelocityAndAcceleration (), the course
+   * change is only notified once.
+   * \param position the position at the start of the segment (m)
+   * \param velocity the velocity at the start of the segment (m/s)
+   * \param acceleration the acceleration during the segment (m/s^2)
+   */
+  void StartSegment (const Vector &position, const Vector &velocity, const Vector &acceleration);
 
 private:
   virtual Vector DoGetPosition (void) const;
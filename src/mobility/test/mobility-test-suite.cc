@@ -30,6 +30,7 @@
 #include "ns3/vector.h"
 #include "ns3/mobility-model.h"
 #include "ns3/waypoint-mobility-model.h"
+#include "ns3/constant-acceleration-mobility-model.h"
 #include "ns3/mobility-helper.h"
 
 using namespace ns3;
@@ -410,6 +411,96 @@ WaypointMobilityModelViaHelper::DoRun (void)
   Simulator::Destroy ();
 }
 
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Test that trajectory segments are evaluated on demand, with one
+ * course change per segment and no scheduled events
+ */
+class ConstantAccelerationSegments : public TestCase
+{
+public:
+  ConstantAccelerationSegments ();
+  virtual ~ConstantAccelerationSegments ();
+
+private:
+  /**
+   * Check the position and the number of course changes so far
+   * \param expectedPos the expected position
+   * \param expectedCourseChanges the expected number of course changes
+   */
+  void TestPosition (Vector expectedPos, int expectedCourseChanges);
+  /**
+   * Start a segment in the mobility model
+   * \param position the position at the start of the segment
+   * \param velocity the velocity at the start of the segment
+   * \param acceleration the acceleration during the segment
+   */
+  void StartSegment (Vector position, Vector velocity, Vector acceleration);
+  /**
+   * Course change callback
+   * \param model the mobility model
+   */
+  void CourseChangeCallback (Ptr<const MobilityModel> model);
+  virtual void DoRun (void);
+  Ptr<ConstantAccelerationMobilityModel> m_mob; ///< mobility model
+  int m_courseChanges; ///< course changes
+};
+
+ConstantAccelerationSegments::ConstantAccelerationSegments ()
+  : TestCase ("Test trajectory segments of ConstantAccelerationMobilityModel"),
+    m_courseChanges (0)
+{
+}
+
+ConstantAccelerationSegments::~ConstantAccelerationSegments ()
+{
+}
+
+void
+ConstantAccelerationSegments::TestPosition (Vector expectedPos, int expectedCourseChanges)
+{
+  Vector pos = m_mob->GetPosition ();
+  NS_TEST_EXPECT_MSG_EQ_TOL (pos.x, expectedPos.x, 0.001, "X position not equal");
+  NS_TEST_EXPECT_MSG_EQ_TOL (pos.y, expectedPos.y, 0.001, "Y position not equal");
+  NS_TEST_EXPECT_MSG_EQ_TOL (pos.z, expectedPos.z, 0.001, "Z position not equal");
+  NS_TEST_EXPECT_MSG_EQ (m_courseChanges, expectedCourseChanges, "Wrong number of course changes");
+}
+
+void
+ConstantAccelerationSegments::StartSegment (Vector position, Vector velocity, Vector acceleration)
+{
+  m_mob->StartSegment (position, velocity, acceleration);
+}
+
+void
+ConstantAccelerationSegments::CourseChangeCallback (Ptr<const MobilityModel> model)
+{
+  m_courseChanges++;
+}
+
+void
+ConstantAccelerationSegments::DoRun (void)
+{
+  m_mob = CreateObject<ConstantAccelerationMobilityModel> ();
+  m_mob->TraceConnectWithoutContext ("CourseChange",
+                                     MakeCallback (&ConstantAccelerationSegments::CourseChangeCallback, this));
+
+  StartSegment (Vector (1.0, 2.0, 3.0), Vector (1.0, 0.0, -1.0), Vector (0.0, 2.0, 0.0));
+  NS_TEST_EXPECT_MSG_EQ (Simulator::IsFinished (), true, "Segments must not schedule events");
+  // x = 1 + t, y = 2 + t^2, z = 3 - t
+  Simulator::Schedule (Seconds (2.0), &ConstantAccelerationSegments::TestPosition, this,
+                       Vector (3.0, 6.0, 1.0), 1);
+  // A new segment starts from the given position, not from the current one
+  Simulator::Schedule (Seconds (3.0), &ConstantAccelerationSegments::StartSegment, this,
+                       Vector (0.0, 0.0, 0.0), Vector (0.0, 0.0, 2.0), Vector (0.0, 0.0, 0.0));
+  Simulator::Schedule (Seconds (4.5), &ConstantAccelerationSegments::TestPosition, this,
+                       Vector (0.0, 0.0, 3.0), 2);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
 /**
  * \ingroup mobility-test
  * \ingroup tests
@@ -429,6 +520,7 @@ MobilityTestSuite::MobilityTestSuite ()
   AddTestCase (new WaypointLazyNotifyTrue, TestCase::QUICK);
   AddTestCase (new WaypointInitialPositionIsWaypoint, TestCase::QUICK);
   AddTestCase (new WaypointMobilityModelViaHelper, TestCase::QUICK);
+  AddTestCase (new ConstantAccelerationSegments, TestCase::QUICK);
 }
 
 static MobilityTestSuite mobilityTestSuite; ///< the test suite
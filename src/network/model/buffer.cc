@@ -20,6 +20,7 @@
 #include "buffer.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include <atomic>
 
 #define LOG_INTERNAL_STATE(y)                                                                    \
   NS_LOG_LOGIC (y << "start="<<m_start<<", end="<<m_end<<", zero start="<<m_zeroAreaStart<<              \
@@ -50,96 +51,164 @@ namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("Buffer");
 
 
-uint32_t Buffer::g_recommendedStart = 0;
+namespace {
+
+/**
+ * location in a newly-allocated buffer where you should start
+ * writing data. i.e., m_start should be initialized to this
+ * value.  Learned separately by each thread.
+ */
+thread_local uint32_t g_recommendedStart = 0;
+
+/** Bytes of storage allocated from the heap by all threads. */
+std::atomic<uint64_t> g_heapBytes (0);
+/** Largest value of g_heapBytes. */
+std::atomic<uint64_t> g_peakHeapBytes (0);
+
 #ifdef BUFFER_FREE_LIST
-/* The following macros are pretty evil but they are needed to allow us to
- * keep track of 3 possible states for the g_freeList variable:
- *  - uninitialized means that no one has created a buffer yet
- *    so no one has created the associated free list (it is created
- *    on-demand when the first buffer is created)
- *  - initialized means that the free list exists and is valid
- *  - destroyed means that the static destructors of this compilation unit
- *    have run so, the free list has been cleared from its content
- * The key is that in destroyed state, we are careful not re-create it
- * which is a typical weakness of lazy evaluation schemes which use 
- * '0' as a special value to indicate both un-initialized and destroyed.
- * Note that it is important to use '0' as the marker for un-initialized state
- * because the variable holding this state information is initialized to zero
- * which the compiler assigns to zero-memory which is initialized to _zero_
- * before the constructors run so this ensures perfect handling of crazy 
- * constructor orderings.
+/** The smallest size class is 2^POOL_MIN_SHIFT bytes. */
+const uint32_t POOL_MIN_SHIFT = 6;
+/** Number of size classes, from 64 bytes to 64 kilobytes. */
+const uint32_t POOL_CLASSES = 11;
+/**
+ * Each thread keeps free storage of each class up to this many bytes,
+ * or POOL_MIN_FREE blocks for the largest classes.
  */
-#define MAGIC_DESTROYED (~(long) 0)
-#define IS_UNINITIALIZED(x) (x == (Buffer::FreeList*)0)
-#define IS_DESTROYED(x) (x == (Buffer::FreeList*)MAGIC_DESTROYED)
-#define IS_INITIALIZED(x) (!IS_UNINITIALIZED (x) && !IS_DESTROYED (x))
-#define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
-#define UNINITIALIZED ((Buffer::FreeList*)0)
-uint32_t Buffer::g_maxSize = 0;
-Buffer::FreeList *Buffer::g_freeList = 0;
-struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
-
-Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
+const uint32_t POOL_MAX_FREE_BYTES = 1 << 20;
+/** Smallest number of free blocks kept per class. */
+const uint32_t POOL_MIN_FREE = 16;
+
+/** A free block, linked to the next one of its class. */
+struct PoolBlock
 {
-  NS_LOG_FUNCTION (this);
-  if (IS_INITIALIZED (g_freeList))
-    {
-      for (Buffer::FreeList::iterator i = g_freeList->begin ();
-           i != g_freeList->end (); i++)
-        {
-          Buffer::Deallocate (*i);
-        }
-      delete g_freeList;
-      g_freeList = DESTROYED;
-    }
+  PoolBlock *next;  //!< Next free block.
+};
+
+/** A list of free blocks. */
+struct PoolList
+{
+  PoolBlock *head;  //!< First block.
+  uint32_t count;   //!< Number of blocks.
+};
+
+/**
+ * Free blocks of the calling thread.  A plain aggregate, so that it
+ * is still usable when buffers are destroyed during thread or program
+ * exit.
+ */
+thread_local PoolList g_free[POOL_CLASSES];
+/** Set once the free blocks of the calling thread were released. */
+thread_local bool g_exited = false;
+/** Max observed data size in the calling thread, up to the largest class. */
+thread_local uint32_t g_maxSize = 0;
+/** Storages created by the calling thread. */
+thread_local uint64_t g_created = 0;
+/** Storages created from the free lists by the calling thread. */
+thread_local uint64_t g_reused = 0;
+/** Bytes held in the free lists of the calling thread. */
+thread_local uint64_t g_cachedBytes = 0;
+
+/**
+ * Get the size of the blocks of a class.
+ * \param index the size class
+ * \returns the size of its blocks
+ */
+uint32_t
+PoolBlockSize (uint32_t index)
+{
+  return 1U << (index + POOL_MIN_SHIFT);
 }
 
+/** Releases the free blocks of a thread when it exits. */
+struct PoolGuard
+{
+  ~PoolGuard ()
+  {
+    for (uint32_t i = 0; i < POOL_CLASSES; i++)
+      {
+        while (g_free[i].head != 0)
+          {
+            PoolBlock *block = g_free[i].head;
+            g_free[i].head = block->next;
+            delete [] reinterpret_cast<uint8_t *> (block);
+            g_heapBytes.fetch_sub (PoolBlockSize (i), std::memory_order_relaxed);
+          }
+        g_free[i].count = 0;
+      }
+    g_cachedBytes = 0;
+    g_exited = true;
+  }
+};
+#endif /* BUFFER_FREE_LIST */
+
+} // unnamed namespace
+
+#ifdef BUFFER_FREE_LIST
 void
 Buffer::Recycle (struct Buffer::Data *data)
 {
   NS_LOG_FUNCTION (data);
   NS_ASSERT (data->m_count == 0);
-  NS_ASSERT (!IS_UNINITIALIZED (g_freeList));
-  g_maxSize = std::max (g_maxSize, data->m_size);
-  /* feed into free list */
-  if (data->m_size < g_maxSize ||
-      IS_DESTROYED (g_freeList) ||
-      g_freeList->size () > 1000)
+  // Pooled storage is exactly the size of its class
+  uint32_t total = data->m_size - 1 + sizeof (struct Buffer::Data);
+  if (g_exited || total > PoolBlockSize (POOL_CLASSES - 1))
     {
       Buffer::Deallocate (data);
+      return;
     }
-  else
+  g_maxSize = std::max (g_maxSize, data->m_size);
+  uint32_t index = 0;
+  while (PoolBlockSize (index) < total)
     {
-      NS_ASSERT (IS_INITIALIZED (g_freeList));
-      g_freeList->push_back (data);
+      index++;
     }
+  PoolList &list = g_free[index];
+  if (list.count >= std::max (POOL_MIN_FREE, POOL_MAX_FREE_BYTES / total))
+    {
+      Buffer::Deallocate (data);
+      return;
+    }
+  // The first recycled storage of each thread arranges for its free
+  // blocks to be released when it exits
+  static thread_local PoolGuard guard;
+  PoolBlock *block = reinterpret_cast<PoolBlock *> (data);
+  block->next = list.head;
+  list.head = block;
+  list.count++;
+  g_cachedBytes += total;
 }
 
 Buffer::Data *
 Buffer::Create (uint32_t dataSize)
 {
   NS_LOG_FUNCTION (dataSize);
-  /* try to find a buffer correctly sized. */
-  if (IS_UNINITIALIZED (g_freeList))
+  g_created++;
+  /* use the maximum size ever used, rounded up to its size class. */
+  uint32_t size = std::max (std::max (dataSize, g_maxSize), 1U);
+  uint32_t total = size - 1 + sizeof (struct Buffer::Data);
+  if (total > PoolBlockSize (POOL_CLASSES - 1))
     {
-      g_freeList = new Buffer::FreeList ();
+      return Buffer::Allocate (dataSize);
     }
-  else if (IS_INITIALIZED (g_freeList))
+  uint32_t index = 0;
+  while (PoolBlockSize (index) < total)
     {
-      while (!g_freeList->empty ()) 
-        {
-          struct Buffer::Data *data = g_freeList->back ();
-          g_freeList->pop_back ();
-          if (data->m_size >= dataSize) 
-            {
-              data->m_count = 1;
-              return data;
-            }
-          Buffer::Deallocate (data);
-        }
+      index++;
     }
-  struct Buffer::Data *data = Buffer::Allocate (dataSize);
-  NS_ASSERT (data->m_count == 1);
+  uint32_t capacity = PoolBlockSize (index) + 1 - sizeof (struct Buffer::Data);
+  PoolList &list = g_free[index];
+  if (list.head == 0)
+    {
+      return Buffer::Allocate (capacity);
+    }
+  PoolBlock *block = list.head;
+  list.head = block->next;
+  list.count--;
+  g_cachedBytes -= PoolBlockSize (index);
+  g_reused++;
+  struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data *> (block);
+  data->m_size = capacity;
+  data->m_count = 1;
   return data;
 }
 #else /* BUFFER_FREE_LIST */
@@ -170,6 +239,12 @@ Buffer::Allocate (uint32_t reqSize)
   NS_ASSERT (reqSize >= 1);
   uint32_t size = reqSize - 1 + sizeof (struct Buffer::Data);
   uint8_t *b = new uint8_t [size];
+  uint64_t heapBytes = g_heapBytes.fetch_add (size, std::memory_order_relaxed) + size;
+  uint64_t peak = g_peakHeapBytes.load (std::memory_order_relaxed);
+  while (heapBytes > peak
+         && !g_peakHeapBytes.compare_exchange_weak (peak, heapBytes, std::memory_order_relaxed))
+    {
+    }
   struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data*>(b);
   data->m_size = reqSize;
   data->m_count = 1;
@@ -181,10 +256,29 @@ Buffer::Deallocate (struct Buffer::Data *data)
 {
   NS_LOG_FUNCTION (data);
   NS_ASSERT (data->m_count == 0);
+  g_heapBytes.fetch_sub (data->m_size - 1 + sizeof (struct Buffer::Data), std::memory_order_relaxed);
   uint8_t *buf = reinterpret_cast<uint8_t *> (data);
   delete [] buf;
 }
 
+Buffer::AllocatorStats
+Buffer::GetAllocatorStats (void)
+{
+  AllocatorStats stats;
+#ifdef BUFFER_FREE_LIST
+  stats.created = g_created;
+  stats.reused = g_reused;
+  stats.cachedBytes = g_cachedBytes;
+#else
+  stats.created = 0;
+  stats.reused = 0;
+  stats.cachedBytes = 0;
+#endif
+  stats.heapBytes = g_heapBytes.load (std::memory_order_relaxed);
+  stats.peakHeapBytes = g_peakHeapBytes.load (std::memory_order_relaxed);
+  return stats;
+}
+
 Buffer::Buffer ()
 {
   NS_LOG_FUNCTION (this);
@@ -206,6 +300,19 @@ Buffer::Buffer (uint32_t dataSize, bool initialize)
     }
 }
 
+Buffer::Buffer (Ptr<const PayloadBlock> block, uint32_t offset, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << block << offset << size);
+  NS_ASSERT (offset <= block->GetSize () && size <= block->GetSize () - offset);
+  Initialize (size);
+  if (size > 0)
+    {
+      m_payload = block;
+      m_payloadStart = offset;
+    }
+  NS_ASSERT (CheckInternalState ());
+}
+
 bool
 Buffer::CheckInternalState (void) const
 {
@@ -226,7 +333,9 @@ Buffer::CheckInternalState (void) const
     m_start <= m_data->m_size &&
     m_zeroAreaStart <= m_data->m_size;
 
-  bool ok = m_data->m_count > 0 && offsetsOk && dirtyOk && internalSizeOk;
+  bool payloadOk = m_payload == 0 ||
+    m_payloadStart + (m_zeroAreaEnd - m_zeroAreaStart) <= m_payload->GetSize ();
+  bool ok = m_data->m_count > 0 && offsetsOk && dirtyOk && internalSizeOk && payloadOk;
   if (!ok)
     {
       LOG_INTERNAL_STATE ("check " << this << 
@@ -252,6 +361,8 @@ Buffer::Initialize (uint32_t zeroSize)
   m_end = m_zeroAreaEnd;
   m_data->m_dirtyStart = m_start;
   m_data->m_dirtyEnd = m_end;
+  m_payload = 0;
+  m_payloadStart = 0;
   NS_ASSERT (CheckInternalState ());
 }
 
@@ -262,8 +373,7 @@ Buffer::operator = (Buffer const&o)
   if (m_data != o.m_data) 
     {
       // not assignment to self.
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (--m_data->m_count == 0)
         {
           Recycle (m_data);
         }
@@ -276,6 +386,8 @@ Buffer::operator = (Buffer const&o)
   m_zeroAreaEnd = o.m_zeroAreaEnd;
   m_start = o.m_start;
   m_end = o.m_end;
+  m_payload = o.m_payload;
+  m_payloadStart = o.m_payloadStart;
   NS_ASSERT (CheckInternalState ());
   return *this;
 }
@@ -285,8 +397,7 @@ Buffer::~Buffer ()
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
   g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (--m_data->m_count == 0)
     {
       Recycle (m_data);
     }
@@ -310,7 +421,12 @@ Buffer::AddAtStart (uint32_t start)
 {
   NS_LOG_FUNCTION (this << start);
   NS_ASSERT (CheckInternalState ());
+#ifdef ENABLE_THREAD_SAFE_OBJECTS
+  // Copies in other threads may extend the shared data at the same time
+  bool isDirty = m_data->m_count > 1;
+#else
   bool isDirty = m_data->m_count > 1 && m_start > m_data->m_dirtyStart;
+#endif
   if (m_start >= start && !isDirty)
     {
       /* enough space in the buffer and not dirty. 
@@ -328,8 +444,7 @@ Buffer::AddAtStart (uint32_t start)
       uint32_t newSize = GetInternalSize () + start;
       struct Buffer::Data *newData = Buffer::Create (newSize);
       memcpy (newData->m_data + start, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0)
+      if (--m_data->m_count == 0)
         {
           Buffer::Recycle (m_data);
         }
@@ -355,7 +470,12 @@ Buffer::AddAtEnd (uint32_t end)
 {
   NS_LOG_FUNCTION (this << end);
   NS_ASSERT (CheckInternalState ());
+#ifdef ENABLE_THREAD_SAFE_OBJECTS
+  // Copies in other threads may extend the shared data at the same time
+  bool isDirty = m_data->m_count > 1;
+#else
   bool isDirty = m_data->m_count > 1 && m_end < m_data->m_dirtyEnd;
+#endif
   if (GetInternalEnd () + end <= m_data->m_size && !isDirty)
     {
       /* enough space in buffer and not dirty
@@ -373,8 +493,7 @@ Buffer::AddAtEnd (uint32_t end)
       uint32_t newSize = GetInternalSize () + end;
       struct Buffer::Data *newData = Buffer::Create (newSize);
       memcpy (newData->m_data, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (--m_data->m_count == 0)
         {
           Buffer::Recycle (m_data);
         }
@@ -401,6 +520,8 @@ Buffer::AddAtEnd (const Buffer &o)
 {
   NS_LOG_FUNCTION (this << &o);
   if (m_data->m_count == 1 &&
+      m_payload == 0 &&
+      o.m_payload == 0 &&
       m_end == m_zeroAreaEnd &&
       m_end == m_data->m_dirtyEnd &&
       o.m_start == o.m_zeroAreaStart &&
@@ -454,6 +575,7 @@ Buffer::RemoveAtStart (uint32_t start)
       m_start = m_zeroAreaStart;
       m_zeroAreaEnd -= delta;
       m_end -= delta;
+      m_payloadStart += delta;
     } 
   else if (newStart <= m_end)
     {
@@ -475,6 +597,10 @@ Buffer::RemoveAtStart (uint32_t start)
       m_zeroAreaEnd = m_end;
       m_zeroAreaStart = m_end;
     }
+  if (m_zeroAreaStart == m_zeroAreaEnd)
+    {
+      m_payload = 0;
+    }
   m_maxZeroAreaStart = std::max (m_maxZeroAreaStart, m_zeroAreaStart);
   LOG_INTERNAL_STATE ("rem start=" << start << ", ");
   NS_ASSERT (CheckInternalState ());
@@ -510,6 +636,10 @@ Buffer::RemoveAtEnd (uint32_t end)
       m_zeroAreaEnd = m_start;
       m_zeroAreaStart = m_start;
     }
+  if (m_zeroAreaStart == m_zeroAreaEnd)
+    {
+      m_payload = 0;
+    }
   m_maxZeroAreaStart = std::max (m_maxZeroAreaStart, m_zeroAreaStart);
   LOG_INTERNAL_STATE ("rem end=" << end << ", ");
   NS_ASSERT (CheckInternalState ());
@@ -536,7 +666,14 @@ Buffer::CreateFullCopy (void) const
     {
       Buffer tmp;
       tmp.AddAtStart (m_zeroAreaEnd - m_zeroAreaStart);
-      tmp.Begin ().WriteU8 (0, m_zeroAreaEnd - m_zeroAreaStart);
+      if (m_payload != 0)
+        {
+          tmp.Begin ().Write (m_payload->GetData () + m_payloadStart, m_zeroAreaEnd - m_zeroAreaStart);
+        }
+      else
+        {
+          tmp.Begin ().WriteU8 (0, m_zeroAreaEnd - m_zeroAreaStart);
+        }
       uint32_t dataStart = m_zeroAreaStart - m_start;
       tmp.AddAtStart (dataStart);
       tmp.Begin ().Write (m_data->m_data+m_start, dataStart);
@@ -556,6 +693,11 @@ uint32_t
 Buffer::GetSerializedSize (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_payload != 0)
+    {
+      // the bytes of the block are serialized as real bytes
+      return CreateFullCopy ().GetSerializedSize ();
+    }
   uint32_t dataStart = (m_zeroAreaStart - m_start + 3) & (~0x3);
   uint32_t dataEnd = (m_end - m_zeroAreaEnd + 3) & (~0x3);
 
@@ -576,6 +718,10 @@ uint32_t
 Buffer::Serialize (uint8_t* buffer, uint32_t maxSize) const
 {
   NS_LOG_FUNCTION (this << &buffer << maxSize);
+  if (m_payload != 0)
+    {
+      return CreateFullCopy ().Serialize (buffer, maxSize);
+    }
   uint32_t* p = reinterpret_cast<uint32_t *> (buffer);
   uint32_t size = 0;
 
@@ -711,6 +857,27 @@ Buffer::PeekData (void) const
   return m_data->m_data + m_start;
 }
 
+uint8_t const*
+Buffer::PeekContiguousData (uint32_t start, uint32_t size) const
+{
+  NS_LOG_FUNCTION (this << start << size);
+  NS_ASSERT (start <= GetSize () && size <= GetSize () - start);
+  uint32_t current = m_start + start;
+  if (current + size <= m_zeroAreaStart)
+    {
+      return m_data->m_data + current;
+    }
+  else if (current >= m_zeroAreaEnd)
+    {
+      return m_data->m_data + current - (m_zeroAreaEnd - m_zeroAreaStart);
+    }
+  else if (m_payload != 0 && current >= m_zeroAreaStart && current + size <= m_zeroAreaEnd)
+    {
+      return m_payload->GetData () + m_payloadStart + (current - m_zeroAreaStart);
+    }
+  return 0;
+}
+
 void
 Buffer::CopyData (std::ostream *os, uint32_t size) const
 {
@@ -724,6 +891,11 @@ Buffer::CopyData (std::ostream *os, uint32_t size) const
           size -= m_zeroAreaStart-m_start;
           tmpsize = std::min (m_zeroAreaEnd - m_zeroAreaStart, size);
           uint32_t left = tmpsize;
+          if (m_payload != 0)
+            {
+              os->write ((const char*)(m_payload->GetData () + m_payloadStart), left);
+              left = 0;
+            }
           while (left > 0)
             {
               uint32_t toWrite = std::min (left, g_zeroes.size);
@@ -755,6 +927,12 @@ Buffer::CopyData (uint8_t *buffer, uint32_t size) const
         { 
           tmpsize = std::min (m_zeroAreaEnd - m_zeroAreaStart, size);
           uint32_t left = tmpsize;
+          if (m_payload != 0)
+            {
+              memcpy (buffer, m_payload->GetData () + m_payloadStart, left);
+              buffer += left;
+              left = 0;
+            }
           while (left > 0)
             {
               uint32_t toWrite = std::min (left, g_zeroes.size);
@@ -854,7 +1032,14 @@ Buffer::Iterator::Write (Iterator start, Iterator end)
   if (start.m_current <= start.m_zeroEnd)
     {
       uint32_t toCopy = std::min (size, start.m_zeroEnd - start.m_current);
-      memset (&m_data[m_current], 0, toCopy);
+      if (start.m_payload != 0 && toCopy > 0)
+        {
+          memcpy (&m_data[m_current], &start.m_payload[start.m_current - start.m_zeroStart], toCopy);
+        }
+      else
+        {
+          memset (&m_data[m_current], 0, toCopy);
+        }
       start.m_current += toCopy;
       m_current += toCopy;
       size -= toCopy;
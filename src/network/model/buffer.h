@@ -24,6 +24,9 @@
 #include <vector>
 #include <ostream>
 #include "ns3/assert.h"
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "payload-block.h"
 
 #define BUFFER_FREE_LIST 1
 
@@ -42,6 +45,12 @@ namespace ns3 {
  * The correct maximum size is learned at runtime during use by 
  * recording the maximum size of each packet.
  *
+ * The data storage of the buffers comes in size classes of powers of
+ * two bytes, from 64 bytes to 64 kilobytes, and is recycled through
+ * free lists kept per thread, so that buffers can be created and
+ * destroyed concurrently by several threads, each running its own
+ * simulation.  Larger storage is allocated from the heap.
+ *
  * \internal
  * The implementation of the Buffer class uses a COW (Copy On Write)
  * technique to ensure that the underlying data buffer which holds
@@ -88,6 +97,11 @@ namespace ns3 {
  * \endverbatim
  *
  * A simple state invariant is that m_start <= m_zeroStart <= m_zeroEnd <= m_end
+ *
+ * The virtual area may also reference the bytes of a PayloadBlock
+ * instead of zero bytes: the bytes are then read from the block, and
+ * shared without copying by all the Buffer instances created from
+ * this one, until the user fragments or concatenates buffers.
  */
 class Buffer 
 {
@@ -482,6 +496,12 @@ private:
      * to this pointer.
      */
     uint8_t *m_data;
+    /**
+     * a pointer to the bytes of the virtual area, or zero if it holds
+     * zero bytes. Offsets in the virtual area are relative to
+     * m_zeroStart.
+     */
+    uint8_t const *m_payload;
   };
 
   /**
@@ -500,6 +520,18 @@ private:
    */
   uint8_t const*PeekData (void) const;
 
+  /**
+   * \param start offset from the start of the buffer
+   * \param size number of bytes
+   * \return a pointer to the bytes [start, start + size) of the buffer
+   * if they are contiguous in memory, or zero otherwise.
+   *
+   * Unlike PeekData, this method never copies the buffer: bytes in
+   * the virtual area are only contiguous when it references a
+   * PayloadBlock.
+   */
+  uint8_t const*PeekContiguousData (uint32_t start, uint32_t size) const;
+
   /**
    * \param start size to reserve
    *
@@ -641,7 +673,36 @@ private:
    * \param initialize initialize the buffer with zeroes.
    */
   Buffer (uint32_t dataSize, bool initialize);
+  /**
+   * \brief Constructor
+   *
+   * The buffer will reference bytes of a block as its virtual area,
+   * without copying them.
+   *
+   * \param block the block
+   * \param offset the offset of the bytes in the block
+   * \param size the number of bytes
+   */
+  Buffer (Ptr<const PayloadBlock> block, uint32_t offset, uint32_t size);
   ~Buffer ();
+
+  /**
+   * \brief Memory usage of the buffer data storage.
+   */
+  struct AllocatorStats
+  {
+    uint64_t created;       //!< storages created by the calling thread
+    uint64_t reused;        //!< storages created by the calling thread from its free lists
+    uint64_t cachedBytes;   //!< bytes held in the free lists of the calling thread
+    uint64_t heapBytes;     //!< bytes of storage allocated from the heap by all threads, in use or cached
+    uint64_t peakHeapBytes; //!< largest value of heapBytes
+  };
+
+  /**
+   * \brief Get the memory usage of the buffer data storage.
+   * \returns the memory usage
+   */
+  static AllocatorStats GetAllocatorStats (void);
 private:
   /**
    * This data structure is variable-sized through its last member whose size
@@ -663,7 +724,7 @@ private:
      * The reference count of an instance of this data structure.
      * Each buffer which references an instance holds a count.
      */
-    uint32_t m_count;
+    ReferenceCount m_count;
     /**
      * the size of the m_data field below.
      */
@@ -762,12 +823,6 @@ private:
    * m_zeroAreaStart.
    */
   uint32_t m_maxZeroAreaStart;
-  /**
-   * location in a newly-allocated buffer where you should start
-   * writing data. i.e., m_start should be initialized to this 
-   * value.
-   */
-  static uint32_t g_recommendedStart;
 
   /**
    * offset to the start of the virtual zero area from the start
@@ -789,19 +844,16 @@ private:
    * instance from the start of m_data->m_data
    */
   uint32_t m_end;
+  /**
+   * the block referenced by the virtual area, or zero if it holds
+   * zero bytes
+   */
+  Ptr<const PayloadBlock> m_payload;
+  /**
+   * offset in m_payload of the byte at m_zeroAreaStart
+   */
+  uint32_t m_payloadStart;
 
-#ifdef BUFFER_FREE_LIST
-  /// Container for buffer data
-  typedef std::vector<struct Buffer::Data*> FreeList;
-  /// Local static destructor structure
-  struct LocalStaticDestructor 
-  {
-    ~LocalStaticDestructor ();
-  };
-  static uint32_t g_maxSize; //!< Max observed data size
-  static FreeList *g_freeList; //!< Buffer data container
-  static struct LocalStaticDestructor g_localStaticDestructor; //!< Local static destructor
-#endif
 };
 
 } // namespace ns3
@@ -817,7 +869,8 @@ Buffer::Iterator::Iterator ()
     m_dataStart (0),
     m_dataEnd (0),
     m_current (0),
-    m_data (0)
+    m_data (0),
+    m_payload (0)
 {
 }
 Buffer::Iterator::Iterator (Buffer const*buffer)
@@ -839,6 +892,7 @@ Buffer::Iterator::Construct (const Buffer *buffer)
   m_dataStart = buffer->m_start;
   m_dataEnd = buffer->m_end;
   m_data = buffer->m_data->m_data;
+  m_payload = buffer->m_payload == 0 ? 0 : buffer->m_payload->GetData () + buffer->m_payloadStart;
 }
 
 void 
@@ -1008,7 +1062,7 @@ Buffer::Iterator::PeekU8 (void)
     }
   else if (m_current < m_zeroEnd)
     {
-      return 0;
+      return m_payload == 0 ? 0 : m_payload[m_current - m_zeroStart];
     }
   else
     {
@@ -1053,7 +1107,9 @@ Buffer::Buffer (Buffer const&o)
     m_zeroAreaStart (o.m_zeroAreaStart),
     m_zeroAreaEnd (o.m_zeroAreaEnd),
     m_start (o.m_start),
-    m_end (o.m_end)
+    m_end (o.m_end),
+    m_payload (o.m_payload),
+    m_payloadStart (o.m_payloadStart)
 {
   m_data->m_count++;
   NS_ASSERT (CheckInternalState ());
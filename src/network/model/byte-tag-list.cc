@@ -19,6 +19,7 @@
  */
 #include "byte-tag-list.h"
 #include "ns3/log.h"
+#include "ns3/simple-ref-count.h"
 #include <vector>
 #include <cstring>
 #include <limits>
@@ -39,10 +40,10 @@ NS_LOG_COMPONENT_DEFINE ("ByteTagList");
  * This structure is only used by ByteTagList and should not be accessed directly.
  */
 struct ByteTagListData {
-  uint32_t size;   //!< size of the data
-  uint32_t count;  //!< use counter (for smart deallocation)
-  uint32_t dirty;  //!< number of bytes actually in use
-  uint8_t data[4]; //!< data
+  uint32_t size;         //!< size of the data
+  ReferenceCount count;  //!< use counter (for smart deallocation)
+  uint32_t dirty;        //!< number of bytes actually in use
+  uint8_t data[4];       //!< data
 };
 
 #ifdef USE_FREE_LIST
@@ -53,12 +54,14 @@ struct ByteTagListData {
  *
  * Internal use only.
  */
-static class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
+class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
 {
 public:
   ~ByteTagListDataFreeList ();
-} g_freeList; //!< Container for struct ByteTagListData
-static uint32_t g_maxSize = 0; //!< maximum data size (used for allocation)
+};
+static thread_local ByteTagListDataFreeList g_freeList; //!< Container for struct ByteTagListData, per thread
+static thread_local bool g_freeListReleased = false; //!< true once g_freeList was released
+static thread_local uint32_t g_maxSize = 0; //!< maximum data size (used for allocation)
 
 ByteTagListDataFreeList::~ByteTagListDataFreeList ()
 {
@@ -69,6 +72,7 @@ ByteTagListDataFreeList::~ByteTagListDataFreeList ()
       uint8_t *buffer = (uint8_t *)(*i);
       delete [] buffer;
     }
+  g_freeListReleased = true;
 }
 #endif /* USE_FREE_LIST */
 
@@ -159,6 +163,10 @@ ByteTagList::ByteTagList (const ByteTagList &o)
     {
       m_data->count++;
     }
+  else
+    {
+      std::memcpy (m_inline, o.m_inline, m_used);
+    }
 }
 ByteTagList &
 ByteTagList::operator = (const ByteTagList &o)
@@ -178,6 +186,10 @@ ByteTagList::operator = (const ByteTagList &o)
     {
       m_data->count++;
     }
+  else
+    {
+      std::memcpy (m_inline, o.m_inline, m_used);
+    }
   return *this;
 }
 ByteTagList::~ByteTagList ()
@@ -194,21 +206,36 @@ ByteTagList::Add (TypeId tid, uint32_t bufferSize, int32_t start, int32_t end)
   NS_LOG_FUNCTION (this << tid << bufferSize << start << end);
   uint32_t spaceNeeded = m_used + bufferSize + 4 + 4 + 4 + 4;
   NS_ASSERT (m_used <= spaceNeeded);
-  if (m_data == 0)
+  uint8_t *data;
+  if (m_data == 0 && spaceNeeded <= BYTE_TAG_LIST_INLINE_SIZE)
     {
-      m_data = Allocate (spaceNeeded);
-      m_used = 0;
-    } 
-  else if (m_data->size < spaceNeeded ||
-           (m_data->count != 1 && m_data->dirty != m_used))
+      data = m_inline;
+    }
+  else
     {
-      struct ByteTagListData *newData = Allocate (spaceNeeded);
-      std::memcpy (&newData->data, &m_data->data, m_used);
-      Deallocate (m_data);
-      m_data = newData;
+      if (m_data == 0)
+        {
+          // move the inline buffer to the heap
+          m_data = Allocate (spaceNeeded);
+          std::memcpy (&m_data->data, m_inline, m_used);
+        }
+#ifdef ENABLE_THREAD_SAFE_OBJECTS
+      // Copies in other threads may append to the shared data at the same time
+      else if (m_data->size < spaceNeeded || m_data->count != 1)
+#else
+      else if (m_data->size < spaceNeeded ||
+               (m_data->count != 1 && m_data->dirty != m_used))
+#endif
+        {
+          struct ByteTagListData *newData = Allocate (spaceNeeded);
+          std::memcpy (&newData->data, &m_data->data, m_used);
+          Deallocate (m_data);
+          m_data = newData;
+        }
+      data = m_data->data;
     }
-  TagBuffer tag = TagBuffer (&m_data->data[m_used], 
-                             &m_data->data[spaceNeeded]);
+  TagBuffer tag = TagBuffer (&data[m_used], 
+                             &data[spaceNeeded]);
   tag.WriteU32 (tid.GetUid ());
   tag.WriteU32 (bufferSize);
   tag.WriteU32 (start - m_adjustment);
@@ -222,7 +249,10 @@ ByteTagList::Add (TypeId tid, uint32_t bufferSize, int32_t start, int32_t end)
       m_maxEnd = end - m_adjustment;
     }
   m_used = spaceNeeded;
-  m_data->dirty = m_used;
+  if (m_data != 0)
+    {
+      m_data->dirty = m_used;
+    }
   return tag;
 }
 
@@ -264,13 +294,14 @@ ByteTagList::Iterator
 ByteTagList::Begin (int32_t offsetStart, int32_t offsetEnd) const
 {
   NS_LOG_FUNCTION (this << offsetStart << offsetEnd);
-  if (m_data == 0)
+  if (m_used == 0)
     {
       return Iterator (0, 0, offsetStart, offsetEnd, 0);
     }
   else
     {
-      return Iterator (m_data->data, &m_data->data[m_used], offsetStart, offsetEnd, m_adjustment);
+      uint8_t *data = m_data != 0 ? m_data->data : const_cast<uint8_t *> (m_inline);
+      return Iterator (data, &data[m_used], offsetStart, offsetEnd, m_adjustment);
     }
 }
 
@@ -376,10 +407,9 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
       return;
     }
   g_maxSize = std::max (g_maxSize, data->size);
-  data->count--;
-  if (data->count == 0)
+  if (--data->count == 0)
     {
-      if (g_freeList.size () > FREE_LIST_SIZE ||
+      if (g_freeListReleased || g_freeList.size () > FREE_LIST_SIZE ||
           data->size < g_maxSize)
         {
           uint8_t *buffer = (uint8_t *)data;
@@ -414,8 +444,7 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
-  data->count--;
-  if (data->count == 0)
+  if (--data->count == 0)
     {
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
@@ -25,6 +25,12 @@
 #include "ns3/type-id.h"
 #include "tag-buffer.h"
 
+/**
+ * Number of bytes of tags stored in a ByteTagList before its tags
+ * are moved to the heap.
+ */
+#define BYTE_TAG_LIST_INLINE_SIZE 64
+
 namespace ns3 {
 
 struct ByteTagListData;
@@ -45,7 +51,12 @@ struct ByteTagListData;
  *     as 4 32bit integers (TypeId, tag data size, start, end) followed 
  *     by the tag data as generated by Tag::Serialize.
  *
- *   - The struct ByteTagListData structure which contains the tag byte buffer
+ *   - The byte buffer is stored in the ByteTagList itself as long as it
+ *     fits in #BYTE_TAG_LIST_INLINE_SIZE bytes, so that tagging and
+ *     copying a packet with a few small byte tags does not allocate
+ *     memory.  Larger byte buffers are moved to the heap.
+ *
+ *   - The struct ByteTagListData structure which contains the heap byte buffer
  *     is shared and, thus, reference-counted. This data structure is unshared
  *     as-needed to emulate COW semantics.
  *
@@ -280,7 +291,8 @@ private:
   int32_t m_maxEnd; //!< maximal end offset
   int32_t m_adjustment; //!< adjustment to byte tag offsets
   uint32_t m_used; //!< the number of used bytes in the buffer
-  struct ByteTagListData *m_data; //!< the ByteTagListData structure
+  struct ByteTagListData *m_data; //!< the ByteTagListData structure, or 0 if the buffer is inline
+  uint8_t m_inline[BYTE_TAG_LIST_INLINE_SIZE]; //!< the inline buffer
 };
 
 void
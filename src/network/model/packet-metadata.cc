@@ -17,6 +17,7 @@
  *
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
+#include <algorithm>
 #include <utility>
 #include <list>
 #include "ns3/assert.h"
@@ -33,10 +34,13 @@ NS_LOG_COMPONENT_DEFINE ("PacketMetadata");
 
 bool PacketMetadata::m_enable = false;
 bool PacketMetadata::m_enableChecking = false;
-bool PacketMetadata::m_metadataSkipped = false;
-uint32_t PacketMetadata::m_maxSize = 0;
-uint16_t PacketMetadata::m_chunkUid = 0;
-PacketMetadata::DataFreeList PacketMetadata::m_freeList;
+bool PacketMetadata::m_enableCompact = false;
+const uint32_t PacketMetadata::COMPACT_ITEMS;
+std::atomic<bool> PacketMetadata::m_metadataSkipped (false);
+thread_local uint32_t PacketMetadata::m_maxSize = 0;
+thread_local uint16_t PacketMetadata::m_chunkUid = 0;
+thread_local PacketMetadata::DataFreeList PacketMetadata::m_freeList;
+thread_local bool PacketMetadata::m_freeListReleased = false;
 
 PacketMetadata::DataFreeList::~DataFreeList ()
 {
@@ -45,7 +49,7 @@ PacketMetadata::DataFreeList::~DataFreeList ()
     {
       PacketMetadata::Deallocate (*i);
     }
-  PacketMetadata::m_enable = false;
+  PacketMetadata::m_freeListReleased = true;
 }
 
 void 
@@ -70,6 +74,75 @@ PacketMetadata::EnableChecking (void)
   m_enableChecking = true;
 }
 
+void
+PacketMetadata::EnableCompact (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Enable ();
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  m_enableCompact = true;
+#else
+  NS_LOG_WARN ("Packet metadata is kept inline only with --enable-compact-packet-metadata");
+#endif
+}
+
+void
+PacketMetadata::Expand (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_data != 0)
+    {
+      return;
+    }
+  m_data = PacketMetadata::Create (10);
+  memset (m_data->m_data, 0xff, 4);
+  m_head = 0xffff;
+  m_tail = 0xffff;
+  m_used = 0;
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  for (uint32_t i = 0; i < m_compactCount; i++)
+    {
+      struct PacketMetadata::SmallItem item;
+      item.next = 0xffff;
+      item.prev = m_tail;
+      item.typeUid = m_compact[i].uid << 1;
+      item.size = m_compact[i].size;
+      item.chunkUid = m_compact[i].chunkUid;
+      uint16_t written = AddSmall (&item);
+      UpdateTail (written);
+    }
+#endif
+  m_compactCount = 0;
+}
+
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+bool
+PacketMetadata::RemoveCompact (uint32_t start, uint32_t end)
+{
+  NS_LOG_FUNCTION (this << start << end);
+  NS_ASSERT (m_data == 0);
+  uint32_t first = 0;
+  while (start > 0 && first < m_compactCount && m_compact[first].size <= start)
+    {
+      start -= m_compact[first].size;
+      first++;
+    }
+  uint32_t last = m_compactCount;
+  while (end > 0 && last > first && m_compact[last - 1].size <= end)
+    {
+      end -= m_compact[last - 1].size;
+      last--;
+    }
+  if (start != 0 || end != 0)
+    {
+      return false;
+    }
+  std::copy (m_compact + first, m_compact + last, m_compact);
+  m_compactCount = last - first;
+  return true;
+}
+#endif
+
 void
 PacketMetadata::ReserveCopy (uint32_t size)
 {
@@ -77,8 +150,7 @@ PacketMetadata::ReserveCopy (uint32_t size)
   struct PacketMetadata::Data *newData = PacketMetadata::Create (m_used + size);
   memcpy (newData->m_data, m_data->m_data, m_used);
   newData->m_dirtyEnd = m_used;
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (--m_data->m_count == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
@@ -100,10 +172,16 @@ PacketMetadata::Reserve (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
   NS_ASSERT (m_data != 0);
+#ifdef ENABLE_THREAD_SAFE_OBJECTS
+  // Copies in other threads may append to the shared data at the same time
+  if (m_data->m_size >= m_used + size &&
+      m_data->m_count == 1)
+#else
   if (m_data->m_size >= m_used + size &&
       (m_head == 0xffff ||
        m_data->m_count == 1 ||
        m_data->m_dirtyEnd == m_used))
+#endif
     {
       /* enough room, not dirty. */
     }
@@ -133,6 +211,10 @@ bool
 PacketMetadata::IsStateOk (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_data == 0)
+    {
+      return m_compactCount <= COMPACT_ITEMS;
+    }
   bool ok = m_used <= m_data->m_size;
   ok &= IsPointerOk (m_head);
   ok &= IsPointerOk (m_tail);
@@ -379,10 +461,16 @@ PacketMetadata::AddSmall (const struct PacketMetadata::SmallItem *item)
   uint32_t typeUidSize = GetUleb128Size (item->typeUid);
   uint32_t sizeSize = GetUleb128Size (item->size);
   uint32_t n =  2 + 2 + typeUidSize + sizeSize + 2;
+#ifdef ENABLE_THREAD_SAFE_OBJECTS
+  // Copies in other threads may append to the shared data at the same time
+  if (m_used + n > m_data->m_size ||
+      m_data->m_count != 1)
+#else
   if (m_used + n > m_data->m_size ||
       (m_head != 0xffff &&
        m_data->m_count != 1 &&
        m_used != m_data->m_dirtyEnd))
+#endif
     {
       ReserveCopy (n);
     }
@@ -417,10 +505,16 @@ PacketMetadata::AddBig (uint32_t next, uint32_t prev,
   uint32_t fragEndSize = GetUleb128Size (extraItem->fragmentEnd);
   uint32_t n = 2 + 2 + typeUidSize + sizeSize + 2 + fragStartSize + fragEndSize + 4;
 
+#ifdef ENABLE_THREAD_SAFE_OBJECTS
+  // Copies in other threads may append to the shared data at the same time
+  if (m_used + n > m_data->m_size ||
+      m_data->m_count != 1)
+#else
   if (m_used + n > m_data->m_size ||
       (m_head != 0xffff &&
        m_data->m_count != 1 &&
        m_used != m_data->m_dirtyEnd))
+#endif
     {
       ReserveCopy (n);
     }
@@ -505,6 +599,7 @@ PacketMetadata::ReplaceTail (PacketMetadata::SmallItem *item,
 
   // create a copy of the packet without its tail.
   PacketMetadata h (m_packetUid, 0);
+  h.Expand ();
   uint16_t current = m_head;
   while (current != 0xffff && current != m_tail)
     {
@@ -596,7 +691,7 @@ void
 PacketMetadata::Recycle (struct PacketMetadata::Data *data)
 {
   NS_LOG_FUNCTION (data);
-  if (!m_enable)
+  if (!m_enable || m_freeListReleased)
     {
       PacketMetadata::Deallocate (data);
       return;
@@ -665,9 +760,25 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
   NS_LOG_FUNCTION (this << uid << size);
   if (!m_enable)
     {
-      m_metadataSkipped = true;
+      NotifySkipped ();
       return;
     }
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  if (m_data == 0)
+    {
+      if (m_compactCount < COMPACT_ITEMS)
+        {
+          std::copy_backward (m_compact, m_compact + m_compactCount, m_compact + m_compactCount + 1);
+          m_compact[0].uid = uid >> 1;
+          m_compact[0].chunkUid = m_chunkUid;
+          m_compact[0].size = size;
+          m_compactCount++;
+          m_chunkUid++;
+          return;
+        }
+      Expand ();
+    }
+#endif
 
   struct PacketMetadata::SmallItem item;
   item.next = m_head;
@@ -687,9 +798,27 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
   NS_ASSERT (IsStateOk ());
   if (!m_enable) 
     {
-      m_metadataSkipped = true;
+      NotifySkipped ();
       return;
     }
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  if (m_data == 0)
+    {
+      if (m_compactCount == 0 ||
+          m_compact[0].uid != uid >> 1 ||
+          m_compact[0].size != size)
+        {
+          if (m_enableChecking)
+            {
+              NS_FATAL_ERROR ("Removing unexpected header.");
+            }
+          return;
+        }
+      std::copy (m_compact + 1, m_compact + m_compactCount, m_compact);
+      m_compactCount--;
+      return;
+    }
+#endif
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_head, &item, &extraItem);
@@ -735,9 +864,24 @@ PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
   NS_ASSERT (IsStateOk ());
   if (!m_enable)
     {
-      m_metadataSkipped = true;
+      NotifySkipped ();
       return;
     }
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  if (m_data == 0)
+    {
+      if (m_compactCount < COMPACT_ITEMS)
+        {
+          m_compact[m_compactCount].uid = uid >> 1;
+          m_compact[m_compactCount].chunkUid = m_chunkUid;
+          m_compact[m_compactCount].size = size;
+          m_compactCount++;
+          m_chunkUid++;
+          return;
+        }
+      Expand ();
+    }
+#endif
   struct PacketMetadata::SmallItem item;
   item.next = 0xffff;
   item.prev = m_tail;
@@ -757,9 +901,26 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
   NS_ASSERT (IsStateOk ());
   if (!m_enable) 
     {
-      m_metadataSkipped = true;
+      NotifySkipped ();
       return;
     }
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  if (m_data == 0)
+    {
+      if (m_compactCount == 0 ||
+          m_compact[m_compactCount - 1].uid != uid >> 1 ||
+          m_compact[m_compactCount - 1].size != size)
+        {
+          if (m_enableChecking)
+            {
+              NS_FATAL_ERROR ("Removing unexpected trailer.");
+            }
+          return;
+        }
+      m_compactCount--;
+      return;
+    }
+#endif
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_tail, &item, &extraItem);
@@ -804,10 +965,10 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
   NS_ASSERT (IsStateOk ());
   if (!m_enable) 
     {
-      m_metadataSkipped = true;
+      NotifySkipped ();
       return;
     }
-  if (m_tail == 0xffff)
+  if (m_data == 0 ? m_compactCount == 0 : m_tail == 0xffff)
     {
       // We have no items so 'AddAtEnd' is 
       // equivalent to self-assignment.
@@ -815,6 +976,35 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
       NS_ASSERT (IsStateOk ());
       return;
     }
+  if (o.m_data == 0)
+    {
+      if (o.m_compactCount == 0)
+        {
+          // we have nothing to append.
+          return;
+        }
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+      if (m_data == 0 &&
+          m_packetUid == o.m_packetUid &&
+          m_compactCount + o.m_compactCount <= COMPACT_ITEMS &&
+          (m_compact[m_compactCount - 1].uid != o.m_compact[0].uid ||
+           m_compact[m_compactCount - 1].chunkUid != o.m_compact[0].chunkUid ||
+           m_compact[m_compactCount - 1].size != o.m_compact[0].size))
+        {
+          /* Whole items of the same packet which can not be merged
+           * with each other stay inline.
+           */
+          std::copy (o.m_compact, o.m_compact + o.m_compactCount, m_compact + m_compactCount);
+          m_compactCount += o.m_compactCount;
+          return;
+        }
+#endif
+      PacketMetadata other = o;
+      other.Expand ();
+      AddAtEnd (other);
+      return;
+    }
+  Expand ();
   if (o.m_head == 0xffff)
     {
       NS_ASSERT (o.m_tail == 0xffff);
@@ -881,7 +1071,7 @@ PacketMetadata::AddPaddingAtEnd (uint32_t end)
   NS_LOG_FUNCTION (this << end);
   if (!m_enable)
     {
-      m_metadataSkipped = true;
+      NotifySkipped ();
       return;
     }
 }
@@ -892,9 +1082,19 @@ PacketMetadata::RemoveAtStart (uint32_t start)
   NS_ASSERT (IsStateOk ());
   if (!m_enable) 
     {
-      m_metadataSkipped = true;
+      NotifySkipped ();
       return;
     }
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  if (m_data == 0)
+    {
+      if (RemoveCompact (start, 0))
+        {
+          return;
+        }
+      Expand ();
+    }
+#endif
   NS_ASSERT (m_data != 0);
   uint32_t leftToRemove = start;
   uint16_t current = m_head;
@@ -922,6 +1122,7 @@ PacketMetadata::RemoveAtStart (uint32_t start)
         {
           // fragment the list item.
           PacketMetadata fragment (m_packetUid, 0);
+          fragment.Expand ();
           extraItem.fragmentStart += leftToRemove;
           leftToRemove = 0;
           uint16_t written = fragment.AddBig (0xffff, fragment.m_tail,
@@ -955,9 +1156,19 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
   NS_ASSERT (IsStateOk ());
   if (!m_enable) 
     {
-      m_metadataSkipped = true;
+      NotifySkipped ();
       return;
     }
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  if (m_data == 0)
+    {
+      if (RemoveCompact (0, end))
+        {
+          return;
+        }
+      Expand ();
+    }
+#endif
   NS_ASSERT (m_data != 0);
 
   uint32_t leftToRemove = end;
@@ -986,6 +1197,7 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
         {
           // fragment the list item.
           PacketMetadata fragment (m_packetUid, 0);
+          fragment.Expand ();
           NS_ASSERT (extraItem.fragmentEnd > leftToRemove);
           extraItem.fragmentEnd -= leftToRemove;
           leftToRemove = 0;
@@ -1018,6 +1230,16 @@ PacketMetadata::GetTotalSize (void) const
 {
   NS_LOG_FUNCTION (this);
   uint32_t totalSize = 0;
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  if (m_data == 0)
+    {
+      for (uint32_t i = 0; i < m_compactCount; i++)
+        {
+          totalSize += m_compact[i].size;
+        }
+      return totalSize;
+    }
+#endif
   uint16_t current = m_head;
   uint16_t tail = m_tail;
   while (current != 0xffff)
@@ -1051,7 +1273,7 @@ PacketMetadata::BeginItem (Buffer buffer) const
 PacketMetadata::ItemIterator::ItemIterator (const PacketMetadata *metadata, Buffer buffer)
   : m_metadata (metadata),
     m_buffer (buffer),
-    m_current (metadata->m_head),
+    m_current (metadata->m_data == 0 ? 0 : metadata->m_head),
     m_offset (0),
     m_hasReadTail (false)
 {
@@ -1061,6 +1283,10 @@ bool
 PacketMetadata::ItemIterator::HasNext (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_metadata->m_data == 0)
+    {
+      return m_current < m_metadata->m_compactCount;
+    }
   if (m_current == 0xffff)
     {
       return false;
@@ -1078,12 +1304,26 @@ PacketMetadata::ItemIterator::Next (void)
   struct PacketMetadata::Item item;
   struct PacketMetadata::SmallItem smallItem;
   struct PacketMetadata::ExtraItem extraItem;
-  m_metadata->ReadItems (m_current, &smallItem, &extraItem);
-  if (m_current == m_metadata->m_tail)
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  if (m_metadata->m_data == 0)
+    {
+      const struct PacketMetadata::CompactItem &compact = m_metadata->m_compact[m_current];
+      smallItem.typeUid = compact.uid << 1;
+      smallItem.size = compact.size;
+      extraItem.fragmentStart = 0;
+      extraItem.fragmentEnd = compact.size;
+      m_current++;
+    }
+  else
+#endif
     {
-      m_hasReadTail = true;
+      m_metadata->ReadItems (m_current, &smallItem, &extraItem);
+      if (m_current == m_metadata->m_tail)
+        {
+          m_hasReadTail = true;
+        }
+      m_current = smallItem.next;
     }
-  m_current = smallItem.next;
   uint32_t uid = (smallItem.typeUid & 0xfffffffe) >> 1;
   item.tid.SetUid (uid);
   item.currentTrimedFromStart = extraItem.fragmentStart;
@@ -1145,6 +1385,12 @@ PacketMetadata::GetSerializedSize (void) const
     {
       return totalSize;
     }
+  if (m_data == 0)
+    {
+      PacketMetadata full = *this;
+      full.Expand ();
+      return full.GetSerializedSize ();
+    }
 
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
@@ -1178,6 +1424,12 @@ uint32_t
 PacketMetadata::Serialize (uint8_t* buffer, uint32_t maxSize) const
 {
   NS_LOG_FUNCTION (this << &buffer << maxSize);
+  if (m_data == 0)
+    {
+      PacketMetadata full = *this;
+      full.Expand ();
+      return full.Serialize (buffer, maxSize);
+    }
   uint8_t* start = buffer;
 
   buffer = AddToRawU64 (m_packetUid, start, buffer, maxSize);
@@ -1279,6 +1531,7 @@ uint32_t
 PacketMetadata::Deserialize (const uint8_t* buffer, uint32_t size)
 {
   NS_LOG_FUNCTION (this << &buffer << size);
+  Expand ();
   const uint8_t* start = buffer;
   uint32_t desSize = size - 4;
 
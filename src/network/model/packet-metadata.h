@@ -21,8 +21,10 @@
 #define PACKET_METADATA_H
 
 #include <stdint.h>
+#include <atomic>
 #include <vector>
 #include <limits>
+#include <algorithm>
 #include "ns3/callback.h"
 #include "ns3/assert.h"
 #include "ns3/type-id.h"
@@ -74,6 +76,18 @@ class Trailer;
  * integers, and some others as variable-size 32-bit integers.
  * The variable-size 32 bit integers are stored using the uleb128
  * encoding.
+ *
+ * When the metadata is enabled with EnableCompact, the items of a
+ * packet are kept in a small fixed-size array stored in the
+ * PacketMetadata instance itself, as long as the packet is made of at
+ * most COMPACT_ITEMS whole headers, trailers and payload of the same
+ * packet. The linked list is only built, from the array, when a packet
+ * outgrows it, is fragmented, or is concatenated with another packet,
+ * so that most packets never allocate metadata storage. The array
+ * makes every packet 64 bytes larger, whether or not the compact mode
+ * is enabled, so it is only there when ns-3 is configured with
+ * --enable-compact-packet-metadata. Otherwise EnableCompact is
+ * the same as Enable.
  */
 class PacketMetadata 
 {
@@ -160,6 +174,12 @@ private:
    * \brief Enable the packet metadata checking
    */
   static void EnableChecking (void);
+  /**
+   * \brief Enable the packet metadata, keeping the items of packets
+   * inline as long as possible if ns-3 is configured with
+   * --enable-compact-packet-metadata
+   */
+  static void EnableCompact (void);
 
   /**
    * \brief Constructor
@@ -413,7 +433,7 @@ private:
    */
   struct Data {
     /** number of references to this struct Data instance. */
-    uint32_t m_count;
+    ReferenceCount m_count;
     /** size (in bytes) of m_data buffer below */
     uint16_t m_size;
     /** max of the m_used field over all objects which
@@ -494,6 +514,28 @@ private:
     uint64_t packetUid;
   };
 
+  /**
+   * the number of items of a packet which can be kept inline
+   */
+  static const uint32_t COMPACT_ITEMS = 8;
+
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  /**
+   * \brief CompactItem structure
+   *
+   * A whole header, trailer, or payload of the packet, kept inline.
+   */
+  struct CompactItem {
+    /** the uid of the TypeId of the header or trailer, zero for
+       payload */
+    uint16_t uid;
+    /** the chunkUid of the item, as in SmallItem */
+    uint16_t chunkUid;
+    /** the size (in bytes) of the header or trailer */
+    uint32_t size;
+  };
+#endif
+
   /**
    * \brief Class to hold all the metadata
    */
@@ -620,6 +662,20 @@ public:
    * \param size header serialized size
    */
   void DoAddHeader (uint32_t uid, uint32_t size);
+  /**
+   * \brief Build the linked list of items from the inline items.
+   */
+  void Expand (void);
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  /**
+   * \brief Remove whole inline items
+   * \param start the number of bytes to remove from the start
+   * \param end the number of bytes to remove from the end
+   * \returns false if the bytes to remove are not made of whole items,
+   * in which case nothing is removed
+   */
+  bool RemoveCompact (uint32_t start, uint32_t end);
+#endif
   /**
    * \brief Check if the metadata state is ok
    * \returns true if the internal state is ok
@@ -661,21 +717,28 @@ public:
    */
   static void Deallocate (struct PacketMetadata::Data *data);
 
-  static DataFreeList m_freeList; //!< the metadata data storage
+  /**
+   * \brief Note that adding metadata to a packet was skipped
+   */
+  static inline void NotifySkipped (void);
+
+  static thread_local DataFreeList m_freeList; //!< the metadata data storage of the calling thread
+  static thread_local bool m_freeListReleased; //!< true once the free list of the calling thread was released
   static bool m_enable; //!< Enable the packet metadata
   static bool m_enableChecking; //!< Enable the packet metadata checking
+  static bool m_enableCompact; //!< Keep the packet metadata inline
 
   /**
    * Set to true when adding metadata to a packet is skipped because
    * m_enable is false; used to detect enabling of metadata in the
    * middle of a simulation, which isn't allowed.
    */
-  static bool m_metadataSkipped;
+  static std::atomic<bool> m_metadataSkipped;
 
-  static uint32_t m_maxSize; //!< maximum metadata size
-  static uint16_t m_chunkUid; //!< Chunk Uid
+  static thread_local uint32_t m_maxSize; //!< maximum metadata size in the calling thread
+  static thread_local uint16_t m_chunkUid; //!< Chunk Uid of the calling thread
 
-  struct Data *m_data; //!< Metadata storage
+  struct Data *m_data; //!< Metadata storage, or zero if the items are inline
   /*
      head -(next)-> tail
        ^             |
@@ -684,7 +747,12 @@ public:
   uint16_t m_head; //!< list head
   uint16_t m_tail; //!< list tail
   uint16_t m_used; //!< used portion
+  uint16_t m_compactCount; //!< number of inline items
   uint64_t m_packetUid; //!< packet Uid
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  /** the inline items, from head to tail */
+  struct CompactItem m_compact[COMPACT_ITEMS];
+#endif
 };
 
 } // namespace ns3
@@ -692,13 +760,17 @@ public:
 namespace ns3 {
 
 PacketMetadata::PacketMetadata (uint64_t uid, uint32_t size)
-  : m_data (PacketMetadata::Create (10)),
+  : m_data (m_enableCompact ? 0 : PacketMetadata::Create (10)),
     m_head (0xffff),
     m_tail (0xffff),
     m_used (0),
+    m_compactCount (0),
     m_packetUid (uid)
 {
-  memset (m_data->m_data, 0xff, 4);
+  if (m_data != 0)
+    {
+      memset (m_data->m_data, 0xff, 4);
+    }
   if (size > 0)
     {
       DoAddHeader (0, size);
@@ -709,9 +781,16 @@ PacketMetadata::PacketMetadata (PacketMetadata const &o)
     m_head (o.m_head),
     m_tail (o.m_tail),
     m_used (o.m_used),
+    m_compactCount (o.m_compactCount),
     m_packetUid (o.m_packetUid)
 {
-  NS_ASSERT (m_data != 0);
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  if (m_data == 0)
+    {
+      std::copy (o.m_compact, o.m_compact + m_compactCount, m_compact);
+      return;
+    }
+#endif
   NS_ASSERT (m_data->m_count < std::numeric_limits<uint32_t>::max());
   m_data->m_count++;
 }
@@ -721,31 +800,52 @@ PacketMetadata::operator = (PacketMetadata const& o)
   if (m_data != o.m_data) 
     {
       // not self assignment
-      NS_ASSERT (m_data != 0);
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (m_data != 0)
         {
-          PacketMetadata::Recycle (m_data);
+          if (--m_data->m_count == 0)
+            {
+              PacketMetadata::Recycle (m_data);
+            }
         }
       m_data = o.m_data;
-      NS_ASSERT (m_data != 0);
-      m_data->m_count++;
+      if (m_data != 0)
+        {
+          m_data->m_count++;
+        }
     }
   m_head = o.m_head;
   m_tail = o.m_tail;
   m_used = o.m_used;
   m_packetUid = o.m_packetUid;
+#ifdef ENABLE_COMPACT_PACKET_METADATA
+  if (m_data == 0 && this != &o)
+    {
+      std::copy (o.m_compact, o.m_compact + o.m_compactCount, m_compact);
+    }
+#endif
+  m_compactCount = o.m_compactCount;
   return *this;
 }
 PacketMetadata::~PacketMetadata ()
 {
-  NS_ASSERT (m_data != 0);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (m_data == 0)
+    {
+      return;
+    }
+  if (--m_data->m_count == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
 }
+void
+PacketMetadata::NotifySkipped (void)
+{
+  // The flag is shared by all threads: write it only once
+  if (!m_metadataSkipped.load (std::memory_order_relaxed))
+    {
+      m_metadataSkipped.store (true, std::memory_order_relaxed);
+    }
+}
 
 } // namespace ns3
 
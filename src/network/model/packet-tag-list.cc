@@ -20,7 +20,7 @@
 
 /**
 \file   packet-tag-list.cc
-\brief  Implements a linked list of Packet tags, including copy-on-write semantics.
+\brief  Implements a flat list of Packet tags, including copy-on-write semantics.
 */
 
 #include "packet-tag-list.h"
@@ -28,232 +28,182 @@
 #include "tag.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
-#include <cstring>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
-PacketTagList::TagData *
-PacketTagList::CreateTagData (size_t dataSize)
-{
-  NS_ASSERT_MSG (dataSize
-                 < std::numeric_limits<decltype(TagData::size)>::max (),
-                 "Requested TagData size " << dataSize
-                 << " exceeds maximum "
-                 << std::numeric_limits<decltype(TagData::size)>::max () );
+namespace {
 
-  void * p = std::malloc (sizeof (TagData) + dataSize - 1);
-  // The matching frees are in RemoveAll and RemoveWriter
+/**
+ * \ingroup packet
+ *
+ * \brief Header of a tag stored in a PacketTagList.
+ */
+struct PacketTagHeader
+{
+  uint16_t tid;   //!< uid of the TypeId of the tag
+  uint16_t size;  //!< size of the tag data
+};
 
-  TagData * tag = new (p) TagData;
-  tag->size = dataSize;
-  return tag;
+/**
+ * Read the header of a tag.
+ *
+ * \param [in] data The bytes of the tag.
+ * \returns The header of the tag.
+ */
+PacketTagHeader
+ReadHeader (uint8_t const *data)
+{
+  PacketTagHeader header;
+  std::memcpy (&header, data, sizeof (header));
+  return header;
 }
 
-bool
-PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
+} // unnamed namespace
+
+struct PacketTagListData *
+PacketTagList::Allocate (uint32_t size)
 {
-  TypeId tid = tag.GetInstanceTypeId ();
-  NS_LOG_FUNCTION (this << tid);
-  NS_LOG_INFO     ("looking for " << tid);
+  NS_LOG_FUNCTION (size);
+  void *p = std::malloc (sizeof (struct PacketTagListData) + size - 4);
+  // The matching free is in Deallocate
+  struct PacketTagListData *data = static_cast<struct PacketTagListData *> (p);
+  data->count = 1;
+  data->size = size;
+  return data;
+}
 
-  // trivial case when list is empty
-  if (m_next == 0)
+void
+PacketTagList::Deallocate (struct PacketTagListData *data)
+{
+  NS_LOG_FUNCTION (data);
+  if (data == 0)
     {
-      return false;
+      return;
     }
+  if (--data->count == 0)
+    {
+      std::free (data);
+    }
+}
 
-  bool found = false;
-
-  struct TagData ** prevNext = &m_next; // previous node's next pointer
-  struct TagData  * cur      =  m_next; // cursor to current node
-  struct TagData  * it = 0;             // utility
-
-  // Search from the head of the list until we find tid or a merge
-  while (cur != 0)
+uint8_t *
+PacketTagList::Reserve (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  NS_ASSERT (size >= m_used);
+  if (m_data != 0 && m_data->count == 1)
     {
-      if (cur->count > 1)
+      // private heap buffer: grow it if needed
+      if (m_data->size < size)
         {
-          // found merge
-          NS_LOG_INFO ("found initial merge before tid");
-          break;
-        }
-      else if (cur->tid == tid)
-        {
-          NS_LOG_INFO ("found tid before initial merge, calling writer");
-          found = (this->*Writer)(tag, true, cur, prevNext);
-          break;
+          struct PacketTagListData *data = Allocate (std::max (size, 2 * m_data->size));
+          std::memcpy (data->data, m_data->data, m_used);
+          Deallocate (m_data);
+          m_data = data;
         }
-      else
+      return m_data->data;
+    }
+  if (size <= PACKET_TAG_LIST_INLINE_SIZE)
+    {
+      if (m_data != 0)
         {
-          // no merge or tid found yet, move on
-          prevNext = &cur->next;
-          cur      =  cur->next;
+          // copy the shared heap buffer into the inline bytes
+          std::memcpy (m_inline, m_data->data, m_used);
+          Deallocate (m_data);
+          m_data = 0;
         }
-    }  // while !found && !cow
-
-  // did we find it or run out of tags?
-  if (cur == 0 || found)
-    {
-      NS_LOG_INFO ("returning after header with found: " << found);
-      return found;
+      return m_inline;
     }
+  // move the inline bytes, or copy the shared heap buffer, to the heap
+  struct PacketTagListData *data = Allocate (std::max<uint32_t> (size, 2 * PACKET_TAG_LIST_INLINE_SIZE));
+  std::memcpy (data->data, GetData (), m_used);
+  Deallocate (m_data);
+  m_data = data;
+  return data->data;
+}
 
-  // From here on out, we have to copy the list
-  // until we find tid, then link past it
-
-  // Before we do all that work, let's make sure tid really exists
-  for (it = cur; it != 0; it = it->next)
+uint32_t
+PacketTagList::Find (TypeId tid) const
+{
+  NS_LOG_FUNCTION (this << tid);
+  uint8_t const *data = GetData ();
+  uint32_t offset = 0;
+  while (offset < m_used)
     {
-      if (it->tid == tid)
+      PacketTagHeader header = ReadHeader (data + offset);
+      if (header.tid == tid.GetUid ())
         {
           break;
         }
+      offset += sizeof (header) + header.size;
     }
-  if (it == 0)
-    {
-      // got to end of list without finding tid
-      NS_LOG_INFO ("tid not found after first merge");
-      return found;
-    }
-
-  // At this point cur is a merge, but untested for tid
-  NS_ASSERT (cur != 0);
-  NS_ASSERT (cur->count > 1);
-
-  /*
-     Walk the remainder of the list, copying, until we find tid
-     As we put a copy of the cur node onto our list,
-     we move the merge point down the list.
-
-     Starting position                  End position
-       T1 is a merge                     T1.count decremented
-                                         T2 is a merge
-                                         T1' is a copy of T1
-
-          other                             other
-               \                                 \
-      Prev  ->  T1  ->  T2  -> ...                T1  ->  T2  -> ...
-           /   /                                         /|
-      pNext cur                         Prev  ->  T1' --/ |
-                                                     /    |
-                                                pNext   cur
-
-     When we reach tid, we link past it, decrement count, and we're done.
-  */
-
-  // Should normally check for null cur pointer,
-  // but since we know tid exists, we'll skip this test
-  while ( /* cur && */ cur->tid != tid)
-    {
-      NS_ASSERT (cur != 0);
-      NS_ASSERT (cur->count > 1);
-      cur->count--;                       // unmerge cur
-      struct TagData * copy = CreateTagData (cur->size);
-      copy->tid = cur->tid;
-      copy->count = 1;
-      copy->size = cur->size;
-      memcpy (copy->data, cur->data, copy->size);
-      copy->next = cur->next;             // merge into tail
-      copy->next->count++;                // mark new merge
-      *prevNext = copy;                   // point prior list at copy
-      prevNext = &copy->next;             // advance
-      cur      =  copy->next;
-    }
-  // Sanity check:
-  NS_ASSERT (cur != 0);                 // cur should be non-zero
-  NS_ASSERT (cur->tid == tid);          // cur->tid should be tid
-  NS_ASSERT (cur->count > 1);           // cur should be a merge
-
-  // link around tid, removing it from our list
-  found = (this->*Writer)(tag, false, cur, prevNext);
-  return found;
-
+  return offset;
 }
 
-bool
-PacketTagList::Remove (Tag & tag)
+void
+PacketTagList::Write (uint32_t offset, uint32_t oldSize, Tag const &tag)
 {
-  return COWTraverse (tag, &PacketTagList::RemoveWriter);
+  NS_LOG_FUNCTION (this << offset << oldSize << tag.GetInstanceTypeId ());
+  uint32_t dataSize = tag.GetSerializedSize ();
+  NS_ASSERT_MSG (dataSize
+                 <= std::numeric_limits<decltype(PacketTagHeader::size)>::max (),
+                 "Requested tag size " << dataSize
+                 << " exceeds maximum "
+                 << std::numeric_limits<decltype(PacketTagHeader::size)>::max () );
+  uint32_t newSize = sizeof (PacketTagHeader) + dataSize;
+  uint32_t used = m_used - oldSize + newSize;
+  uint8_t *data = Reserve (std::max (m_used, used));
+  std::memmove (data + offset + newSize, data + offset + oldSize, m_used - offset - oldSize);
+  PacketTagHeader header;
+  header.tid = tag.GetInstanceTypeId ().GetUid ();
+  header.size = dataSize;
+  std::memcpy (data + offset, &header, sizeof (header));
+  tag.Serialize (TagBuffer (data + offset + sizeof (header), data + offset + newSize));
+  m_used = used;
 }
 
-// COWWriter implementing Remove
 bool
-PacketTagList::RemoveWriter (Tag & tag, bool preMerge,
-                             struct PacketTagList::TagData  * cur,
-                             struct PacketTagList::TagData ** prevNext)
+PacketTagList::Remove (Tag & tag)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-
-  // found tid
-  bool found = true;
-  tag.Deserialize (TagBuffer (cur->data, cur->data + cur->size));
-  *prevNext = cur->next;            // link around cur
-
-  if (preMerge)
+  NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
+  uint32_t offset = Find (tag.GetInstanceTypeId ());
+  if (offset == m_used)
     {
-      // found tid before first merge, so delete cur
-      cur->~TagData ();
-      std::free (cur);
+      return false;
     }
-  else
+  uint8_t *cur = const_cast<uint8_t *> (GetData ()) + offset;
+  PacketTagHeader header = ReadHeader (cur);
+  tag.Deserialize (TagBuffer (cur + sizeof (header), cur + sizeof (header) + header.size));
+  uint32_t oldSize = sizeof (header) + header.size;
+  if (oldSize == m_used)
     {
-      // cur is always a merge at this point
-      // unmerge cur, since we linked around it already
-      cur->count--;
-      if (cur->next != 0)
-        {
-          // there's a next, so make it a merge
-          cur->next->count++;
-        }
+      RemoveAll ();
+      return true;
     }
-  return found;
+  uint8_t *data = Reserve (m_used);
+  std::memmove (data + offset, data + offset + oldSize, m_used - offset - oldSize);
+  m_used -= oldSize;
+  return true;
 }
 
 bool
 PacketTagList::Replace (Tag & tag)
 {
-  bool found = COWTraverse (tag, &PacketTagList::ReplaceWriter);
-  if (!found)
+  NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
+  uint32_t offset = Find (tag.GetInstanceTypeId ());
+  if (offset == m_used)
     {
       Add (tag);
+      return false;
     }
-  return found;
-}
-
-// COWWriter implementing Replace
-bool
-PacketTagList::ReplaceWriter (Tag & tag, bool preMerge,
-                              struct PacketTagList::TagData  * cur,
-                              struct PacketTagList::TagData ** prevNext)
-{
-  NS_LOG_FUNCTION_NOARGS ();
-
-  // found tid
-  bool found = true;
-  if (preMerge)
-    {
-      // found tid before first merge, so just rewrite
-      tag.Serialize (TagBuffer (cur->data, cur->data + cur->size));
-    }
-  else
-    {
-      // cur is always a merge at this point
-      // need to copy, replace, and link past cur
-      cur->count--;                     // unmerge cur
-      struct TagData * copy = CreateTagData (tag.GetSerializedSize ());
-      copy->tid = tag.GetInstanceTypeId ();
-      copy->count = 1;
-      tag.Serialize (TagBuffer (copy->data, copy->data + copy->size));
-      copy->next = cur->next;           // merge into tail
-      if (copy->next != 0)
-        {
-          copy->next->count++;          // mark new merge
-        }
-      *prevNext = copy;                 // point prior list at copy
-    }
-  return found;
+  PacketTagHeader header = ReadHeader (GetData () + offset);
+  Write (offset, sizeof (header) + header.size, tag);
+  return true;
 }
 
 void
@@ -261,43 +211,42 @@ PacketTagList::Add (const Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
   // ensure this id was not yet added
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
-    {
-      NS_ASSERT_MSG (cur->tid != tag.GetInstanceTypeId (),
-                     "Error: cannot add the same kind of tag twice.");
-    }
-  struct TagData * head = CreateTagData (tag.GetSerializedSize ());
-  head->count = 1;
-  head->next = 0;
-  head->tid = tag.GetInstanceTypeId ();
-  head->next = m_next;
-  tag.Serialize (TagBuffer (head->data, head->data + head->size));
-
-  const_cast<PacketTagList *> (this)->m_next = head;
+  NS_ASSERT_MSG (Find (tag.GetInstanceTypeId ()) == m_used,
+                 "Error: cannot add the same kind of tag twice.");
+  const_cast<PacketTagList *> (this)->Write (0, 0, tag);
 }
 
 bool
 PacketTagList::Peek (Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
-  TypeId tid = tag.GetInstanceTypeId ();
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+  uint32_t offset = Find (tag.GetInstanceTypeId ());
+  if (offset == m_used)
     {
-      if (cur->tid == tid)
-        {
-          /* found tag */
-          tag.Deserialize (TagBuffer (cur->data, cur->data + cur->size));
-          return true;
-        }
+      /* no tag found */
+      return false;
     }
-  /* no tag found */
-  return false;
+  /* found tag */
+  uint8_t *cur = const_cast<uint8_t *> (GetData ()) + offset;
+  PacketTagHeader header = ReadHeader (cur);
+  tag.Deserialize (TagBuffer (cur + sizeof (header), cur + sizeof (header) + header.size));
+  return true;
 }
 
-const struct PacketTagList::TagData *
-PacketTagList::Head (void) const
+bool
+PacketTagList::Next (uint32_t &offset, struct PacketTagList::Item &item) const
 {
-  return m_next;
+  if (offset >= m_used)
+    {
+      return false;
+    }
+  uint8_t const *cur = GetData () + offset;
+  PacketTagHeader header = ReadHeader (cur);
+  item.tid.SetUid (header.tid);
+  item.size = header.size;
+  item.data = cur + sizeof (header);
+  offset += sizeof (header) + header.size;
+  return true;
 }
 
 uint32_t
@@ -309,16 +258,18 @@ PacketTagList::GetSerializedSize (void) const
 
   size = 4; // numberOfTags
 
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+  uint32_t offset = 0;
+  struct Item item;
+  while (Next (offset, item))
     {
-      size += 4; // TagData -> size
+      size += 4; // tag size
 
       // TypeId hash; ensure size is multiple of 4 bytes
       uint32_t hashSize = (sizeof (TypeId::hash_t)+3) & (~3);
       size += hashSize;
 
-      // TagData -> data; ensure size is multiple of 4 bytes
-      uint32_t tagWordSize = (cur->size+3) & (~3);
+      // tag data; ensure size is multiple of 4 bytes
+      uint32_t tagWordSize = (item.size+3) & (~3);
       size += tagWordSize;
     }
 
@@ -346,11 +297,13 @@ PacketTagList::Serialize (uint32_t* buffer, uint32_t maxSize) const
       return 0;
     }
 
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+  uint32_t offset = 0;
+  struct Item item;
+  while (Next (offset, item))
     {
       if (size + 4 <= maxSize)
         {
-          *p++ = cur->size;
+          *p++ = item.size;
           size += 4;
         }
       else
@@ -358,13 +311,13 @@ PacketTagList::Serialize (uint32_t* buffer, uint32_t maxSize) const
           return 0;
         }
 
-      NS_LOG_INFO("Serializing tag id " << cur->tid);
+      NS_LOG_INFO("Serializing tag id " << item.tid);
 
       // ensure size is multiple of 4 bytes for 4 byte boundaries
       uint32_t hashSize = (sizeof (TypeId::hash_t)+3) & (~3);
       if (size + hashSize <= maxSize)
         {
-          TypeId::hash_t tid = cur->tid.GetHash ();
+          TypeId::hash_t tid = item.tid.GetHash ();
           memcpy (p, &tid, sizeof (TypeId::hash_t));
           p += hashSize / 4;
           size += hashSize;
@@ -375,10 +328,10 @@ PacketTagList::Serialize (uint32_t* buffer, uint32_t maxSize) const
         }
 
       // ensure size is multiple of 4 bytes for 4 byte boundaries
-      uint32_t tagWordSize = (cur->size+3) & (~3);
+      uint32_t tagWordSize = (item.size+3) & (~3);
       if (size + tagWordSize <= maxSize)
         {
-          memcpy (p, cur->data, cur->size);
+          memcpy (p, item.data, item.size);
           size += tagWordSize;
           p += tagWordSize / 4;
         }
@@ -407,7 +360,6 @@ PacketTagList::Deserialize (const uint32_t* buffer, uint32_t size)
 
   NS_LOG_INFO("Deserializing number of tags " << numberOfTags);
 
-  struct TagData * prevTag = 0;
   for (uint32_t i = 0; i < numberOfTags; ++i)
     {
       NS_ASSERT (sizeCheck >= 4);
@@ -425,30 +377,21 @@ PacketTagList::Deserialize (const uint32_t* buffer, uint32_t size)
 
       NS_LOG_INFO ("Deserializing tag of type " << tid);
 
-      struct TagData * newTag = CreateTagData (tagSize);
-      newTag->count = 1;
-      newTag->next = 0;
-      newTag->tid = tid;
-
       NS_ASSERT (sizeCheck >= tagSize);
-      memcpy (newTag->data, p, tagSize);
+      NS_ASSERT (tagSize <= std::numeric_limits<decltype(PacketTagHeader::size)>::max ());
+      // Append the tag, to keep the order of the list
+      PacketTagHeader header;
+      header.tid = tid.GetUid ();
+      header.size = tagSize;
+      uint8_t *data = Reserve (m_used + sizeof (header) + tagSize);
+      std::memcpy (data + m_used, &header, sizeof (header));
+      std::memcpy (data + m_used + sizeof (header), p, tagSize);
+      m_used += sizeof (header) + tagSize;
 
       // ensure 4 byte boundary
       uint32_t tagWordSize = (tagSize+3) & (~3);
       p += tagWordSize / 4;
       sizeCheck -= tagWordSize;
-
-      // Set link list pointers.
-      if (i==0)
-        {
-          m_next = newTag;
-        }
-      else
-        {
-          prevTag->next = newTag;
-        }
-
-      prevTag = newTag;
     }
 
   NS_ASSERT (sizeCheck == 0);
@@ -458,6 +401,4 @@ PacketTagList::Deserialize (const uint32_t* buffer, uint32_t size)
   return (sizeCheck != 0) ? 0 : 1;
 }
 
-
 } /* namespace ns3 */
-
@@ -17,135 +17,70 @@
  *
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
+
 #ifndef PACKET_TAG_LIST_H
 #define PACKET_TAG_LIST_H
 
 /**
 \file   packet-tag-list.h
-\brief  Defines a linked list of Packet tags, including copy-on-write semantics.
+\brief  Defines a flat list of Packet tags, including copy-on-write semantics.
 */
 
 #include <stdint.h>
+#include <cstring>
 #include <ostream>
 #include "ns3/type-id.h"
+#include "ns3/simple-ref-count.h"
+
+/**
+ * Number of bytes of tags stored in a PacketTagList before its tags
+ * are moved to the heap.
+ */
+#define PACKET_TAG_LIST_INLINE_SIZE 64
 
 namespace ns3 {
 
 class Tag;
+struct PacketTagListData;
 
 /**
  * \ingroup packet
- *
  * \brief List of the packet tags stored in a packet.
  *
  * This class is mostly private to the Packet implementation and users
  * should never have to access it directly.
  *
  * \internal
+ * The tags are stored in serialized form, one after the other, from
+ * the most recent one to the oldest one: each tag is stored as a 4-byte
+ * header (the uid of the TypeId of the tag and the size of the tag
+ * data, 16 bits each) followed by the tag data as generated by
+ * Tag::Serialize.
  *
- * The implementation of this class is a bit tricky.  Refer to this
- * diagram in the discussion that follows.
- *
- * \dot
- *    digraph {
- *        rankdir = "LR";
- *        clusterrank = local;
- *        node [ shape = record, fontname="FreeSans", fontsize="10" ];
- *        oth  [ label="<l> Other branch | <n> next | <c> ..." ];
- *        PTL1 [ label="<l> PacketTagList A | <n> m_next" , shape=Mrecord];
- *        PTL2 [ label="<l> PacketTagList B | <n> m_next" , shape=Mrecord];
- *        oth:n  -> T7:l ;
- *        PTL2:n -> T6:l ;
- *        PTL1:n -> T5:l ;
- *        T1   [ label="<l> T1  | <n> next | <c> count = 1" ];
- *        T2   [ label="<l> T2  | <n> next | <c> count = 1" ];
- *        T3   [ label="<l> T3  | <n> next | <c> count = 2" ];
- *        T4   [ label="<l> T4  | <n> next | <c> count = 1" ];
- *        T5   [ label="<l> T5  | <n> next | <c> count = 2" ];
- *        T6   [ label="<l> T6  | <n> next | <c> count = 1" ];
- *        T7   [ label="<l> T7  | <n> next | <c> count = 1" ];
- *        NULL [ label="0", shape = ellipse ];
- *        subgraph cluster_list {
- *          penwidth = 0;
- *          T6:n -> T5:l ;
- *          T5:n -> T4:l ;
- *          T4:n -> T3:l ;
- *          T7:n -> T3:l ;
- *          T3:n -> T2:l ;
- *          T2:n -> T1:l ;
- *          T1:n -> NULL ;
- *        };
- *      }
- * \enddot
- *
- *   - Tags are stored in serialized form in a tree of TagData
- *     structures. (<tt>T1-T7</tt> in the diagram)
- *
- *   - Each TagData points (\c next pointers in the diagram)
- *     toward the root of the tree, which is a null pointer.
- *
- *   - \c count is the number of incoming pointers to this
- *     TagData.  Branch points, where branches merge or join, have
- *     <tt>count \> 1</tt> (\c T3, \c T5); successive links along
- *     a branch have <tt>count = 1</tt> (\c T1, \c T2, \c T4, \c T6, \c T7).
- *
- *   - Each PacketTagList points to a specific TagData,
- *     which is the most recent Tag added to the packet. (<tt>T5-T7</tt>)
- *
- *   - Conceptually, therefore, each Packet has a PacketTagList which
- *     points to a singly-linked list of TagData.
- *
- * \par <b> Copy-on-write </b> is implemented as follows:
- *
- *   - #Add prepends the new tag to the list (growing that branch of the tree,
- *     as \c T6). This is a constant time operation, and does not affect
- *     any other #PacketTagList's, hence this is a \c const function.
- *
- *   - Copy constructor (PacketTagList(const PacketTagList & o))
- *     and assignment (#operator=(const PacketTagList & o))
- *     simply join the tree at the same place as the original
- *     PacketTagList \c o, incrementing the \c count.
- *     For assignment, the old branch is deleted, up to
- *     the first branch point, which has its \c count decremented.
- *     (PacketTagList \c B started as a copy of PacketTagList \c A,
- *     before \c T6 was added to \c B).
- *
- *   - #Remove and #Replace are a little tricky, depending on where the
- *     target tag is found relative to the first branch point:
- *     - \e Target before <em> the first branch point: </em> \n
- *       The target is just dealt with in place (linked around and deleted,
- *       in the case of #Remove; rewritten in the case of #Replace).
- *     - \e Target at or after <em> the first branch point: </em> \n
- *       The portion of the list between the first branch and the target is
- *       shared. This portion is copied before the #Remove or #Replace is
- *       performed.
+ * The tags of a packet usually fit in the
+ * #PACKET_TAG_LIST_INLINE_SIZE bytes stored in the PacketTagList
+ * itself, so that adding tags and copying the packet do not allocate
+ * memory.  When they do not fit, they are moved to a heap buffer, the
+ * struct PacketTagListData, which is reference-counted to share it
+ * between the copies of a packet:
+ *   - The copy constructor and assignment copy the inline bytes, or
+ *     share the heap buffer by incrementing its reference count.
+ *   - #Add, #Remove, #Replace and #Deserialize make a private copy of
+ *     a shared heap buffer before changing it.  A private copy which
+ *     fits in the inline bytes is made there.
  */
 class PacketTagList 
 {
 public:
   /**
-   * Tree node for sharing serialized tags.
-   *
-   * See PacketTagList for a discussion of the data structure.
-   *
-   * \internal
-   * Unfortunately this has to be public, because
-   * PacketTagIterator::Item::GetTag() needs the data and size values.
-   * The Item nested class can't be forward declared, so friending isn't
-   * possible.
-   *
-   * We use placement new so we can allocate enough room for the Tag
-   * type which will be serialized into data.  See Object::Aggregates
-   * for a similar construction.
+   * A tag of the list, as seen by iteration.
    */
-  struct TagData
+  struct Item
   {
-    struct TagData * next;      /**< Pointer to next in list */
-    uint32_t count;             /**< Number of incoming links */
-    TypeId tid;                 /**< Type of the tag serialized into #data */
-    uint32_t size;              /**< Size of the \c data buffer */
-    uint8_t data[1];            /**< Serialization buffer */
-  };  /* struct TagData */
+    TypeId tid;           /**< Type of the tag serialized into #data */
+    uint32_t size;        /**< Size of the \c data buffer */
+    uint8_t const *data;  /**< Serialized tag */
+  };
 
   /**
    * Create a new PacketTagList.
@@ -156,8 +91,7 @@ public:
    *
    * \param [in] o The PacketTagList to copy.
    *
-   * This makes a light-weight copy by #RemoveAll, then
-   * pointing to the same \ref TagData as \pname{o}.
+   * This copies the inline tags of \pname{o}, or shares its heap buffer.
    */
   inline PacketTagList (PacketTagList const &o);
   /**
@@ -166,19 +100,19 @@ public:
    * \param [in] o The PacketTagList to copy.
    * \returns the copied object
    *
-   * This makes a light-weight copy by #RemoveAll, then
-   * pointing to the same \ref TagData as \pname{o}.
+   * This makes a light-weight copy by #RemoveAll, then copying
+   * the inline tags of \pname{o}, or sharing its heap buffer.
    */
   inline PacketTagList &operator = (PacketTagList const &o);
   /**
    * Destructor
    *
-   * #RemoveAll's the tags up to the first merge.
+   * #RemoveAll's the tags.
    */
   inline ~PacketTagList ();
 
   /**
-   * Add a tag to the head of this branch.
+   * Add a tag to the head of this list.
    *
    * \param [in] tag The tag to add
    */
@@ -210,13 +144,18 @@ public:
    */
   bool Peek (Tag &tag) const;
   /**
-   * Remove all tags from this list (up to the first merge).
+   * Remove all tags from this list.
    */
   inline void RemoveAll (void);
   /**
-   * \returns pointer to head of tag list
+   * Get a tag of the list, to iterate over the list.
+   *
+   * \param [in,out] offset The offset of the tag, 0 for the first tag.
+   *          Set to the offset of the next tag.
+   * \param [out] item The tag, valid until this list is changed.
+   * \returns False if there is no tag at \pname{offset}, true otherwise.
    */
-  const struct PacketTagList::TagData *Head (void) const;
+  bool Next (uint32_t &offset, struct PacketTagList::Item &item) const;
   /**
    * Returns number of bytes required for packet serialization.
    *
@@ -244,68 +183,65 @@ public:
 
 private:
   /**
-   * Allocate and construct a TagData struct, sizing the data area
-   * large enough to serialize dataSize bytes from a Tag.
-   *
-   * \param [in] dataSize The serialized size of the Tag.
-   * \returns The newly constructed TagData object.
+   * \returns The bytes of the tags.
    */
-  static
-  TagData * CreateTagData (size_t dataSize);
-  
+  inline uint8_t const *GetData (void) const;
   /**
-   * Typedef of method function pointer for copy-on-write operations
+   * Find a tag.
    *
-   * \param [in] tag The tag type to operate on.
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *             false otherwise.
-   * \param [in] cur Pointer to the tag.
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True if operation successful, false otherwise
+   * \param [in] tid The type of the tag.
+   * \returns The offset of the tag, or the number of bytes of the
+   *          tags if it is not found.
    */
-  typedef bool (PacketTagList::*COWWriter)
-    (Tag       & tag, bool         preMerge,
-    struct TagData * cur, struct TagData ** prevNext);
+  uint32_t Find (TypeId tid) const;
   /**
-   * Traverse the list implementing copy-on-write, using \pname{Writer}.
+   * Make the bytes of the tags private to this list and large enough,
+   * moving them to the heap if they do not fit inline.
    *
-   * \param [in] tag The tag type to operate on.
-   * \param [in] Writer The copy-on-write function to use.
-   * \returns True if \pname{tag} found, false otherwise.
+   * \param [in] size The number of bytes needed.
+   * \returns The bytes of the tags, which can be changed.
    */
-  bool COWTraverse   (Tag & tag, PacketTagList::COWWriter Writer);
+  uint8_t *Reserve (uint32_t size);
   /**
-   * Copy-on-write implementing Remove.
+   * Write a tag at an offset of the list, replacing \pname{oldSize}
+   * bytes of it.
    *
-   * \param [in] tag The target tag type to remove.
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *             false otherwise.
-   * \param [in] cur Pointer to the tag.
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True, since tag will definitely be removed.
+   * \param [in] offset The offset of the tag.
+   * \param [in] oldSize The number of bytes replaced.
+   * \param [in] tag The tag.
    */
-  bool RemoveWriter  (Tag & tag, bool preMerge,
-                      struct TagData * cur, struct TagData ** prevNext);
+  void Write (uint32_t offset, uint32_t oldSize, Tag const &tag);
   /**
-   * Copy-on-write implementing Replace
+   * Allocate a heap buffer.
    *
-   * \param [in] tag The target tag type to replace
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *          false otherwise.
-   * \param [in] cur Pointer to the tag
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True, since tag value will definitely be replaced.
+   * \param [in] size The size of the buffer.
+   * \returns The buffer, with a reference count of one.
    */
-  bool ReplaceWriter (Tag & tag, bool preMerge,
-                      struct TagData * cur, struct TagData ** prevNext);
-
+  static struct PacketTagListData *Allocate (uint32_t size);
   /**
-   * Pointer to first \ref TagData on the list
+   * Release a reference to a heap buffer.
+   *
+   * \param [in] data The buffer, or 0.
    */
-  struct TagData *m_next;
+  static void Deallocate (struct PacketTagListData *data);
+
+  struct PacketTagListData *m_data;   //!< the heap buffer of the tags, or 0 if they are inline
+  uint32_t m_used;                    //!< the number of bytes of the tags
+  uint8_t m_inline[PACKET_TAG_LIST_INLINE_SIZE];  //!< the inline bytes of the tags
+};
+
+/**
+ * \ingroup packet
+ *
+ * \brief Heap buffer of the tags of a PacketTagList.
+ *
+ * This structure is only used by PacketTagList and should not be accessed directly.
+ */
+struct PacketTagListData
+{
+  ReferenceCount count;  //!< number of PacketTagList sharing the buffer
+  uint32_t size;         //!< size of the data
+  uint8_t data[4];       //!< data
 };
 
 } // namespace ns3
@@ -317,16 +253,22 @@ private:
 namespace ns3 {
 
 PacketTagList::PacketTagList ()
-  : m_next ()
+  : m_data (0),
+    m_used (0)
 {
 }
 
 PacketTagList::PacketTagList (PacketTagList const &o)
-  : m_next (o.m_next)
+  : m_data (o.m_data),
+    m_used (o.m_used)
 {
-  if (m_next != 0)
+  if (m_data != 0)
+    {
+      m_data->count++;
+    }
+  else
     {
-      m_next->count++;
+      std::memcpy (m_inline, o.m_inline, m_used);
     }
 }
 
@@ -334,15 +276,20 @@ PacketTagList &
 PacketTagList::operator = (PacketTagList const &o)
 {
   // self assignment
-  if (m_next == o.m_next) 
+  if (this == &o)
     {
       return *this;
     }
   RemoveAll ();
-  m_next = o.m_next;
-  if (m_next != 0) 
+  m_data = o.m_data;
+  m_used = o.m_used;
+  if (m_data != 0)
+    {
+      m_data->count++;
+    }
+  else
     {
-      m_next->count++;
+      std::memcpy (m_inline, o.m_inline, m_used);
     }
   return *this;
 }
@@ -355,27 +302,18 @@ PacketTagList::~PacketTagList ()
 void
 PacketTagList::RemoveAll (void)
 {
-  struct TagData *prev = 0;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+  if (m_data != 0)
     {
-      cur->count--;
-      if (cur->count > 0) 
-        {
-          break;
-        }
-      if (prev != 0) 
-        {
-          prev->~TagData ();
-          std::free (prev);
-        }
-      prev = cur;
+      Deallocate (m_data);
+      m_data = 0;
     }
-  if (prev != 0) 
-    {
-      prev->~TagData ();
-      std::free (prev);
-    }
-  m_next = 0;
+  m_used = 0;
+}
+
+uint8_t const *
+PacketTagList::GetData (void) const
+{
+  return m_data != 0 ? m_data->data : m_inline;
 }
 
 } // namespace ns3
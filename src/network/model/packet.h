@@ -21,7 +21,10 @@
 #define PACKET_H
 
 #include <stdint.h>
+#include <atomic>
+#include <type_traits>
 #include "buffer.h"
+#include "payload-block.h"
 #include "header.h"
 #include "trailer.h"
 #include "packet-metadata.h"
@@ -126,7 +129,9 @@ private:
  * \ingroup packet
  * \brief Iterator over the set of packet tags in a packet
  *
- * This is a java-style iterator.
+ * This is a java-style iterator.  It iterates over a copy of the tags
+ * of the packet, so that the packet can be changed or destroyed while
+ * iterating; the items it returns are valid as long as the iterator.
  */
 class PacketTagIterator
 {
@@ -155,10 +160,10 @@ private:
     friend class PacketTagIterator;
     /**
      * Constructor
-     * \param data the data to copy.
+     * \param item the tag in the list.
      */
-    Item (const struct PacketTagList::TagData *data);
-    const struct PacketTagList::TagData *m_data; //!< the tag data
+    Item (const struct PacketTagList::Item &item);
+    struct PacketTagList::Item m_item; //!< the tag in the list
   };
   /**
    * \returns true if calling Next is safe, false otherwise.
@@ -173,10 +178,11 @@ private:
   friend class Packet;
   /**
    * Constructor
-   * \param head head of the items
+   * \param list the tags of the packet
    */
-  PacketTagIterator (const struct PacketTagList::TagData *head);
-  const struct PacketTagList::TagData *m_current;  //!< actual position over the set of tags in a packet
+  PacketTagIterator (const PacketTagList &list);
+  PacketTagList m_list;  //!< copy of the tags of the packet
+  uint32_t m_offset;     //!< actual position over the set of tags in a packet
 };
 
 /**
@@ -284,6 +290,26 @@ public:
    * \param size the size of the input buffer.
    */
   Packet (uint8_t const*buffer, uint32_t size);
+  /**
+   * \brief Create a packet whose payload references the bytes of a
+   * block.
+   *
+   * The bytes are not copied: the packet, its copies and its
+   * fragments share the block until they are concatenated with other
+   * packets.
+   *
+   * \param block the block
+   */
+  Packet (Ptr<const PayloadBlock> block);
+  /**
+   * \brief Create a packet whose payload references a slice of the
+   * bytes of a block.
+   *
+   * \param block the block
+   * \param offset the offset of the slice in the block
+   * \param size the size of the slice
+   */
+  Packet (Ptr<const PayloadBlock> block, uint32_t offset, uint32_t size);
   /**
    * \brief Create a new packet which contains a fragment of the original
    * packet.
@@ -442,6 +468,36 @@ public:
    */
   void CopyData (std::ostream *os, uint32_t size) const;
 
+  /**
+   * \brief Get the packet contents without copying them.
+   *
+   * \param offset offset from the start of the packet
+   * \param size number of bytes
+   * \returns a pointer to the bytes [offset, offset + size) of the
+   * packet if they are contiguous in memory, or zero otherwise.
+   *
+   * The bytes are contiguous if they do not straddle headers and
+   * payload, and if the payload was created from a PayloadBlock or
+   * has been written to memory; the payload of a packet created with
+   * a size is only zeroes which are never written.  The pointer is
+   * valid as long as the packet is not modified.
+   */
+  uint8_t const *PeekContiguousData (uint32_t offset, uint32_t size) const;
+
+  /**
+   * \brief Get a view of the packet contents as a structure, without
+   * copying them.
+   *
+   * \tparam T \explicit the type of the structure, which must be
+   * trivially copyable
+   * \param offset offset of the structure from the start of the packet
+   * \returns a pointer to the structure, or zero if its bytes are not
+   * contiguous in memory or not aligned for T, in which case CopyData
+   * must be used instead.
+   */
+  template <typename T>
+  T const *PeekView (uint32_t offset = 0) const;
+
   /**
    * \brief performs a COW copy of the packet.
    *
@@ -530,6 +586,16 @@ public:
    * errors will be detected and will abort the program.
    */
   static void EnableChecking (void);
+  /**
+   * \brief Enable printing packets metadata, kept in compact form.
+   *
+   * Like EnablePrinting, but packets made of a few whole headers,
+   * trailers and payload keep their metadata inline instead of in
+   * separately allocated storage, which makes long simulations with
+   * printing enabled faster and lighter on memory. The output of the
+   * Print methods is the same.
+   */
+  static void EnableCompactPrinting (void);
 
   /**
    * \brief Returns number of bytes required for packet
@@ -787,7 +853,7 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector; //!< the packet's Nix vector
 
-  static uint32_t m_globalUid; //!< Global counter of packets Uid
+  static std::atomic<uint32_t> m_globalUid; //!< Global counter of packets Uid, shared by all threads
 };
 
 /**
@@ -854,6 +920,23 @@ Packet::GetSize (void) const
   return m_buffer.GetSize ();
 }
 
+template <typename T>
+T const *
+Packet::PeekView (uint32_t offset) const
+{
+  static_assert (std::is_trivially_copyable<T>::value, "A view requires a trivially copyable type");
+  if (offset > GetSize () || sizeof (T) > GetSize () - offset)
+    {
+      return 0;
+    }
+  uint8_t const *data = m_buffer.PeekContiguousData (offset, sizeof (T));
+  if (data == 0 || reinterpret_cast<uintptr_t> (data) % alignof (T) != 0)
+    {
+      return 0;
+    }
+  return reinterpret_cast<T const *> (data);
+}
+
 } // namespace ns3
 
 #endif /* PACKET_H */
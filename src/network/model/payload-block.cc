@@ -0,0 +1,69 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "payload-block.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include <new>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("PayloadBlock");
+
+PayloadBlock::PayloadBlock (uint32_t size)
+  : m_data (static_cast<uint8_t *> (::operator new (size == 0 ? 1 : size))),
+    m_size (size),
+    m_owned (true)
+{
+  NS_LOG_FUNCTION (this << size);
+}
+
+PayloadBlock::PayloadBlock (uint8_t const *data, uint32_t size)
+  : m_data (const_cast<uint8_t *> (data)),
+    m_size (size),
+    m_owned (false)
+{
+  NS_LOG_FUNCTION (this << &data << size);
+}
+
+PayloadBlock::~PayloadBlock ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_owned)
+    {
+      ::operator delete (m_data);
+    }
+}
+
+uint8_t const *
+PayloadBlock::GetData (void) const
+{
+  return m_data;
+}
+
+uint8_t *
+PayloadBlock::GetData (void)
+{
+  NS_ASSERT_MSG (m_owned, "The bytes of an external payload block are read-only");
+  return m_data;
+}
+
+uint32_t
+PayloadBlock::GetSize (void) const
+{
+  return m_size;
+}
+
+} // namespace ns3
@@ -0,0 +1,86 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PAYLOAD_BLOCK_H
+#define PAYLOAD_BLOCK_H
+
+#include <stdint.h>
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ *
+ * \brief A reference-counted block of payload bytes shared by packets
+ * without copying.
+ *
+ * A Packet created from a PayloadBlock references the bytes of the
+ * block as its payload instead of copying them: the packet, its copies
+ * and its fragments all share the block, which is released when the
+ * last of them is destroyed.  The bytes of a block must not be changed
+ * once a packet references them.
+ *
+ * A block either owns its bytes, allocated with the alignment of any
+ * fundamental type, or references external memory which must outlive
+ * it.  Subclasses may release the external memory from their
+ * destructor.
+ */
+class PayloadBlock : public SimpleRefCount<PayloadBlock>
+{
+public:
+  /**
+   * \brief Constructor of a block owning its bytes.
+   *
+   * The content of the bytes is undefined.
+   *
+   * \param size the size of the block
+   */
+  PayloadBlock (uint32_t size);
+  /**
+   * \brief Constructor of a block referencing external memory.
+   *
+   * \param data the external bytes
+   * \param size the number of bytes
+   */
+  PayloadBlock (uint8_t const *data, uint32_t size);
+  virtual ~PayloadBlock ();
+
+  /**
+   * \returns the bytes of the block
+   */
+  uint8_t const *GetData (void) const;
+  /**
+   * \returns the bytes of a block owning its bytes, to fill it before
+   * creating packets from it
+   */
+  uint8_t *GetData (void);
+  /**
+   * \returns the number of bytes of the block
+   */
+  uint32_t GetSize (void) const;
+
+private:
+  PayloadBlock (const PayloadBlock &);
+  PayloadBlock &operator = (const PayloadBlock &);
+
+  uint8_t *m_data; //!< the bytes
+  uint32_t m_size; //!< the number of bytes
+  bool m_owned;    //!< true if the block owns its bytes
+};
+
+} // namespace ns3
+
+#endif /* PAYLOAD_BLOCK_H */
@@ -22,6 +22,10 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/double.h"
 #include "ns3/test.h"
+#include "ns3/core-config.h"
+#ifdef HAVE_PTHREAD_H
+#include <thread>
+#endif
 
 using namespace ns3;
 
@@ -389,6 +393,98 @@ BufferTest::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ (val1, val2, "Bad ReadNtohU16()");
 }
 
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * Buffer data storage allocator unit tests.
+ */
+class BufferAllocatorTest : public TestCase {
+public:
+  virtual void DoRun (void);
+  BufferAllocatorTest ();
+};
+
+BufferAllocatorTest::BufferAllocatorTest ()
+  : TestCase ("Buffer storage allocator")
+{
+}
+
+/**
+ * Create and destroy buffers of various sizes.
+ * \param count the number of buffers
+ */
+static void
+CreateBuffers (uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++)
+    {
+      Buffer buffer (100);
+      buffer.AddAtStart (20 + (i % 8) * 100);
+      buffer.Begin ().WriteU8 (1, 20);
+      Buffer copy = buffer;
+      copy.AddAtEnd (30);
+    }
+}
+
+void
+BufferAllocatorTest::DoRun (void)
+{
+  // Destroyed storage is reused by the next buffer
+  {
+    Buffer buffer (100);
+  }
+  Buffer::AllocatorStats before = Buffer::GetAllocatorStats ();
+  {
+    Buffer buffer (100);
+    buffer.AddAtStart (10);
+  }
+  Buffer::AllocatorStats after = Buffer::GetAllocatorStats ();
+  NS_TEST_EXPECT_MSG_EQ (after.created, before.created + 1, "Wrong number of created storages");
+  NS_TEST_EXPECT_MSG_EQ (after.reused, before.reused + 1, "Storage not reused");
+  NS_TEST_EXPECT_MSG_EQ (after.cachedBytes, before.cachedBytes, "Wrong cached size");
+  NS_TEST_EXPECT_MSG_EQ (after.heapBytes, before.heapBytes, "Storage allocated from the heap");
+
+  // Storage larger than the size classes comes from the heap
+  {
+    Buffer buffer;
+    buffer.AddAtStart (100000);
+    NS_TEST_EXPECT_MSG_GT (Buffer::GetAllocatorStats ().heapBytes, before.heapBytes + 100000,
+                           "Large storage not allocated from the heap");
+    NS_TEST_EXPECT_MSG_GT_OR_EQ (Buffer::GetAllocatorStats ().peakHeapBytes, before.heapBytes + 100000,
+                                 "Wrong peak heap size");
+  }
+  NS_TEST_EXPECT_MSG_EQ (Buffer::GetAllocatorStats ().heapBytes, before.heapBytes,
+                         "Large storage not freed");
+
+#ifdef HAVE_PTHREAD_H
+  // Threads create and destroy buffers concurrently, and release their
+  // free storage when they exit
+  std::vector<Buffer::AllocatorStats> stats (4);
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < stats.size (); i++)
+    {
+      threads.push_back (std::thread ([&stats, i] ()
+        {
+          CreateBuffers (10000);
+          stats[i] = Buffer::GetAllocatorStats ();
+        }));
+    }
+  for (std::thread &thread : threads)
+    {
+      thread.join ();
+    }
+  for (uint32_t i = 0; i < stats.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_GT_OR_EQ (stats[i].created, 10000, "Wrong number of created storages in thread " << i);
+      NS_TEST_EXPECT_MSG_GT (stats[i].reused + 100, stats[i].created, "Storage not reused in thread " << i);
+      NS_TEST_EXPECT_MSG_GT (stats[i].cachedBytes, 0, "No storage cached in thread " << i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (Buffer::GetAllocatorStats ().heapBytes, before.heapBytes,
+                         "Storage of the threads not released");
+#endif /* HAVE_PTHREAD_H */
+}
+
 /**
  * \ingroup network-test
  * \ingroup tests
@@ -405,6 +501,7 @@ BufferTestSuite::BufferTestSuite ()
   : TestSuite ("buffer", UNIT)
 {
   AddTestCase (new BufferTest, TestCase::QUICK);
+  AddTestCase (new BufferAllocatorTest, TestCase::QUICK);
 }
 
 static BufferTestSuite g_bufferTestSuite; //!< Static variable for test initialization
@@ -318,7 +318,11 @@ HistoryTrailer<N>::Deserialize (Buffer::Iterator start)
  */
 class PacketMetadataTest : public TestCase {
 public:
-  PacketMetadataTest ();
+  /**
+   * Constructor
+   * \param compact Whether to enable the compact metadata
+   */
+  PacketMetadataTest (bool compact);
   virtual ~PacketMetadataTest ();
   /**
    * Checks the packet header and trailer history
@@ -337,10 +341,13 @@ private:
    * \return The packet with the header added.
    */
   Ptr<Packet> DoAddHeader (Ptr<Packet> p);
+
+  bool m_compact; //!< Whether to enable the compact metadata
 };
 
-PacketMetadataTest::PacketMetadataTest ()
-  : TestCase ("Packet metadata")
+PacketMetadataTest::PacketMetadataTest (bool compact)
+  : TestCase (compact ? "Compact packet metadata" : "Packet metadata"),
+    m_compact (compact)
 {
 }
 
@@ -477,7 +484,14 @@ PacketMetadataTest::DoAddHeader (Ptr<Packet> p)
 void
 PacketMetadataTest::DoRun (void)
 {
-  PacketMetadata::Enable ();
+  if (m_compact)
+    {
+      PacketMetadata::EnableCompact ();
+    }
+  else
+    {
+      PacketMetadata::Enable ();
+    }
 
   Ptr<Packet> p = Create<Packet> (0);
   Ptr<Packet> p1 = Create<Packet> (0);
@@ -900,6 +914,33 @@ PacketMetadataTest::DoRun (void)
                                  p3->GetSize ());
   delete [] buf;
   NS_TEST_EXPECT_MSG_EQ (msg, std::string ("hello world"), "Could not find original data in received packet");
+
+  // more items than the compact metadata keeps inline
+  p = Create<Packet> (10);
+  ADD_HEADER (p, 1);
+  ADD_HEADER (p, 2);
+  ADD_HEADER (p, 3);
+  ADD_HEADER (p, 4);
+  ADD_TRAILER (p, 5);
+  ADD_TRAILER (p, 6);
+  ADD_TRAILER (p, 7);
+  p1 = p->Copy ();
+  ADD_HEADER (p, 8);
+  ADD_HEADER (p, 9);
+  CHECK_HISTORY (p, 10, 9, 8, 4, 3, 2, 1, 10, 5, 6, 7);
+  CHECK_HISTORY (p1, 8, 4, 3, 2, 1, 10, 5, 6, 7);
+  REM_HEADER (p, 9);
+  REM_HEADER (p, 8);
+  REM_TRAILER (p, 7);
+  CHECK_HISTORY (p, 7, 4, 3, 2, 1, 10, 5, 6);
+  p2 = p1->CreateFragment (0, 10);
+  p3 = p1->CreateFragment (10, p1->GetSize () - 10);
+  CHECK_HISTORY (p2, 4, 4, 3, 2, 1);
+  CHECK_HISTORY (p3, 4, 10, 5, 6, 7);
+  p2->AddAtEnd (p3);
+  CHECK_HISTORY (p2, 8, 4, 3, 2, 1, 10, 5, 6, 7);
+  p3 = p1->CreateFragment (2, 20);
+  CHECK_HISTORY (p3, 6, 2, 3, 2, 1, 10, 2);
 }
 
 
@@ -918,7 +959,8 @@ public:
 PacketMetadataTestSuite::PacketMetadataTestSuite ()
   : TestSuite ("packet-metadata", UNIT)
 {
-  AddTestCase (new PacketMetadataTest, TestCase::QUICK);
+  AddTestCase (new PacketMetadataTest (false), TestCase::QUICK);
+  AddTestCase (new PacketMetadataTest (true), TestCase::QUICK);
 }
 
 static PacketMetadataTestSuite g_packetMetadataTest; //!< Static variable for test initialization
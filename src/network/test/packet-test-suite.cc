@@ -863,7 +863,12 @@ PacketTest::DoRun (void)
 class PacketTagListTest : public TestCase
 {
 public:
-  PacketTagListTest ();
+  /**
+   * Constructor
+   * \param spilled Whether the tags of the lists are moved to the heap,
+   *        by a large tag added first.
+   */
+  PacketTagListTest (bool spilled);
   virtual ~PacketTagListTest ();
 private:
   void DoRun (void);
@@ -905,10 +910,13 @@ private:
    * \return the ticks to remove the tags.
    */
   int AddRemoveTime (const bool verbose = false);
+
+  bool m_spilled; //!< whether the tags of the lists are moved to the heap
 };
 
-PacketTagListTest::PacketTagListTest ()
-  : TestCase ("PacketTagListTest: ")
+PacketTagListTest::PacketTagListTest (bool spilled)
+  : TestCase (spilled ? "PacketTagListTest (spilled): " : "PacketTagListTest: "),
+    m_spilled (spilled)
 {
 }
 
@@ -1015,6 +1023,10 @@ PacketTagListTest::DoRun (void)
   MAKE_TEST_TAGS ;
   
   PacketTagList ref;  // empty list
+  if (m_spilled)
+    {
+      ref.Add (ALargeTestTag ());
+    }
   ref.Add (t1);       // last
   ref.Add (t2);       // post merge
   ref.Add (t3);       // merge successor
@@ -1030,6 +1042,21 @@ PacketTagListTest::DoRun (void)
     NS_TEST_EXPECT_MSG_EQ (ref.Peek (t10), false, "missing tag");
   }
 
+  { // Iteration
+    std::cout << GetName () << "check iteration order" << std::endl;
+    TypeId tids[] = { t7.GetTypeId (), t6.GetTypeId (), t5.GetTypeId (), t4.GetTypeId (),
+                      t3.GetTypeId (), t2.GetTypeId (), t1.GetTypeId (), ALargeTestTag::GetTypeId () };
+    uint32_t offset = 0;
+    PacketTagList::Item item;
+    int n = 0;
+    while (ref.Next (offset, item))
+      {
+        NS_TEST_EXPECT_MSG_EQ (item.tid, tids[n], "tag " << n);
+        n++;
+      }
+    NS_TEST_EXPECT_MSG_EQ (n, (m_spilled ? tagLast + 1 : tagLast), "number of tags");
+  }
+
   { // Copy ctor, assignment
     std::cout << GetName () << "check copy and assignment" << std::endl;
     { PacketTagList ptl (ref);
@@ -1108,7 +1135,9 @@ PacketTagListTest::DoRun (void)
     ReplaceCheck (6);
     ReplaceCheck (7);
   }
-  
+
+  // The spilled lists check the same operations, only time the default ones
+  if (!m_spilled)
   { // Timing
     std::cout << GetName () << "add+remove timing" << std::endl;
     int flm = std::numeric_limits<int>::max ();
@@ -1150,6 +1179,111 @@ PacketTagListTest::DoRun (void)
     
 }
 
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * Packets referencing the bytes of a PayloadBlock.
+ */
+class PacketPayloadBlockTest : public TestCase
+{
+public:
+  PacketPayloadBlockTest ();
+private:
+  void DoRun (void);
+  /**
+   * Checks the bytes of a packet against a block.
+   * \param p the packet
+   * \param block the block
+   * \param offset the offset of the packet bytes in the block
+   * \param msg a message to print in case of failure
+   */
+  void CheckBytes (Ptr<const Packet> p, Ptr<const PayloadBlock> block, uint32_t offset, std::string msg);
+};
+
+PacketPayloadBlockTest::PacketPayloadBlockTest ()
+  : TestCase ("Check packets referencing payload blocks")
+{
+}
+
+void
+PacketPayloadBlockTest::CheckBytes (Ptr<const Packet> p, Ptr<const PayloadBlock> block, uint32_t offset, std::string msg)
+{
+  std::vector<uint8_t> bytes (p->GetSize ());
+  NS_TEST_EXPECT_MSG_EQ (p->CopyData (bytes.data (), bytes.size ()), bytes.size (), msg);
+  NS_TEST_EXPECT_MSG_EQ (memcmp (bytes.data (), block->GetData () + offset, bytes.size ()), 0, msg);
+}
+
+void
+PacketPayloadBlockTest::DoRun (void)
+{
+  struct View
+  {
+    double x;
+    uint32_t y;
+  };
+  Ptr<PayloadBlock> block = Create<PayloadBlock> (1000);
+  for (uint32_t i = 0; i < block->GetSize (); i++)
+    {
+      block->GetData ()[i] = i * 7;
+    }
+
+  Ptr<Packet> p = Create<Packet> (block);
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 1000, "Wrong packet size");
+  NS_TEST_EXPECT_MSG_EQ ((p->PeekContiguousData (0, 1000) == block->GetData ()), true, "The payload was copied");
+  CheckBytes (p, block, 0, "Wrong payload");
+
+  // headers and trailers do not touch the block
+  p->AddHeader (ATestHeader<10> ());
+  p->AddTrailer (ATestTrailer<6> ());
+  Ptr<Packet> copy = p->Copy ();
+  NS_TEST_EXPECT_MSG_EQ ((copy->PeekContiguousData (10, 1000) == block->GetData ()), true, "The payload was copied");
+  NS_TEST_EXPECT_MSG_EQ ((copy->PeekContiguousData (5, 10) == 0), true, "Headers and payload are not contiguous");
+  ATestHeader<10> header;
+  copy->RemoveHeader (header);
+  NS_TEST_EXPECT_MSG_EQ (header.m_error, false, "Wrong header");
+  ATestTrailer<6> trailer;
+  copy->RemoveTrailer (trailer);
+  NS_TEST_EXPECT_MSG_EQ (trailer.m_error, false, "Wrong trailer");
+  CheckBytes (copy, block, 0, "Wrong payload after removing headers");
+
+  // views are only returned for aligned, contiguous bytes
+  NS_TEST_EXPECT_MSG_EQ ((copy->PeekView<View> (16) == reinterpret_cast<View const *> (block->GetData () + 16)),
+                         true, "Wrong view");
+  NS_TEST_EXPECT_MSG_EQ ((copy->PeekView<View> (3) == 0), true, "Unaligned view");
+  NS_TEST_EXPECT_MSG_EQ ((copy->PeekView<View> (995) == 0), true, "View past the end");
+  NS_TEST_EXPECT_MSG_EQ ((p->PeekView<View> (0) == 0), true, "View across headers and payload");
+
+  // fragments and slices share the block
+  Ptr<Packet> fragment = copy->CreateFragment (100, 200);
+  NS_TEST_EXPECT_MSG_EQ ((fragment->PeekContiguousData (0, 200) == block->GetData () + 100), true,
+                         "The fragment was copied");
+  CheckBytes (fragment, block, 100, "Wrong fragment");
+  fragment->RemoveAtStart (50);
+  fragment->RemoveAtEnd (50);
+  CheckBytes (fragment, block, 150, "Wrong trimmed fragment");
+  Ptr<Packet> slice = Create<Packet> (block, 300, 64);
+  NS_TEST_EXPECT_MSG_EQ (slice->GetSize (), 64, "Wrong slice size");
+  CheckBytes (slice, block, 300, "Wrong slice");
+
+  // concatenation and serialization copy the bytes
+  Ptr<Packet> whole = copy->CreateFragment (0, 300);
+  whole->AddAtEnd (copy->CreateFragment (300, 700));
+  NS_TEST_EXPECT_MSG_EQ (whole->GetSize (), 1000, "Wrong concatenated size");
+  CheckBytes (whole, block, 0, "Wrong concatenated payload");
+  std::vector<uint8_t> serialized (slice->GetSerializedSize ());
+  NS_TEST_EXPECT_MSG_EQ (slice->Serialize (serialized.data (), serialized.size ()), 1, "Serialization failed");
+  Ptr<Packet> deserialized = Create<Packet> (serialized.data (), serialized.size (), true);
+  CheckBytes (deserialized, block, 300, "Wrong deserialized payload");
+
+  // external memory
+  uint8_t external[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+  Ptr<const PayloadBlock> externalBlock = Create<PayloadBlock> (external, sizeof (external));
+  Ptr<Packet> ext = Create<Packet> (externalBlock, 4, 8);
+  NS_TEST_EXPECT_MSG_EQ ((ext->PeekContiguousData (0, 8) == external + 4), true, "The external bytes were copied");
+  CheckBytes (ext, externalBlock, 4, "Wrong external payload");
+}
+
 /**
  * \ingroup network-test
  * \ingroup tests
@@ -1166,7 +1300,9 @@ PacketTestSuite::PacketTestSuite ()
   : TestSuite ("packet", UNIT)
 {
   AddTestCase (new PacketTest, TestCase::QUICK);
-  AddTestCase (new PacketTagListTest, TestCase::QUICK);
+  AddTestCase (new PacketTagListTest (false), TestCase::QUICK);
+  AddTestCase (new PacketTagListTest (true), TestCase::QUICK);
+  AddTestCase (new PacketPayloadBlockTest, TestCase::QUICK);
 }
 
 static PacketTestSuite g_packetTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,282 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/tag.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/simple-net-device-helper.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/mac48-address.h"
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Tag of the packets sent around the ring.
+ */
+class PacketRingTag : public Tag
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::PacketRingTag")
+      .SetParent<Tag> ()
+      .SetGroupName ("Network")
+      .AddConstructor<PacketRingTag> ()
+    ;
+    return tid;
+  }
+  virtual TypeId GetInstanceTypeId (void) const
+  {
+    return GetTypeId ();
+  }
+  virtual uint32_t GetSerializedSize (void) const
+  {
+    return 12;
+  }
+  virtual void Serialize (TagBuffer i) const
+  {
+    i.WriteU32 (origin);
+    i.WriteU32 (k);
+    i.WriteU32 (hops);
+  }
+  virtual void Deserialize (TagBuffer i)
+  {
+    origin = i.ReadU32 ();
+    k = i.ReadU32 ();
+    hops = i.ReadU32 ();
+  }
+  virtual void Print (std::ostream &os) const
+  {
+    os << "origin=" << origin << " k=" << k << " hops=" << hops;
+  }
+
+  uint32_t origin; //!< Node which sent the packet.
+  uint32_t k;      //!< Index of the packet in the node.
+  uint32_t hops;   //!< Number of times the packet was forwarded.
+};
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Nodes in a ring of SimpleChannel links, each sending a packet
+ * to the next node every millisecond.  The nodes forward the packets
+ * they receive for a few hops, adding a header and updating a tag, so
+ * that packets, and the buffers and tags their copies share, cross the
+ * partitions of the ParallelSimulatorImpl.
+ */
+class ParallelPacketRingTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor.
+   * \param [in] threads The number of threads.
+   */
+  ParallelPacketRingTestCase (uint32_t threads);
+  virtual void DoRun (void);
+
+private:
+  /** The packets received by a node, as (timestamp, value) pairs. */
+  typedef std::vector<std::pair<int64_t, uint32_t> > Log;
+
+  /**
+   * Run the scenario.
+   * \param [in] simulatorType The simulator implementation.
+   * \returns The logs of all nodes.
+   */
+  std::vector<Log> RunRing (std::string simulatorType);
+  /**
+   * Send a new packet to the next node.
+   * \param [in] node The index of the sending node.
+   * \param [in] k The index of the packet.
+   */
+  void Send (uint32_t node, uint32_t k);
+  /**
+   * Receive a packet and forward it to the next node.
+   * \param [in] device The receiving device.
+   * \param [in] packet The packet.
+   * \param [in] protocol The protocol number.
+   * \param [in] from The sender address.
+   * \returns \c true.
+   */
+  bool Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol, const Address &from);
+
+  uint32_t m_threads;                //!< Number of threads.
+  NodeContainer m_nodes;             //!< The nodes.
+  std::vector<Ptr<NetDevice> > m_tx; //!< The device of each node to the next node.
+  std::vector<Log> m_logs;           //!< The logs of the nodes.
+  std::vector<int> m_ok;             //!< Whether each node saw consistent packets.
+};
+
+/** Number of nodes in the ring. */
+static const uint32_t PACKET_RING_NODES = 8;
+/** Number of packets sent by each node. */
+static const uint32_t PACKET_RING_PACKETS = 100;
+/** Number of times a packet is forwarded. */
+static const uint32_t PACKET_RING_HOPS = 3;
+/** Payload size of the packets. */
+static const uint32_t PACKET_RING_SIZE = 100;
+
+ParallelPacketRingTestCase::ParallelPacketRingTestCase (uint32_t threads)
+  : TestCase ("Check packets forwarded around a ring of nodes with " + std::to_string (threads) + " threads"),
+    m_threads (threads)
+{}
+
+void
+ParallelPacketRingTestCase::Send (uint32_t node, uint32_t k)
+{
+  Ptr<Packet> packet = Create<Packet> (PACKET_RING_SIZE);
+  PacketRingTag tag;
+  tag.origin = node;
+  tag.k = k;
+  tag.hops = 0;
+  packet->AddPacketTag (tag);
+  packet->AddByteTag (tag);
+  m_tx[node]->Send (packet, Mac48Address::GetBroadcast (), 0x0800);
+  if (k + 1 < PACKET_RING_PACKETS)
+    {
+      Simulator::Schedule (MilliSeconds (1), &ParallelPacketRingTestCase::Send, this, node, k + 1);
+    }
+}
+
+bool
+ParallelPacketRingTestCase::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                     const Address &from)
+{
+  uint32_t node = device->GetNode ()->GetId () - m_nodes.Get (0)->GetId ();
+  PacketRingTag tag;
+  bool found = packet->PeekPacketTag (tag);
+  m_ok[node] = m_ok[node] && found
+    && Simulator::GetContext () == device->GetNode ()->GetId ()
+    && (tag.origin + tag.hops + 1) % PACKET_RING_NODES == node
+    && packet->GetSize () == PACKET_RING_SIZE + tag.hops * LlcSnapHeader ().GetSerializedSize ();
+  m_logs[node].push_back (std::make_pair (Simulator::Now ().GetTimeStep (),
+                                          1000 * (10 * tag.origin + tag.hops) + tag.k));
+
+  if (tag.hops < PACKET_RING_HOPS)
+    {
+      // The copy shares the buffer and tags of the packet of the sender
+      Ptr<Packet> copy = packet->Copy ();
+      tag.hops++;
+      copy->ReplacePacketTag (tag);
+      LlcSnapHeader llc;
+      llc.SetType (tag.hops);
+      copy->AddHeader (llc);
+      m_tx[node]->Send (copy, Mac48Address::GetBroadcast (), protocol);
+    }
+  return true;
+}
+
+std::vector<ParallelPacketRingTestCase::Log>
+ParallelPacketRingTestCase::RunRing (std::string simulatorType)
+{
+  Config::SetGlobal ("SimulatorImplementationType", StringValue (simulatorType));
+  Config::SetDefault ("ns3::ParallelSimulatorImpl::Threads", UintegerValue (m_threads));
+  Config::SetDefault ("ns3::ParallelSimulatorImpl::Lookahead", TimeValue (MicroSeconds (10)));
+
+  m_nodes.Create (PACKET_RING_NODES);
+  SimpleNetDeviceHelper helper;
+  helper.SetChannelAttribute ("Delay", TimeValue (MicroSeconds (10)));
+  m_tx.clear ();
+  for (uint32_t node = 0; node < PACKET_RING_NODES; node++)
+    {
+      NetDeviceContainer devices = helper.Install (NodeContainer (m_nodes.Get (node),
+                                                                  m_nodes.Get ((node + 1) % PACKET_RING_NODES)));
+      devices.Get (1)->SetReceiveCallback (MakeCallback (&ParallelPacketRingTestCase::Receive, this));
+      m_tx.push_back (devices.Get (0));
+    }
+
+  m_logs.assign (PACKET_RING_NODES, Log ());
+  m_ok.assign (PACKET_RING_NODES, 1);
+  for (uint32_t node = 0; node < PACKET_RING_NODES; node++)
+    {
+      // Distinct time stamps in each node, so that its log does not
+      // depend on the order of simultaneous events
+      Simulator::ScheduleWithContext (m_nodes.Get (node)->GetId (), MicroSeconds (node),
+                                      &ParallelPacketRingTestCase::Send, this, node, 0);
+    }
+  Simulator::Run ();
+  m_tx.clear ();
+  m_nodes = NodeContainer ();
+  Simulator::Destroy ();
+
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+  for (uint32_t node = 0; node < PACKET_RING_NODES; node++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_ok[node], 1, "Wrong context or packet in node " << node
+                             << " with " << simulatorType);
+    }
+  return m_logs;
+}
+
+void
+ParallelPacketRingTestCase::DoRun (void)
+{
+  std::vector<Log> reference = RunRing ("ns3::DefaultSimulatorImpl");
+  std::vector<Log> logs = RunRing ("ns3::ParallelSimulatorImpl");
+  for (uint32_t node = 0; node < PACKET_RING_NODES; node++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (reference[node].size (), PACKET_RING_PACKETS * (PACKET_RING_HOPS + 1),
+                             "Wrong number of packets received by node " << node);
+      NS_TEST_ASSERT_MSG_EQ (logs[node].size (), reference[node].size (),
+                             "Wrong number of packets received by node " << node);
+      for (std::size_t i = 0; i < logs[node].size (); i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (logs[node][i].first, reference[node][i].first,
+                                 "Wrong time of packet " << i << " in node " << node);
+          NS_TEST_ASSERT_MSG_EQ (logs[node][i].second, reference[node][i].second,
+                                 "Wrong packet " << i << " in node " << node);
+        }
+    }
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief The packets of the parallel simulator TestSuite.
+ */
+class ParallelPacketTestSuite : public TestSuite
+{
+public:
+  ParallelPacketTestSuite ()
+    : TestSuite ("parallel-simulator-packets")
+  {
+    AddTestCase (new ParallelPacketRingTestCase (1), TestCase::QUICK);
+#ifdef ENABLE_THREAD_SAFE_OBJECTS
+    AddTestCase (new ParallelPacketRingTestCase (4), TestCase::QUICK);
+    AddTestCase (new ParallelPacketRingTestCase (3), TestCase::QUICK);
+#endif
+  }
+};
+
+/** Static variable for test initialization. */
+static ParallelPacketTestSuite g_parallelPacketTestSuite;
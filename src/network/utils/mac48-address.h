@@ -90,6 +90,16 @@ public:
    */
   static Mac48Address Allocate (void);
 
+  /**
+   * Reset the Mac48Address allocation index.
+   *
+   * This function resets (to zero) the global integer
+   * that is used for unique address allocation. It is
+   * intended for running several independent simulations
+   * in a single process.
+   */
+  static void ResetAllocationIndex (void);
+
   /**
    * \returns true if this is a broadcast address, false otherwise.
    */
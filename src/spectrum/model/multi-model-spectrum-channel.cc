@@ -235,6 +235,8 @@ MultiModelSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
   NS_LOG_LOGIC ("converter map size: " << txInfoIteratorerator->second.m_spectrumConverterMap.size ());
   NS_LOG_LOGIC ("converter map first element: " << txInfoIteratorerator->second.m_spectrumConverterMap.begin ()->first);
 
+  // receptions are scheduled all at once after the loop
+  std::vector<Simulator::ContextEvent> receptions;
   for (RxSpectrumModelInfoMap_t::const_iterator rxInfoIterator = m_rxSpectrumModelInfoMap.begin ();
        rxInfoIterator != m_rxSpectrumModelInfoMap.end ();
        ++rxInfoIterator)
@@ -332,20 +334,21 @@ MultiModelSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
                 {
                   // the receiver has a NetDevice, so we expect that it is attached to a Node
                   uint32_t dstNode =  netDev->GetNode ()->GetId ();
-                  Simulator::ScheduleWithContext (dstNode, delay, &MultiModelSpectrumChannel::StartRx, this,
-                                                  rxParams, *rxPhyIterator);
+                  receptions.push_back ({dstNode, delay, MakeEvent (&MultiModelSpectrumChannel::StartRx, this,
+                                                                    rxParams, *rxPhyIterator)});
                 }
               else
                 {
                   // the receiver is not attached to a NetDevice, so we cannot assume that it is attached to a node
-                  Simulator::Schedule (delay, &MultiModelSpectrumChannel::StartRx, this,
-                                       rxParams, *rxPhyIterator);
+                  receptions.push_back ({Simulator::GetContext (), delay, MakeEvent (&MultiModelSpectrumChannel::StartRx, this,
+                                                                                     rxParams, *rxPhyIterator)});
                 }
             }
         }
 
     }
 
+  Simulator::ScheduleBatchWithContext (receptions);
 }
 
 void
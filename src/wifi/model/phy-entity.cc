@@ -359,7 +359,7 @@ PhyEntity::DoEndReceiveField (WifiPpduField field, Ptr<Event> event)
 }
 
 void
-PhyEntity::StartReceivePreamble (Ptr<WifiPpdu> ppdu, RxPowerWattPerChannelBand rxPowersW,
+PhyEntity::StartReceivePreamble (Ptr<const WifiPpdu> ppdu, RxPowerWattPerChannelBand rxPowersW,
                                  Time /* rxDuration */)
 {
   //The total RX power corresponds to the maximum over all the bands
@@ -1078,7 +1078,7 @@ PhyEntity::CalculateTxDuration (WifiConstPsduMap psduMap, const WifiTxVector& tx
 }
 
 bool
-PhyEntity::CanReceivePpdu (Ptr<WifiPpdu> ppdu, uint16_t txCenterFreq) const
+PhyEntity::CanReceivePpdu (Ptr<const WifiPpdu> ppdu, uint16_t txCenterFreq) const
 {
   NS_LOG_FUNCTION (this << ppdu << txCenterFreq);
 
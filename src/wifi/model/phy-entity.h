@@ -365,7 +365,7 @@ public:
    * \param rxPowersW the receive power in W per band
    * \param rxDuration the duration of the PPDU
    */
-  virtual void StartReceivePreamble (Ptr<WifiPpdu> ppdu, RxPowerWattPerChannelBand rxPowersW,
+  virtual void StartReceivePreamble (Ptr<const WifiPpdu> ppdu, RxPowerWattPerChannelBand rxPowersW,
                                      Time rxDuration);
   /**
    * Start receiving a given field.
@@ -489,7 +489,7 @@ public:
    *        PPDU is transmitted
    * \return true if this PPDU can be received, false otherwise
    */
-  virtual bool CanReceivePpdu (Ptr<WifiPpdu> ppdu, uint16_t txCenterFreq) const;
+  virtual bool CanReceivePpdu (Ptr<const WifiPpdu> ppdu, uint16_t txCenterFreq) const;
 
 protected:
   /**
@@ -47,6 +47,11 @@ typedef std::unordered_map <uint16_t /* STA-ID */, Ptr<const WifiPsdu> /* PSDU *
  *
  * WifiPpdu stores a preamble, a modulation class, PHY headers and a PSDU.
  * This class should be subclassed for each amendment.
+ *
+ * Once transmitted, a PPDU is shared by every receiver and must not be
+ * modified: the receive path only handles Ptr<const WifiPpdu>. Code that
+ * needs a modified PPDU has to Copy it first, and the PHY copies the PSDUs
+ * before handing them to the MAC.
  */
 class WifiPpdu : public SimpleRefCount<WifiPpdu>
 {
@@ -18,7 +18,10 @@
  * Author: Mathieu Lacage, <mathieu.lacage@sophia.inria.fr>
  */
 
+#include <algorithm>
+#include <cmath>
 #include "ns3/simulator.h"
+#include "ns3/double.h"
 #include "ns3/log.h"
 #include "ns3/pointer.h"
 #include "ns3/net-device.h"
@@ -53,11 +56,24 @@ YansWifiChannel::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&YansWifiChannel::m_delay),
                    MakePointerChecker<PropagationDelayModel> ())
+    .AddAttribute ("MaxRange",
+                   "Receivers further than this distance (m) from the sender are skipped. "
+                   "Only set this if the propagation loss model guarantees a received power "
+                   "below the sensitivity of every PHY beyond this range, and consumes no "
+                   "random numbers. Mobility models must notify a course change whenever "
+                   "their speed changes. Zero considers every receiver.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&YansWifiChannel::SetMaxRange,
+                                       &YansWifiChannel::GetMaxRange),
+                   MakeDoubleChecker<double> (0.0))
   ;
   return tid;
 }
 
 YansWifiChannel::YansWifiChannel ()
+  : m_maxRange (0.0),
+    m_receiverGridValid (false),
+    m_receiverGridSpeed (0.0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -68,6 +84,22 @@ YansWifiChannel::~YansWifiChannel ()
   m_phyList.clear ();
 }
 
+void
+YansWifiChannel::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < m_trackedMobility.size (); i++)
+    {
+      Callback<void, Ptr<const MobilityModel> > notify =
+        MakeCallback (&YansWifiChannel::NotifyCourseChange, this).Bind (i);
+      m_trackedMobility[i]->TraceDisconnectWithoutContext ("CourseChange", notify);
+    }
+  m_trackedMobility.clear ();
+  m_receiverGrid.clear ();
+  m_receiverCell.clear ();
+  Channel::DoDispose ();
+}
+
 void
 YansWifiChannel::SetPropagationLossModel (const Ptr<PropagationLossModel> loss)
 {
@@ -88,42 +120,177 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const WifiPpdu> ppdu, double
   NS_LOG_FUNCTION (this << sender << ppdu << txPowerDbm);
   Ptr<MobilityModel> senderMobility = sender->GetMobility ();
   NS_ASSERT (senderMobility != 0);
-  for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++)
+  std::vector<Simulator::ContextEvent> receptions;
+  if (m_maxRange == 0)
     {
-      if (sender != (*i))
+      receptions.reserve (m_phyList.size ());
+      for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++)
         {
-          //For now don't account for inter channel interference nor channel bonding
-          if ((*i)->GetChannelNumber () != sender->GetChannelNumber ())
+          if (sender != (*i))
             {
-              continue;
+              SendToReceiver (sender, senderMobility, *i, ppdu, txPowerDbm, receptions);
             }
-
-          Ptr<MobilityModel> receiverMobility = (*i)->GetMobility ()->GetObject<MobilityModel> ();
-          Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
-          double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
-          NS_LOG_DEBUG ("propagation: txPower=" << txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
-                        "distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
-          Ptr<WifiPpdu> copy = ppdu->Copy ();
-          Ptr<NetDevice> dstNetDevice = (*i)->GetDevice ();
-          uint32_t dstNode;
-          if (dstNetDevice == 0)
+        }
+    }
+  else
+    {
+      Vector senderPosition = senderMobility->GetPosition ();
+      std::vector<uint32_t> candidates;
+      GetCandidateReceivers (senderPosition, candidates);
+      for (uint32_t index : candidates)
+        {
+          Ptr<YansWifiPhy> receiver = m_phyList[index];
+          if (sender != receiver
+              && CalculateDistance (senderPosition, receiver->GetMobility ()->GetPosition ()) <= m_maxRange)
             {
-              dstNode = 0xffffffff;
+              SendToReceiver (sender, senderMobility, receiver, ppdu, txPowerDbm, receptions);
             }
-          else
+        }
+    }
+  Simulator::ScheduleBatchWithContext (receptions);
+}
+
+void
+YansWifiChannel::SendToReceiver (Ptr<YansWifiPhy> sender, Ptr<MobilityModel> senderMobility,
+                                 Ptr<YansWifiPhy> receiver, Ptr<const WifiPpdu> ppdu,
+                                 double txPowerDbm,
+                                 std::vector<Simulator::ContextEvent> &receptions) const
+{
+  //For now don't account for inter channel interference nor channel bonding
+  if (receiver->GetChannelNumber () != sender->GetChannelNumber ())
+    {
+      return;
+    }
+
+  Ptr<MobilityModel> receiverMobility = receiver->GetMobility ()->GetObject<MobilityModel> ();
+  Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
+  double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+  NS_LOG_DEBUG ("propagation: txPower=" << txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
+                "distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
+  Ptr<NetDevice> dstNetDevice = receiver->GetDevice ();
+  uint32_t dstNode;
+  if (dstNetDevice == 0)
+    {
+      dstNode = 0xffffffff;
+    }
+  else
+    {
+      dstNode = dstNetDevice->GetNode ()->GetId ();
+    }
+
+  receptions.push_back ({dstNode, delay, MakeEvent (&YansWifiChannel::Receive, receiver, ppdu, rxPowerDbm)});
+}
+
+void
+YansWifiChannel::NotifyCourseChange (uint32_t index, Ptr<const MobilityModel> mobility) const
+{
+  if (!m_receiverGridValid)
+    {
+      return;
+    }
+  //The receiver moves from its current position at its new speed, so the drift bound
+  //still holds if it covers the new speed
+  m_receiverGridSpeed = std::max (m_receiverGridSpeed, mobility->GetVelocity ().GetLength ());
+  uint64_t key = GetCellKey (mobility->GetPosition ());
+  if (key != m_receiverCell[index])
+    {
+      std::vector<uint32_t> &cell = m_receiverGrid[m_receiverCell[index]];
+      cell.erase (std::find (cell.begin (), cell.end (), index));
+      m_receiverGrid[key].push_back (index);
+      m_receiverCell[index] = key;
+    }
+}
+
+uint64_t
+YansWifiChannel::GetCellKey (int64_t x, int64_t y, int64_t z)
+{
+  //21 bits per axis. Cells that alias only add candidates, which are filtered by distance
+  const uint64_t mask = (1 << 21) - 1;
+  return ((static_cast<uint64_t> (x) & mask) << 42)
+         | ((static_cast<uint64_t> (y) & mask) << 21)
+         | (static_cast<uint64_t> (z) & mask);
+}
+
+uint64_t
+YansWifiChannel::GetCellKey (const Vector &position) const
+{
+  return GetCellKey (static_cast<int64_t> (std::floor (position.x / m_maxRange)),
+                     static_cast<int64_t> (std::floor (position.y / m_maxRange)),
+                     static_cast<int64_t> (std::floor (position.z / m_maxRange)));
+}
+
+void
+YansWifiChannel::RebuildReceiverGrid (void) const
+{
+  NS_LOG_FUNCTION (this);
+  //PHYs added since the last rebuild need their course changes tracked
+  for (uint32_t i = m_trackedMobility.size (); i < m_phyList.size (); i++)
+    {
+      Ptr<MobilityModel> mobility = m_phyList[i]->GetMobility ();
+      NS_ABORT_MSG_IF (mobility == 0, "MaxRange needs a mobility model for every PHY");
+      Callback<void, Ptr<const MobilityModel> > notify =
+        MakeCallback (&YansWifiChannel::NotifyCourseChange, this).Bind (i);
+      mobility->TraceConnectWithoutContext ("CourseChange", notify);
+      m_trackedMobility.push_back (mobility);
+    }
+
+  for (auto &cell : m_receiverGrid)
+    {
+      cell.second.clear ();
+    }
+  m_receiverCell.resize (m_phyList.size ());
+  m_receiverGridSpeed = 0;
+  for (uint32_t i = 0; i < m_phyList.size (); i++)
+    {
+      uint64_t key = GetCellKey (m_trackedMobility[i]->GetPosition ());
+      m_receiverGrid[key].push_back (i);
+      m_receiverCell[i] = key;
+      m_receiverGridSpeed = std::max (m_receiverGridSpeed, m_trackedMobility[i]->GetVelocity ().GetLength ());
+    }
+  m_receiverGridTime = Simulator::Now ();
+  m_receiverGridValid = true;
+}
+
+void
+YansWifiChannel::GetCandidateReceivers (const Vector &position, std::vector<uint32_t> &candidates) const
+{
+  double drift = m_receiverGridSpeed * (Simulator::Now () - m_receiverGridTime).GetSeconds ();
+  if (!m_receiverGridValid || drift > m_maxRange)
+    {
+      RebuildReceiverGrid ();
+      drift = 0;
+    }
+
+  //A receiver within range now was within range plus its drift when the grid was built
+  double reach = m_maxRange + drift;
+  int64_t minX = static_cast<int64_t> (std::floor ((position.x - reach) / m_maxRange));
+  int64_t maxX = static_cast<int64_t> (std::floor ((position.x + reach) / m_maxRange));
+  int64_t minY = static_cast<int64_t> (std::floor ((position.y - reach) / m_maxRange));
+  int64_t maxY = static_cast<int64_t> (std::floor ((position.y + reach) / m_maxRange));
+  int64_t minZ = static_cast<int64_t> (std::floor ((position.z - reach) / m_maxRange));
+  int64_t maxZ = static_cast<int64_t> (std::floor ((position.z + reach) / m_maxRange));
+  for (int64_t x = minX; x <= maxX; x++)
+    {
+      for (int64_t y = minY; y <= maxY; y++)
+        {
+          for (int64_t z = minZ; z <= maxZ; z++)
             {
-              dstNode = dstNetDevice->GetNode ()->GetId ();
+              auto cell = m_receiverGrid.find (GetCellKey (x, y, z));
+              if (cell != m_receiverGrid.end ())
+                {
+                  candidates.insert (candidates.end (), cell->second.begin (), cell->second.end ());
+                }
             }
-
-          Simulator::ScheduleWithContext (dstNode,
-                                          delay, &YansWifiChannel::Receive,
-                                          (*i), copy, rxPowerDbm);
         }
     }
+  //Receptions are scheduled in PHY order, as without MaxRange, so simultaneous events keep
+  //their order. Sorting also removes duplicates from aliased cells
+  std::sort (candidates.begin (), candidates.end ());
+  candidates.erase (std::unique (candidates.begin (), candidates.end ()), candidates.end ());
 }
 
 void
-YansWifiChannel::Receive (Ptr<YansWifiPhy> phy, Ptr<WifiPpdu> ppdu, double rxPowerDbm)
+YansWifiChannel::Receive (Ptr<YansWifiPhy> phy, Ptr<const WifiPpdu> ppdu, double rxPowerDbm)
 {
   NS_LOG_FUNCTION (phy << ppdu << rxPowerDbm);
   // Do no further processing if signal is too weak
@@ -155,6 +322,22 @@ YansWifiChannel::Add (Ptr<YansWifiPhy> phy)
 {
   NS_LOG_FUNCTION (this << phy);
   m_phyList.push_back (phy);
+  m_receiverGridValid = false;
+}
+
+void
+YansWifiChannel::SetMaxRange (double maxRange)
+{
+  NS_LOG_FUNCTION (this << maxRange);
+  m_maxRange = maxRange;
+  //The cells of the grid are MaxRange wide
+  m_receiverGridValid = false;
+}
+
+double
+YansWifiChannel::GetMaxRange (void) const
+{
+  return m_maxRange;
 }
 
 int64_t
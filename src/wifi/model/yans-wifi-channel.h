@@ -21,7 +21,12 @@
 #ifndef YANS_WIFI_CHANNEL_H
 #define YANS_WIFI_CHANNEL_H
 
+#include <unordered_map>
+#include <vector>
 #include "ns3/channel.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+#include "ns3/vector.h"
 
 namespace ns3 {
 
@@ -32,6 +37,7 @@ class YansWifiPhy;
 class Packet;
 class Time;
 class WifiPpdu;
+class MobilityModel;
 
 /**
  * \brief a channel to interconnect ns3::YansWifiPhy objects.
@@ -41,6 +47,16 @@ class WifiPpdu;
  * class and supports an ns3::PropagationLossModel and an
  * ns3::PropagationDelayModel.  By default, no propagation models are set;
  * it is the caller's responsibility to set them before using the channel.
+ *
+ * When the MaxRange attribute is set, receivers further than MaxRange from
+ * the sender are skipped without computing their propagation loss or
+ * scheduling their reception. Candidate receivers are looked up in a uniform
+ * grid of receiver positions with a cell size of MaxRange. A receiver is
+ * moved to the cell of its current position when its mobility model
+ * notifies a course change, and the highest receiver speed seen since the
+ * grid was built bounds how far receivers may have drifted from their cell
+ * since. The grid is rebuilt when that drift exceeds MaxRange, when a PHY
+ * is added, and when MaxRange changes.
  */
 class YansWifiChannel : public Channel
 {
@@ -97,6 +113,18 @@ public:
    */
   int64_t AssignStreams (int64_t stream);
 
+  /**
+   * \param maxRange the distance (m) beyond which receivers are skipped, 0 to disable
+   */
+  void SetMaxRange (double maxRange);
+  /**
+   * \return the distance (m) beyond which receivers are skipped, 0 if disabled
+   */
+  double GetMaxRange (void) const;
+
+
+protected:
+  virtual void DoDispose (void);
 
 private:
   /**
@@ -107,17 +135,77 @@ private:
   /**
    * This method is scheduled by Send for each associated YansWifiPhy.
    * The method then calls the corresponding YansWifiPhy that the first
-   * bit of the PPDU has arrived.
+   * bit of the PPDU has arrived. All receivers share the PPDU sent by the
+   * sender.
    *
    * \param receiver the device to which the packet is destined
    * \param ppdu the PPDU being sent
    * \param txPowerDbm the TX power associated to the packet being sent (dBm)
    */
-  static void Receive (Ptr<YansWifiPhy> receiver, Ptr<WifiPpdu> ppdu, double txPowerDbm);
+  static void Receive (Ptr<YansWifiPhy> receiver, Ptr<const WifiPpdu> ppdu, double txPowerDbm);
+
+  /**
+   * Compute the propagation to one receiver and add its reception to the
+   * receptions to schedule.
+   *
+   * \param sender the PHY object from which the packet is originating
+   * \param senderMobility the mobility model of the sender
+   * \param receiver the PHY object to deliver the PPDU to
+   * \param ppdu the PPDU to send
+   * \param txPowerDbm the TX power associated to the packet, in dBm
+   * \param receptions the receptions to schedule
+   */
+  void SendToReceiver (Ptr<YansWifiPhy> sender, Ptr<MobilityModel> senderMobility,
+                       Ptr<YansWifiPhy> receiver, Ptr<const WifiPpdu> ppdu,
+                       double txPowerDbm,
+                       std::vector<Simulator::ContextEvent> &receptions) const;
+
+  /**
+   * Move a receiver to the grid cell of its current position. Connected to
+   * the CourseChange trace of every receiver mobility model.
+   *
+   * \param index the index of the receiver in m_phyList
+   * \param mobility the mobility model that changed course
+   */
+  void NotifyCourseChange (uint32_t index, Ptr<const MobilityModel> mobility) const;
+
+  /**
+   * Rebuild the receiver grid from the current receiver positions.
+   */
+  void RebuildReceiverGrid (void) const;
+
+  /**
+   * Get the PHYs that may be within MaxRange of a position.
+   *
+   * \param position the position of the sender
+   * \param candidates filled with indices into m_phyList, in ascending order
+   */
+  void GetCandidateReceivers (const Vector &position, std::vector<uint32_t> &candidates) const;
+
+  /**
+   * \param x the cell index along the x axis
+   * \param y the cell index along the y axis
+   * \param z the cell index along the z axis
+   * \return the key of the cell in m_receiverGrid
+   */
+  static uint64_t GetCellKey (int64_t x, int64_t y, int64_t z);
+  /**
+   * \param position a position
+   * \return the key of the cell of the position in m_receiverGrid
+   */
+  uint64_t GetCellKey (const Vector &position) const;
 
   PhyList m_phyList;                   //!< List of YansWifiPhys connected to this YansWifiChannel
   Ptr<PropagationLossModel> m_loss;    //!< Propagation loss model
   Ptr<PropagationDelayModel> m_delay;  //!< Propagation delay model
+  double m_maxRange;                   //!< Receivers further than this (m) are skipped, 0 to disable
+
+  mutable std::unordered_map<uint64_t, std::vector<uint32_t> > m_receiverGrid; //!< Indices into m_phyList by grid cell
+  mutable std::vector<uint64_t> m_receiverCell; //!< Key of the grid cell of each PHY
+  mutable bool m_receiverGridValid;    //!< False after a new PHY or a MaxRange change
+  mutable Time m_receiverGridTime;     //!< Time the receiver grid was built
+  mutable double m_receiverGridSpeed;  //!< Highest receiver speed (m/s) since the grid was built
+  mutable std::vector<Ptr<MobilityModel> > m_trackedMobility; //!< Mobility models whose CourseChange is connected
 };
 
 } //namespace ns3
@@ -52,6 +52,9 @@
 #include "ns3/frame-exchange-manager.h"
 #include "ns3/wifi-default-protection-manager.h"
 #include "ns3/wifi-default-ack-manager.h"
+#include "ns3/ofdm-ppdu.h"
+#include "ns3/ofdm-phy.h"
+#include "ns3/double.h"
 
 using namespace ns3;
 
@@ -3148,6 +3151,132 @@ HeRuMcsDataRateTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (retval, true, "Data rate verification for RUs above 52-tone RU (included) failed");
 }
 
+//-----------------------------------------------------------------------------
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Make sure that YansWifiChannel skips exactly the receivers beyond MaxRange,
+ * including after they move and after MaxRange changes
+ */
+class YansWifiChannelMaxRangeTest : public TestCase
+{
+public:
+  YansWifiChannelMaxRangeTest ();
+
+private:
+  /**
+   * Propagation loss model that counts the receivers it is asked about and
+   * returns a power low enough for every reception to be dropped
+   */
+  class CountingLossModel : public PropagationLossModel
+  {
+  public:
+    uint32_t m_count {0}; ///< number of CalcRxPower calls
+
+  private:
+    double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+    {
+      const_cast<CountingLossModel *> (this)->m_count++;
+      return -1000;
+    }
+    int64_t DoAssignStreams (int64_t stream)
+    {
+      return 0;
+    }
+  };
+
+  /**
+   * Send one PPDU from the first PHY. MaxRange is only set if it changed, so
+   * that the channel keeps its receiver grid otherwise
+   * \param maxRange the MaxRange of the channel
+   * \return the number of receivers the channel computed the loss to
+   */
+  uint32_t SendFromFirst (double maxRange);
+  virtual void DoRun (void);
+
+  Ptr<YansWifiChannel> m_channel; ///< the channel
+  Ptr<CountingLossModel> m_loss; ///< the loss model
+  std::vector<Ptr<ConstantPositionMobilityModel> > m_mobility; ///< the PHY positions
+};
+
+YansWifiChannelMaxRangeTest::YansWifiChannelMaxRangeTest ()
+  : TestCase ("Check that YansWifiChannel skips only the receivers beyond MaxRange")
+{
+}
+
+uint32_t
+YansWifiChannelMaxRangeTest::SendFromFirst (double maxRange)
+{
+  DoubleValue currentRange;
+  m_channel->GetAttribute ("MaxRange", currentRange);
+  if (currentRange.Get () != maxRange)
+    {
+      m_channel->SetAttribute ("MaxRange", DoubleValue (maxRange));
+    }
+  m_loss->m_count = 0;
+  Ptr<Packet> pkt = Create<Packet> (100);
+  WifiMacHeader hdr;
+  hdr.SetType (WIFI_MAC_QOSDATA);
+  Ptr<WifiPsdu> psdu = Create<WifiPsdu> (pkt, hdr);
+  WifiTxVector txVector = WifiTxVector (OfdmPhy::GetOfdmRate6Mbps (), 0, WIFI_PREAMBLE_LONG, 800, 1, 1, 0, 20, false);
+  Ptr<WifiPpdu> ppdu = Create<OfdmPpdu> (psdu, txVector, WIFI_PHY_BAND_5GHZ, 0);
+  m_channel->Send (DynamicCast<YansWifiPhy> (m_channel->GetDevice (0)->GetObject<WifiNetDevice> ()->GetPhy ()),
+                   ppdu, 0);
+  Simulator::Run ();
+  return m_loss->m_count;
+}
+
+void
+YansWifiChannelMaxRangeTest::DoRun (void)
+{
+  m_channel = CreateObject<YansWifiChannel> ();
+  m_loss = Create<CountingLossModel> ();
+  m_channel->SetPropagationLossModel (m_loss);
+  m_channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+
+  //A sender at the origin and receivers 50 m apart along the x axis, plus one near
+  //the sender in every other direction
+  std::vector<Vector> positions = {Vector (0, 0, 0), Vector (50, 0, 0), Vector (100, 0, 0),
+                                   Vector (150, 0, 0), Vector (-99, 0, 0), Vector (0, -99, 0),
+                                   Vector (0, 0, 99), Vector (-80, -70, 0)};
+  for (const Vector &position : positions)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<WifiNetDevice> device = CreateObject<WifiNetDevice> ();
+      Ptr<YansWifiPhy> phy = CreateObject<YansWifiPhy> ();
+      phy->ConfigureStandardAndBand (WIFI_PHY_STANDARD_80211a, WIFI_PHY_BAND_5GHZ);
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (position);
+      phy->SetMobility (mobility);
+      phy->SetDevice (device);
+      phy->SetChannel (m_channel);
+      device->SetPhy (phy);
+      node->AddDevice (device);
+      m_mobility.push_back (mobility);
+    }
+
+  NS_TEST_EXPECT_MSG_EQ (SendFromFirst (0), positions.size () - 1, "Without MaxRange every receiver must be considered");
+  NS_TEST_EXPECT_MSG_EQ (SendFromFirst (100), 5, "Only the receivers within 100 m must be considered");
+  NS_TEST_EXPECT_MSG_EQ (SendFromFirst (49), 0, "No receiver is within 49 m");
+
+  m_mobility[3]->SetPosition (Vector (0, 30, 0));
+  NS_TEST_EXPECT_MSG_EQ (SendFromFirst (49), 1, "A receiver that moved into range must be considered");
+  m_mobility[3]->SetPosition (Vector (0, 300, 0));
+  m_mobility[0]->SetPosition (Vector (150, 0, 0));
+  NS_TEST_EXPECT_MSG_EQ (SendFromFirst (49), 0, "The receiver that moved out of range must be skipped");
+  NS_TEST_EXPECT_MSG_EQ (SendFromFirst (50), 1, "The sender position must be current");
+
+  //Cells of the 10 m grid are 9 cells or more away from the sender at the origin, beyond
+  //the cells a 100 m lookup visits, so the grid must be rebuilt with the new cell size
+  m_mobility[0]->SetPosition (Vector (0, 0, 0));
+  m_mobility[3]->SetPosition (Vector (95, 0, 0));
+  NS_TEST_EXPECT_MSG_EQ (SendFromFirst (10), 0, "No receiver is within 10 m");
+  NS_TEST_EXPECT_MSG_EQ (SendFromFirst (100), 6, "The receivers within the new MaxRange must be considered");
+
+  Simulator::Destroy ();
+}
+
 /**
  * \ingroup wifi-test
  * \ingroup tests
@@ -3180,6 +3309,7 @@ WifiTestSuite::WifiTestSuite ()
   AddTestCase (new IdealRateManagerChannelWidthTest, TestCase::QUICK);
   AddTestCase (new IdealRateManagerMimoTest, TestCase::QUICK);
   AddTestCase (new HeRuMcsDataRateTestCase, TestCase::QUICK);
+  AddTestCase (new YansWifiChannelMaxRangeTest, TestCase::QUICK);
 }
 
 static WifiTestSuite g_wifiTestSuite; ///< the test suite
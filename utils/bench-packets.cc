@@ -21,17 +21,32 @@
 // This program can be used to benchmark packet serialization/deserialization
 // operations using Headers and Tags, for various numbers of packets 'n'
 // Sample usage:  ./waf --run 'bench-packets --n=10000'
+//
+// The packet metadata used for printing can be disabled, which is the
+// default, or enabled in its full or compact form; --metadata=all
+// runs the benchmarks once with each, in separate processes, to
+// compare their throughput and peak memory:
+//   ./waf --run 'bench-packets --n=100000 --metadata=all'
+// The compact form only differs from the full one when ns-3 is
+// configured with --enable-compact-packet-metadata.
 
 #include "ns3/command-line.h"
 #include "ns3/system-wall-clock-ms.h"
 #include "ns3/packet.h"
 #include "ns3/packet-metadata.h"
+#include "bench-utils.h"
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 #include <stdlib.h> // for exit ()
 #include <limits>
 #include <algorithm>
+#if defined (__unix__) || defined (__APPLE__)
+#define BENCH_PACKETS_FORK 1
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 using namespace ns3;
 
@@ -328,6 +343,26 @@ benchByteTags (uint32_t n)
     }
 }
 
+static void
+benchHeld (uint32_t n)
+{
+  BenchHeader<25> ipv4;
+  BenchHeader<8> udp;
+  BenchHeader<14> ethernet;
+
+  // Keep all packets alive, as queues and long-lived traces do
+  std::vector<Ptr<Packet> > packets;
+  packets.reserve (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (100);
+      p->AddHeader (udp);
+      p->AddHeader (ipv4);
+      p->AddHeader (ethernet);
+      packets.push_back (p);
+    }
+}
+
 static uint64_t
 runBenchOneIteration (void (*bench) (uint32_t), uint32_t n)
 {
@@ -343,31 +378,58 @@ static void
 runBench (void (*bench) (uint32_t), uint32_t n, uint32_t minIterations, char const *name)
 {
   uint64_t minDelay = std::numeric_limits<uint64_t>::max();
+  ResetPeakRss ();
   for (uint32_t i = 0; i < minIterations; i++)
     {
       uint64_t delay = runBenchOneIteration(bench, n);
       minDelay = std::min(minDelay, delay);
     }
+  uint64_t peakRss = GetPeakRss ();
   double ps = n;
   ps *= 1000;
   ps /= minDelay;
   std::cout << ps << " packets/s"
-            << " (" << minDelay << " ms elapsed)\t"
+            << " (" << minDelay << " ms elapsed, "
+            << peakRss << " kB peak RSS)\t"
             << name
             << std::endl;
 }
 
+static void
+runAllBenches (uint32_t n, uint32_t minIterations, std::string metadata)
+{
+  if (metadata == "full")
+    {
+      PacketMetadata::Enable ();
+    }
+  else if (metadata == "compact")
+    {
+      PacketMetadata::EnableCompact ();
+    }
+  std::cout << "Packet metadata: " << metadata << std::endl;
+
+  runBench (&benchA, n, minIterations, "Copy packet, remove headers");
+  runBench (&benchB, n, minIterations, "Just add headers");
+  runBench (&benchC, n, minIterations, "Remove by func call");
+  runBench (&benchD, n, minIterations, "Intermixed add/remove headers and tags");
+  runBench (&benchFragment, n, minIterations, "Fragmentation and concatenation");
+  runBench (&benchByteTags, n, minIterations, "Benchmark byte tags");
+  runBench (&benchHeld, n, minIterations, "Hold packets with three headers");
+}
+
 int main (int argc, char *argv[])
 {
   uint32_t n = 0;
   uint32_t minIterations = 1;
   bool enablePrinting = false;
+  std::string metadata = "none";
 
   CommandLine cmd (__FILE__);
   cmd.Usage ("Benchmark Packet class");
   cmd.AddValue ("n", "number of iterations", n);
   cmd.AddValue ("min-iterations", "number of subiterations to minimize iteration time over", minIterations);
-  cmd.AddValue ("enable-printing", "enable packet printing", enablePrinting);
+  cmd.AddValue ("enable-printing", "enable packet printing, same as --metadata=full", enablePrinting);
+  cmd.AddValue ("metadata", "packet metadata: none, full, compact, or all to compare them", metadata);
   cmd.Parse (argc, argv);
 
   if (n == 0)
@@ -377,14 +439,43 @@ int main (int argc, char *argv[])
       exit (1);
     }
   std::cout << "Running bench-packets with n=" << n << std::endl;
+  if (enablePrinting && metadata == "none")
+    {
+      metadata = "full";
+    }
+  if (metadata != "none" && metadata != "full" && metadata != "compact" && metadata != "all")
+    {
+      std::cerr << "Error-- unknown packet metadata " << metadata << std::endl;
+      exit (1);
+    }
   std::cout << "All tests begin by adding UDP and IPv4 headers." << std::endl;
 
-  runBench (&benchA, n, minIterations, "Copy packet, remove headers");
-  runBench (&benchB, n, minIterations, "Just add headers");
-  runBench (&benchC, n, minIterations, "Remove by func call");
-  runBench (&benchD, n, minIterations, "Intermixed add/remove headers and tags");
-  runBench (&benchFragment, n, minIterations, "Fragmentation and concatenation");
-  runBench (&benchByteTags, n, minIterations, "Benchmark byte tags");
+  if (metadata != "all")
+    {
+      runAllBenches (n, minIterations, metadata);
+      return 0;
+    }
+#ifdef BENCH_PACKETS_FORK
+  // The metadata can not be disabled once enabled, so each one runs in
+  // its own process
+  char const *modes[] = { "none", "full", "compact" };
+  for (char const *mode : modes)
+    {
+      std::cout << std::flush;
+      pid_t pid = fork ();
+      if (pid == 0)
+        {
+          runAllBenches (n, minIterations, mode);
+          std::cout << std::flush;
+          _exit (0);
+        }
+      int status;
+      waitpid (pid, &status, 0);
+    }
+#else
+  std::cerr << "Error-- --metadata=all is not supported on this platform" << std::endl;
+  exit (1);
+#endif
 
   return 0;
 }
@@ -18,28 +18,63 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <string.h>
 
 #include "ns3/core-module.h"
 
+#include "bench-utils.h"
+
 using namespace ns3;
 
 
 bool g_debug = false;
+bool g_verbose = true;
 
 std::string g_me;
 #define LOG(x)   std::cout << x << std::endl
     #define LOGME(x) LOG (g_me << x)
     #define DEB(x) if (g_debug) { LOGME (x); }
+    #define INFO(x) if (g_verbose) { LOGME (x); }
 
 // Output field width
 int g_fwidth = 6;
 
-/// Bench class
+/// The results of a benchmark run
+struct BenchResult
+{
+  double init;         ///< initialization time, in s
+  double simu;         ///< simulation time, in s
+  uint64_t scheduled;  ///< number of events scheduled by the initialization
+  uint64_t events;     ///< number of events run
+  uint64_t cancels;    ///< number of events removed before they ran
+  double cancelTime;   ///< total time spent removing events, in s
+  uint64_t peakRss;    ///< peak resident set size, in kB
+};
+
+/**
+ * Bench class
+ *
+ * The workloads are:
+ *   - reschedule: every event reschedules itself after a delay taken
+ *     from the random stream, which keeps the population constant;
+ *   - wifi: stations contend in 9 us slots, every event rescheduling
+ *     itself after a random backoff of 1 to 16 slots, so that large
+ *     bursts of events share a time stamp;
+ *   - rto: flows send segments, each send replacing the retransmission
+ *     timeout of the flow, 200 ms later, so that nearly every timer is
+ *     removed before it expires;
+ *   - contexts: nodes schedule events in random other nodes with
+ *     ScheduleWithContext after a propagation delay;
+ *   - pending: a few events reschedule themselves with the delays of
+ *     the random stream while the population waits far in the future,
+ *     so that the queue is large but the accessed part small.
+ */
 class Bench
 {
 public:
@@ -51,8 +86,10 @@ public:
   Bench (const uint32_t population, const uint32_t total)
     : m_population (population),
       m_total (total),
-      m_count (0)
+      m_count (0),
+      m_workload ("reschedule")
   {
+    m_uniform = CreateObject<UniformRandomVariable> ();
   }
 
   /**
@@ -82,52 +119,148 @@ public:
     m_total = total;
   }
 
-  /// Run function
-  void RunBench (void);
+  /**
+   * Set workload function
+   * \param workload the workload
+   */
+  void SetWorkload (const std::string workload)
+  {
+    m_workload = workload;
+  }
+
+  /**
+   * Run function
+   * \returns the results of the run
+   */
+  BenchResult RunBench (void);
 private:
   /// callback function
   void Cb (void);
+  /**
+   * wifi slot callback function
+   */
+  void SlotCb (void);
+  /**
+   * rto segment callback function
+   * \param flow the flow
+   */
+  void SendCb (uint32_t flow);
+  /**
+   * rto timeout callback function
+   * \param flow the flow
+   */
+  void RtoCb (uint32_t flow);
+  /**
+   * contexts callback function
+   */
+  void ContextCb (void);
+  /**
+   * Remove an event, timing the removal
+   * \param id the event
+   */
+  void Remove (const EventId &id);
 
   Ptr<RandomVariableStream> m_rand; ///< random variable
+  Ptr<UniformRandomVariable> m_uniform; ///< uniform random variable
   uint32_t m_population; ///< population
   uint32_t m_total; ///< total
   uint32_t m_count; ///< count
+  std::string m_workload; ///< workload
+  std::vector<EventId> m_timers; ///< rto timer of each flow
+  uint64_t m_cancels; ///< number of removed events
+  std::chrono::steady_clock::duration m_cancelTime; ///< time spent removing events
 };
 
-void
+/// Duration of a wifi slot
+static const Time SLOT = MicroSeconds (9);
+/// Retransmission timeout of the rto workload
+static const Time RTO = MilliSeconds (200);
+/// Number of contexts of the contexts workload
+static const uint32_t CONTEXTS = 1000;
+/// Number of active events of the pending workload
+static const uint32_t ACTIVE = 100;
+
+BenchResult
 Bench::RunBench (void)
 {
-  SystemWallClockMs time;
-  double init, simu;
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start;
+  BenchResult result;
 
   DEB ("initializing");
   m_count = 0;
+  m_cancels = 0;
+  m_cancelTime = std::chrono::steady_clock::duration::zero ();
+  ResetPeakRss ();
 
-
-  time.Start ();
-  for (uint32_t i = 0; i < m_population; ++i)
+  start = Clock::now ();
+  if (m_workload == "reschedule")
+    {
+      for (uint32_t i = 0; i < m_population; ++i)
+        {
+          Time at = NanoSeconds (m_rand->GetValue ());
+          Simulator::Schedule (at, &Bench::Cb, this);
+        }
+    }
+  else if (m_workload == "wifi")
+    {
+      for (uint32_t i = 0; i < m_population; ++i)
+        {
+          Simulator::Schedule (SLOT * m_uniform->GetInteger (1, 16), &Bench::SlotCb, this);
+        }
+    }
+  else if (m_workload == "rto")
     {
-      Time at = NanoSeconds (m_rand->GetValue ());
-      Simulator::Schedule (at, &Bench::Cb, this);
+      m_timers.resize (m_population);
+      for (uint32_t i = 0; i < m_population; ++i)
+        {
+          m_timers[i] = Simulator::Schedule (RTO, &Bench::RtoCb, this, i);
+          Simulator::Schedule (NanoSeconds (m_rand->GetValue () * m_population), &Bench::SendCb, this, i);
+        }
     }
-  init = time.End ();
-  init /= 1000;
-  DEB ("initialization took " << init << "s");
+  else if (m_workload == "contexts")
+    {
+      for (uint32_t i = 0; i < m_population; ++i)
+        {
+          Simulator::ScheduleWithContext (m_uniform->GetInteger (0, CONTEXTS - 1),
+                                          NanoSeconds (m_rand->GetValue ()), &Bench::ContextCb, this);
+        }
+    }
+  else if (m_workload == "pending")
+    {
+      // Far enough not to run before the end of the benchmark
+      for (uint32_t i = 0; i < m_population; ++i)
+        {
+          Simulator::Schedule (Seconds (1000 + m_uniform->GetValue (0, 1000)), &Bench::Cb, this);
+        }
+      for (uint32_t i = 0; i < ACTIVE; ++i)
+        {
+          Simulator::Schedule (NanoSeconds (m_rand->GetValue ()), &Bench::Cb, this);
+        }
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown workload " << m_workload);
+    }
+  result.init = std::chrono::duration<double> (Clock::now () - start).count ();
+  DEB ("initialization took " << result.init << "s");
 
   DEB ("running");
-  time.Start ();
+  uint64_t events = Simulator::GetEventCount ();
+  start = Clock::now ();
   Simulator::Run ();
-  simu = time.End ();
-  simu /= 1000;
-  DEB ("run took " << simu << "s");
-
-  LOG (std::setw (g_fwidth) << init <<
-       std::setw (g_fwidth) << (m_population / init) <<
-       std::setw (g_fwidth) << (init / m_population) <<
-       std::setw (g_fwidth) << simu <<
-       std::setw (g_fwidth) << (m_count / simu) <<
-       std::setw (g_fwidth) << (simu / m_count));
-
+  result.simu = std::chrono::duration<double> (Clock::now () - start).count ();
+  DEB ("run took " << result.simu << "s");
+
+  result.scheduled = m_workload == "pending" ? m_population + ACTIVE
+    : m_workload == "rto" ? 2 * m_population : m_population;
+  result.events = Simulator::GetEventCount () - events;
+  result.cancels = m_cancels;
+  result.cancelTime = std::chrono::duration<double> (m_cancelTime).count ();
+  result.peakRss = GetPeakRss ();
+  // Start the next run from an empty simulator
+  Simulator::Destroy ();
+  return result;
 }
 
 void
@@ -135,6 +268,11 @@ Bench::Cb (void)
 {
   if (m_count >= m_total)
     {
+      // The pending events never run
+      if (m_workload == "pending")
+        {
+          Simulator::Stop ();
+        }
       return;
     }
   DEB ("event at " << Simulator::Now ().GetSeconds () << "s");
@@ -144,6 +282,63 @@ Bench::Cb (void)
   ++m_count;
 }
 
+void
+Bench::SlotCb (void)
+{
+  if (m_count >= m_total)
+    {
+      return;
+    }
+  Simulator::Schedule (SLOT * m_uniform->GetInteger (1, 16), &Bench::SlotCb, this);
+  ++m_count;
+}
+
+void
+Bench::SendCb (uint32_t flow)
+{
+  if (m_count >= m_total)
+    {
+      return;
+    }
+  Remove (m_timers[flow]);
+  m_timers[flow] = Simulator::Schedule (RTO, &Bench::RtoCb, this, flow);
+  Simulator::Schedule (NanoSeconds (m_rand->GetValue () * m_population), &Bench::SendCb, this, flow);
+  ++m_count;
+}
+
+void
+Bench::RtoCb (uint32_t flow)
+{
+  if (m_count >= m_total)
+    {
+      return;
+    }
+  m_timers[flow] = Simulator::Schedule (RTO, &Bench::RtoCb, this, flow);
+  ++m_count;
+}
+
+void
+Bench::ContextCb (void)
+{
+  if (m_count >= m_total)
+    {
+      return;
+    }
+  Simulator::ScheduleWithContext (m_uniform->GetInteger (0, CONTEXTS - 1),
+                                  MicroSeconds (1) + NanoSeconds (m_rand->GetValue ()),
+                                  &Bench::ContextCb, this);
+  ++m_count;
+}
+
+void
+Bench::Remove (const EventId &id)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Simulator::Remove (id);
+  m_cancelTime += std::chrono::steady_clock::now () - start;
+  ++m_cancels;
+}
+
 
 Ptr<RandomVariableStream>
 GetRandomStream (std::string filename)
@@ -152,7 +347,7 @@ GetRandomStream (std::string filename)
 
   if (filename == "")
     {
-      LOGME ("using default exponential distribution");
+      INFO ("using default exponential distribution");
       Ptr<ExponentialRandomVariable> erv = CreateObject<ExponentialRandomVariable> ();
       erv->SetAttribute ("Mean", DoubleValue (100));
       stream = erv;
@@ -163,12 +358,12 @@ GetRandomStream (std::string filename)
 
       if (filename == "-")
         {
-          LOGME ("using event distribution from stdin");
+          INFO ("using event distribution from stdin");
           input = &std::cin;
         }
       else
         {
-          LOGME ("using event distribution from " << filename);
+          INFO ("using event distribution from " << filename);
           input = new std::ifstream (filename.c_str ());
         }
 
@@ -189,7 +384,7 @@ GetRandomStream (std::string filename)
               *input >> line;
             }
         }
-      LOGME ("found " << nsValues.size () << " entries");
+      INFO ("found " << nsValues.size () << " entries");
       Ptr<DeterministicRandomVariable> drv = CreateObject<DeterministicRandomVariable> ();
       drv->SetValueArray (&nsValues[0], nsValues.size ());
       stream = drv;
@@ -200,6 +395,133 @@ GetRandomStream (std::string filename)
 
 
 
+/**
+ * Print the header of the results.
+ * \param format the output format
+ * \param pop the population
+ * \param total the total
+ */
+void
+PrintHeader (const std::string &format, uint32_t pop, uint32_t total)
+{
+  if (format == "csv")
+    {
+      LOG ("scheduler,workload,run,population,total,init_s,scheduled,run_s,events,"
+           "events_per_s,cancels,cancel_ns,peak_rss_kb");
+    }
+  else if (format == "json")
+    {
+      std::cout << "{" << std::endl <<
+        " \"population\" : " << pop << "," << std::endl <<
+        " \"total\" : " << total << "," << std::endl <<
+        " \"results\" : [";
+    }
+}
+
+/**
+ * Print the header of the table of the runs of a scheduler and workload.
+ * \param scheduler the scheduler
+ * \param workload the workload
+ */
+void
+PrintTableHeader (const std::string &scheduler, const std::string &workload)
+{
+  LOGME ("scheduler: " << scheduler);
+  LOGME ("workload: " << workload);
+  LOG ("");
+  LOG (std::left << std::setw (g_fwidth) << "Run #" <<
+       std::left << std::setw (3 * g_fwidth) << "Initialization:" <<
+       std::left << std::setw (3 * g_fwidth) << "Simulation:");
+  LOG (std::left << std::setw (g_fwidth) << "" <<
+       std::left << std::setw (g_fwidth) << "Time (s)" <<
+       std::left << std::setw (g_fwidth) << "Rate (ev/s)" <<
+       std::left << std::setw (g_fwidth) << "Per (s/ev)" <<
+       std::left << std::setw (g_fwidth) << "Time (s)" <<
+       std::left << std::setw (g_fwidth) << "Rate (ev/s)" <<
+       std::left << std::setw (g_fwidth) << "Per (s/ev)" );
+  LOG (std::setfill ('-') <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::setfill (' ')
+       );
+}
+
+/**
+ * Print the results of a run.
+ * \param format the output format
+ * \param scheduler the scheduler
+ * \param workload the workload
+ * \param run the run number, -1 for the priming run
+ * \param pop the population
+ * \param total the total
+ * \param result the results
+ */
+void
+PrintResult (const std::string &format, const std::string &scheduler,
+             const std::string &workload, int run, uint32_t pop, uint32_t total,
+             const BenchResult &result)
+{
+  static bool first = true;
+  double rate = result.simu > 0 ? result.events / result.simu : 0;
+  double cancel = result.cancels > 0 ? 1e9 * result.cancelTime / result.cancels : 0;
+  if (format == "table")
+    {
+      if (run < 0)
+        {
+          std::cout << std::left << std::setw (g_fwidth) << "(prime)";
+        }
+      else
+        {
+          std::cout << std::setw (g_fwidth) << run;
+        }
+      LOG (std::setw (g_fwidth) << result.init <<
+           std::setw (g_fwidth) << (result.scheduled / result.init) <<
+           std::setw (g_fwidth) << (result.init / result.scheduled) <<
+           std::setw (g_fwidth) << result.simu <<
+           std::setw (g_fwidth) << rate <<
+           std::setw (g_fwidth) << (result.simu / result.events));
+      if (result.cancels > 0)
+        {
+          LOG (std::setw (g_fwidth) << "" << "removed " << result.cancels <<
+               " events, " << cancel << " ns per event");
+        }
+      return;
+    }
+  // The priming run is only part of the table
+  if (run < 0)
+    {
+      return;
+    }
+  if (format == "csv")
+    {
+      LOG (scheduler << "," << workload << "," << run << "," << pop << "," << total << "," <<
+           result.init << "," << result.scheduled << "," << result.simu << "," <<
+           result.events << "," << rate << "," << result.cancels << "," << cancel << "," <<
+           result.peakRss);
+    }
+  else
+    {
+      std::cout << (first ? "" : ",") << std::endl <<
+           "  {\"scheduler\" : \"" << scheduler << "\"" <<
+           ", \"workload\" : \"" << workload << "\"" <<
+           ", \"run\" : " << run <<
+           ", \"init_s\" : " << result.init <<
+           ", \"scheduled\" : " << result.scheduled <<
+           ", \"run_s\" : " << result.simu <<
+           ", \"events\" : " << result.events <<
+           ", \"events_per_s\" : " << rate <<
+           ", \"cancels\" : " << result.cancels <<
+           ", \"cancel_ns\" : " << cancel <<
+           ", \"peak_rss_kb\" : " << result.peakRss << "}" << std::flush;
+      first = false;
+    }
+}
+
 int main (int argc, char *argv[])
 {
 
@@ -208,11 +530,15 @@ int main (int argc, char *argv[])
   bool schedList          = false;
   bool schedMap           = true;
   bool schedPriorityQueue = false;
+  bool schedLadder = false;
+  bool schedAll = false;
 
   uint32_t pop   =  100000;
   uint32_t total = 1000000;
   uint32_t runs  =       1;
   std::string filename = "";
+  std::string workload = "reschedule";
+  std::string format = "table";
   bool calRev = false;
 
   CommandLine cmd (__FILE__);
@@ -223,10 +549,25 @@ int main (int argc, char *argv[])
              "  an ascii file, given by the --file=\"<filename>\" argument,\n"
              "  or standard input, by the argument --file=\"-\"\n"
              "In the case of either --file form, the input is expected\n"
-             "to be ascii, giving the relative event times in ns.");
+             "to be ascii, giving the relative event times in ns.\n"
+             "\n"
+             "The workloads, selected by --workload, are:\n"
+             "  reschedule: each of pop events reschedules itself (default),\n"
+             "  wifi: pop stations reschedule after a backoff of 1 to 16 9 us slots,\n"
+             "  rto: pop flows send segments, each replacing the 200 ms timeout of its flow,\n"
+             "  contexts: pop events hop between 1000 contexts with ScheduleWithContext,\n"
+             "  pending: 100 events reschedule themselves in front of pop pending events,\n"
+             "  or all of them, with --workload=all.\n"
+             "\n"
+             "With --format=csv or --format=json, the results are written for\n"
+             "regression tests: the events per second of the run, the time\n"
+             "spent per removed event, including two clock reads, and the\n"
+             "peak resident set size of the run.");
+  cmd.AddValue ("all",   "use every scheduler in turn",   schedAll);
   cmd.AddValue ("cal",   "use CalendarSheduler",          schedCal);
   cmd.AddValue ("calrev", "reverse ordering in the CalendarScheduler", calRev);
   cmd.AddValue ("heap",  "use HeapScheduler",             schedHeap);
+  cmd.AddValue ("ladder", "use LadderScheduler",          schedLadder);
   cmd.AddValue ("list",  "use ListSheduler",              schedList);
   cmd.AddValue ("map",   "use MapScheduler (default)",    schedMap);
   cmd.AddValue ("pri",   "use PriorityQueue",             schedPriorityQueue);
@@ -236,10 +577,18 @@ int main (int argc, char *argv[])
   cmd.AddValue ("runs",  "number of runs (default 1)",    runs);
   cmd.AddValue ("file",  "file of relative event times",  filename);
   cmd.AddValue ("prec",  "printed output precision",      g_fwidth);
+  cmd.AddValue ("workload", "workload: reschedule, wifi, rto, contexts, pending or all", workload);
+  cmd.AddValue ("format", "output format: table, csv or json", format);
   cmd.Parse (argc, argv);
   g_me = cmd.GetName () + ": ";
   g_fwidth += 6;  // 5 extra chars in '2.000002e+07 ': . e+0 _
 
+  if (format != "table" && format != "csv" && format != "json")
+    {
+      NS_FATAL_ERROR ("Unknown format " << format);
+    }
+  g_verbose = format == "table";
+
   ObjectFactory factory ("ns3::MapScheduler");
   if (schedCal)
     {
@@ -258,64 +607,99 @@ int main (int argc, char *argv[])
     {
       factory.SetTypeId ("ns3::PriorityQueueScheduler");
     }
-      
-  Simulator::SetScheduler (factory);
+  if (schedLadder)
+    {
+      factory.SetTypeId ("ns3::LadderScheduler");
+    }
+
+  std::vector<ObjectFactory> factories;
+  if (schedAll)
+    {
+      const char *schedulers[] = {"ns3::ListScheduler", "ns3::MapScheduler", "ns3::HeapScheduler",
+                                  "ns3::CalendarScheduler", "ns3::PriorityQueueScheduler",
+                                  "ns3::LadderScheduler"};
+      for (const char *scheduler : schedulers)
+        {
+          factories.push_back (ObjectFactory (scheduler));
+        }
+    }
+  else
+    {
+      factories.push_back (factory);
+    }
 
-  LOGME (std::setprecision (g_fwidth - 6));
-  DEB ("debugging is ON");
+  std::vector<std::string> workloads;
+  if (workload == "all")
+    {
+      workloads = {"reschedule", "wifi", "rto", "contexts", "pending"};
+    }
+  else
+    {
+      workloads.push_back (workload);
+    }
 
-  std::string order;
-  if (schedCal)
+  if (format == "table")
     {
-      order = ": insertion order: " + std::string (calRev ? "reverse" : "normal");
+      LOGME (std::setprecision (g_fwidth - 6));
+      DEB ("debugging is ON");
+
+      std::string order;
+      if (schedCal)
+        {
+          order = ": insertion order: " + std::string (calRev ? "reverse" : "normal");
+        }
+      if (!schedAll)
+        {
+          LOGME ("scheduler: " << factory.GetTypeId ().GetName () << order);
+        }
+      LOGME ("population: " << pop);
+      LOGME ("total events: " << total);
+      LOGME ("runs: " << runs);
+    }
+  else
+    {
+      std::cout << std::setprecision (9);
     }
-  LOGME ("scheduler: " << factory.GetTypeId ().GetName () << order);
-  LOGME ("population: " << pop);
-  LOGME ("total events: " << total);
-  LOGME ("runs: " << runs);
 
   Bench *bench = new Bench (pop, total);
   bench->SetRandomStream (GetRandomStream (filename));
 
-  // table header
-  LOG ("");
-  LOG (std::left << std::setw (g_fwidth) << "Run #" <<
-       std::left << std::setw (3 * g_fwidth) << "Initialization:" <<
-       std::left << std::setw (3 * g_fwidth) << "Simulation:");
-  LOG (std::left << std::setw (g_fwidth) << "" <<
-       std::left << std::setw (g_fwidth) << "Time (s)" <<
-       std::left << std::setw (g_fwidth) << "Rate (ev/s)" <<
-       std::left << std::setw (g_fwidth) << "Per (s/ev)" <<
-       std::left << std::setw (g_fwidth) << "Time (s)" <<
-       std::left << std::setw (g_fwidth) << "Rate (ev/s)" <<
-       std::left << std::setw (g_fwidth) << "Per (s/ev)" );
-  LOG (std::setfill ('-') <<
-       std::right << std::setw (g_fwidth) << " " <<
-       std::right << std::setw (g_fwidth) << " " <<
-       std::right << std::setw (g_fwidth) << " " <<
-       std::right << std::setw (g_fwidth) << " " <<
-       std::right << std::setw (g_fwidth) << " " <<
-       std::right << std::setw (g_fwidth) << " " <<
-       std::right << std::setw (g_fwidth) << " " <<
-       std::setfill (' ')
-       );
+  PrintHeader (format, pop, total);
+  for (const ObjectFactory &schedulerFactory : factories)
+    {
+      std::string scheduler = schedulerFactory.GetTypeId ().GetName ();
+      for (const std::string &name : workloads)
+        {
+          bench->SetWorkload (name);
+          if (format == "table")
+            {
+              LOG ("");
+              PrintTableHeader (scheduler, name);
+            }
 
-  // prime
-  DEB ("priming");
-  std::cout << std::left << std::setw (g_fwidth) << "(prime)";
-  bench->RunBench ();
+          // prime
+          DEB ("priming");
+          Simulator::SetScheduler (schedulerFactory);
+          BenchResult result = bench->RunBench ();
+          PrintResult (format, scheduler, name, -1, pop, total, result);
 
-  bench->SetPopulation (pop);
-  bench->SetTotal (total);
-  for (uint32_t i = 0; i < runs; i++)
+          for (uint32_t i = 0; i < runs; i++)
+            {
+              Simulator::SetScheduler (schedulerFactory);
+              result = bench->RunBench ();
+              PrintResult (format, scheduler, name, i, pop, total, result);
+            }
+        }
+    }
+  if (format == "json")
     {
-      std::cout << std::setw (g_fwidth) << i;
-
-      bench->RunBench ();
+      LOG (std::endl << " ]" << std::endl << "}");
+    }
+  else
+    {
+      LOG ("");
     }
 
-  LOG ("");
-  Simulator::Destroy ();
   delete bench;
   return 0;
 }
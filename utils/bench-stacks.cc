@@ -0,0 +1,652 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program benchmarks the packet throughput of full protocol stacks:
+// a UDP socket sends packets at a fixed rate to a UDP socket of another
+// node, over IPv4 over a SimpleNetDevice, a CSMA link or an ad-hoc Yans
+// wifi link.  The results are written as JSON, one value per line, to
+// be compared between versions with diff:
+//   ./waf --run 'bench-stacks --packets=100000' > stacks.json
+//
+// For each stack, it reports the wall clock time and the number of
+// events, of allocations and of allocated bytes per packet, the peak
+// resident set size, and the time per packet spent in each layer,
+// measured between trace sources of consecutive layers within the
+// same event:
+//   udp-tx      UdpSocketImpl and UdpL4Protocol, up to the IPv4
+//               SendOutgoing trace (to the Tx trace if SendOutgoing
+//               does not fire),
+//   ipv4-tx     Ipv4L3Protocol, from SendOutgoing to the Tx trace,
+//   device-tx   traffic control, ARP and the device, from the IPv4 Tx
+//               trace to the return of Socket::Send,
+//   wifi-mac-rx the wifi MAC, from the WifiPhy PhyRxEnd trace to the
+//               WifiMac MacRx trace,
+//   device-rx   the device, the node and traffic control, from the
+//               device receive trace to the IPv4 Rx trace (not
+//               reported for the SimpleNetDevice, without such trace),
+//   ipv4-rx     Ipv4L3Protocol::Receive, from the Rx trace to the
+//               LocalDeliver trace,
+//   udp-rx      UdpL4Protocol and UdpSocketImpl, from LocalDeliver to
+//               the socket receive callback,
+//   app-rx      Socket::Recv in the receive callback.
+// The work done in other events, such as the channel, the wifi PHY
+// and the wifi channel access, is profiled in a second run with the
+// EventProfiler, and reported as the time per packet of the events of
+// each class.
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/mobility-module.h"
+
+#include "bench-utils.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+/// Number of allocations made with the global operator new
+static uint64_t g_allocations = 0;
+/// Number of bytes allocated with the global operator new
+static uint64_t g_allocatedBytes = 0;
+
+// Counting allocator: replacing the global allocation functions in the
+// program also replaces them in the ns-3 libraries it is linked with.
+
+void *
+operator new (std::size_t size)
+{
+  g_allocations++;
+  g_allocatedBytes += size;
+  void *p = std::malloc (size == 0 ? 1 : size);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void *
+operator new[] (std::size_t size)
+{
+  return operator new (size);
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete[] (void *p) noexcept
+{
+  std::free (p);
+}
+
+/// The layers timed by the probes, in the order packets cross them
+enum Layer
+{
+  UDP_TX,       ///< UDP socket and protocol, sending
+  IPV4_TX,      ///< IPv4, sending
+  DEVICE_TX,    ///< traffic control, ARP and device, sending
+  WIFI_MAC_RX,  ///< wifi MAC, receiving
+  DEVICE_RX,    ///< device, node and traffic control, receiving
+  IPV4_RX,      ///< IPv4, receiving
+  UDP_RX,       ///< UDP protocol and socket, receiving
+  APP_RX,       ///< reading from the socket
+  LAYERS        ///< number of layers
+};
+
+/// The names of the layers
+static char const *g_layerNames[LAYERS] = {
+  "udp-tx", "ipv4-tx", "device-tx", "wifi-mac-rx", "device-rx", "ipv4-rx", "udp-rx", "app-rx"
+};
+
+/// The results of a benchmark run
+struct StackResult
+{
+  uint32_t sent;              ///< number of packets sent after the warm-up
+  uint32_t received;          ///< number of those packets received
+  double run;                 ///< wall clock time after the warm-up, in s
+  uint64_t events;            ///< number of events run after the warm-up
+  uint64_t allocations;       ///< number of allocations after the warm-up
+  uint64_t allocatedBytes;    ///< number of bytes allocated after the warm-up
+  uint64_t peakRss;           ///< peak resident set size, in kB
+  double layerNs[LAYERS];     ///< time spent in each layer, in ns
+  uint64_t crossings[LAYERS]; ///< number of packets timed in each layer
+  std::map<std::string, double> eventNs; ///< time of the events of each class, in ns per packet
+};
+
+/**
+ * Bench class
+ *
+ * Sends packets from a UDP socket of node 0 to a UDP socket of node 1
+ * over a stack, and times the layers they cross.
+ */
+class StackBench
+{
+public:
+  /**
+   * Constructor
+   * \param packets the number of packets to send after the warm-up
+   * \param warmup the number of packets to send before timing
+   * \param rate the number of packets per second
+   * \param size the size of the packets
+   */
+  StackBench (uint32_t packets, uint32_t warmup, double rate, uint32_t size)
+    : m_packets (packets),
+      m_warmup (warmup),
+      m_rate (rate),
+      m_size (size)
+  {}
+
+  /**
+   * Run a stack.
+   * \param stack the stack: simple, csma or wifi
+   * \param profile the file to write the event profile to, or empty
+   * \returns the results of the run
+   */
+  StackResult Run (const std::string &stack, const std::string &profile);
+
+private:
+  /**
+   * Install the devices of a stack.
+   * \param stack the stack
+   * \param nodes the nodes
+   * \returns the devices
+   */
+  NetDeviceContainer InstallDevices (const std::string &stack, NodeContainer nodes);
+  /**
+   * Connect the probes of the layers to the trace sources of a stack.
+   * \param stack the stack
+   * \param nodes the nodes
+   * \param devices the devices
+   */
+  void ConnectProbes (const std::string &stack, NodeContainer nodes, NetDeviceContainer devices);
+  /**
+   * Record a crossing between two layers.
+   * \param layer the layer ending at the crossing, or LAYERS if the
+   *        crossing only starts the next layer
+   */
+  void Probe (Layer layer);
+  /// Start timing
+  void StartTiming (void);
+  /**
+   * Send a packet and schedule the next one.
+   * \param index the index of the packet
+   */
+  void Send (uint32_t index);
+  /**
+   * Receive the packets of a socket.
+   * \param socket the socket
+   */
+  void Receive (Ptr<Socket> socket);
+
+  /**
+   * Probe a trace source with a packet argument.
+   * \param layer the layer ending at the trace source
+   * \param packet the packet
+   */
+  void PacketProbe (Layer layer, Ptr<const Packet> packet);
+  /**
+   * Probe an IPv4 trace source with an interface argument.
+   * \param layer the layer ending at the trace source
+   * \param packet the packet
+   * \param ipv4 the IPv4 protocol
+   * \param interface the interface
+   */
+  void Ipv4Probe (Layer layer, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+  /**
+   * Probe an IPv4 trace source with a header argument.
+   * \param layer the layer ending at the trace source
+   * \param header the IPv4 header
+   * \param packet the packet
+   * \param interface the interface
+   */
+  void Ipv4HeaderProbe (Layer layer, const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+
+  uint32_t m_packets;  ///< number of packets sent after the warm-up
+  uint32_t m_warmup;   ///< number of packets sent before timing
+  double m_rate;       ///< packets per second
+  uint32_t m_size;     ///< packet size
+  Ptr<Socket> m_source; ///< the socket sending the packets
+  bool m_timing;       ///< whether the layers are timed
+  std::chrono::steady_clock::time_point m_last; ///< time of the last crossing
+  uint64_t m_lastEvent; ///< event of the last crossing
+  bool m_lastValid;    ///< whether a crossing was recorded
+  std::chrono::steady_clock::time_point m_start; ///< start of the timing
+  uint64_t m_startEvents; ///< event count at the start of the timing
+  uint64_t m_startAllocations; ///< allocation count at the start of the timing
+  uint64_t m_startAllocatedBytes; ///< allocated bytes at the start of the timing
+  StackResult m_result; ///< the results of the run
+};
+
+/// Port of the receiving socket
+static const uint16_t PORT = 9;
+
+NetDeviceContainer
+StackBench::InstallDevices (const std::string &stack, NodeContainer nodes)
+{
+  if (stack == "simple")
+    {
+      SimpleNetDeviceHelper simple;
+      return simple.Install (nodes);
+    }
+  else if (stack == "csma")
+    {
+      CsmaHelper csma;
+      csma.SetChannelAttribute ("DataRate", StringValue ("1Gbps"));
+      csma.SetChannelAttribute ("Delay", TimeValue (NanoSeconds (6560)));
+      return csma.Install (nodes);
+    }
+  else if (stack == "wifi")
+    {
+      MobilityHelper mobility;
+      Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator> ();
+      positions->Add (Vector (0, 0, 0));
+      positions->Add (Vector (5, 0, 0));
+      mobility.SetPositionAllocator (positions);
+      mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+      mobility.Install (nodes);
+
+      YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+      YansWifiPhyHelper phy;
+      phy.SetChannel (channel.Create ());
+      WifiMacHelper mac;
+      mac.SetType ("ns3::AdhocWifiMac");
+      WifiHelper wifi;
+      wifi.SetStandard (WIFI_STANDARD_80211a);
+      wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                    "DataMode", StringValue ("OfdmRate54Mbps"),
+                                    "ControlMode", StringValue ("OfdmRate24Mbps"));
+      return wifi.Install (phy, mac, nodes);
+    }
+  NS_FATAL_ERROR ("Unknown stack " << stack);
+  return NetDeviceContainer ();
+}
+
+void
+StackBench::ConnectProbes (const std::string &stack, NodeContainer nodes, NetDeviceContainer devices)
+{
+  Ptr<Ipv4L3Protocol> tx = nodes.Get (0)->GetObject<Ipv4L3Protocol> ();
+  tx->TraceConnectWithoutContext ("SendOutgoing", MakeCallback (&StackBench::Ipv4HeaderProbe, this).Bind (UDP_TX));
+  tx->TraceConnectWithoutContext ("Tx", MakeCallback (&StackBench::Ipv4Probe, this).Bind (IPV4_TX));
+
+  Ptr<NetDevice> device = devices.Get (1);
+  if (stack == "csma")
+    {
+      device->TraceConnectWithoutContext ("PhyRxEnd", MakeCallback (&StackBench::PacketProbe, this).Bind (LAYERS));
+    }
+  else if (stack == "wifi")
+    {
+      Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice> (device);
+      wifi->GetPhy ()->TraceConnectWithoutContext ("PhyRxEnd", MakeCallback (&StackBench::PacketProbe, this).Bind (LAYERS));
+      wifi->GetMac ()->TraceConnectWithoutContext ("MacRx", MakeCallback (&StackBench::PacketProbe, this).Bind (WIFI_MAC_RX));
+    }
+  // The SimpleNetDevice has no receive trace: its receive time is part of
+  // the time of the event
+  Ptr<Ipv4L3Protocol> rx = nodes.Get (1)->GetObject<Ipv4L3Protocol> ();
+  rx->TraceConnectWithoutContext ("Rx", MakeCallback (&StackBench::Ipv4Probe, this).Bind (DEVICE_RX));
+  rx->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&StackBench::Ipv4HeaderProbe, this).Bind (IPV4_RX));
+}
+
+void
+StackBench::Probe (Layer layer)
+{
+  if (!m_timing)
+    {
+      return;
+    }
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now ();
+  uint64_t event = Simulator::GetEventCount ();
+  // Only crossings within the same event measure the time of a layer
+  if (layer != LAYERS && m_lastValid && m_lastEvent == event)
+    {
+      m_result.layerNs[layer] += std::chrono::duration<double, std::nano> (now - m_last).count ();
+      m_result.crossings[layer]++;
+    }
+  m_last = now;
+  m_lastEvent = event;
+  m_lastValid = true;
+}
+
+void
+StackBench::PacketProbe (Layer layer, Ptr<const Packet> packet)
+{
+  Probe (layer);
+}
+
+void
+StackBench::Ipv4Probe (Layer layer, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  Probe (layer);
+}
+
+void
+StackBench::Ipv4HeaderProbe (Layer layer, const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  Probe (layer);
+}
+
+void
+StackBench::StartTiming (void)
+{
+  m_timing = true;
+  m_lastValid = false;
+  m_result.received = 0;
+  m_start = std::chrono::steady_clock::now ();
+  m_startEvents = Simulator::GetEventCount ();
+  m_startAllocations = g_allocations;
+  m_startAllocatedBytes = g_allocatedBytes;
+}
+
+void
+StackBench::Send (uint32_t index)
+{
+  if (index == m_warmup)
+    {
+      StartTiming ();
+    }
+  Ptr<Packet> packet = Create<Packet> (m_size);
+  Probe (LAYERS);
+  m_source->Send (packet);
+  Probe (DEVICE_TX);
+  if (m_timing)
+    {
+      m_result.sent++;
+    }
+  if (index + 1 < m_warmup + m_packets)
+    {
+      Simulator::Schedule (Seconds (1 / m_rate), &StackBench::Send, this, index + 1);
+    }
+}
+
+void
+StackBench::Receive (Ptr<Socket> socket)
+{
+  Probe (UDP_RX);
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      if (m_timing)
+        {
+          m_result.received++;
+        }
+    }
+  Probe (APP_RX);
+}
+
+StackResult
+StackBench::Run (const std::string &stack, const std::string &profile)
+{
+  m_result = StackResult ();
+  m_timing = false;
+  m_lastValid = false;
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::ProfileFile", StringValue (profile));
+  ResetPeakRss ();
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  NetDeviceContainer devices = InstallDevices (stack, nodes);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  Ipv4AddressHelper addresses ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = addresses.Assign (devices);
+  ConnectProbes (stack, nodes, devices);
+
+  Ptr<Socket> sink = Socket::CreateSocket (nodes.Get (1), UdpSocketFactory::GetTypeId ());
+  sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), PORT));
+  sink->SetRecvCallback (MakeCallback (&StackBench::Receive, this));
+  m_source = Socket::CreateSocket (nodes.Get (0), UdpSocketFactory::GetTypeId ());
+  m_source->Connect (InetSocketAddress (interfaces.GetAddress (1), PORT));
+
+  Simulator::Schedule (Seconds (0), &StackBench::Send, this, 0);
+  Simulator::Stop (Seconds ((m_warmup + m_packets) / m_rate + 0.1));
+  Simulator::Run ();
+
+  m_result.run = std::chrono::duration<double> (std::chrono::steady_clock::now () - m_start).count ();
+  m_result.events = Simulator::GetEventCount () - m_startEvents;
+  m_result.allocations = g_allocations - m_startAllocations;
+  m_result.allocatedBytes = g_allocatedBytes - m_startAllocatedBytes;
+  m_result.peakRss = GetPeakRss ();
+  m_timing = false;
+  m_source = 0;
+  Simulator::Destroy ();
+  return m_result;
+}
+
+/**
+ * Get the class of a function named by the EventProfiler.
+ * \param name the name of the function
+ * \returns the class or namespace of the function, or "other" if
+ * the function is unknown
+ */
+std::string
+GetFunctionClass (const std::string &name)
+{
+  // Functions without a symbol are named by their event type and address:
+  // the class of a method is in the type of the method pointer
+  if (name.find (" @") != std::string::npos)
+    {
+      std::string::size_type method = name.find ("::*)");
+      std::string::size_type start = name.find_last_of ("( ", method);
+      if (method == std::string::npos || start == std::string::npos)
+        {
+          return "other";
+        }
+      return name.substr (start + 1, method - start - 1);
+    }
+  // Strip the return type of templates and the arguments, outside of
+  // template arguments
+  std::string::size_type begin = 0;
+  std::string::size_type end = name.size ();
+  std::string::size_type scope = std::string::npos;
+  int depth = 0;
+  for (std::string::size_type i = 0; i < name.size (); i++)
+    {
+      char c = name[i];
+      if (c == '<')
+        {
+          depth++;
+        }
+      else if (c == '>')
+        {
+          depth--;
+        }
+      else if (depth == 0 && c == ' ')
+        {
+          begin = i + 1;
+          scope = std::string::npos;
+        }
+      else if (depth == 0 && c == '(')
+        {
+          end = i;
+          break;
+        }
+      else if (depth == 0 && c == ':' && i + 1 < name.size () && name[i + 1] == ':')
+        {
+          scope = i;
+        }
+    }
+  if (scope == std::string::npos || scope < begin)
+    {
+      return "other";
+    }
+  return name.substr (begin, std::min (scope, end) - begin);
+}
+
+/**
+ * Read the time of the events of each class from an EventProfiler
+ * JSON profile.
+ * \param filename the profile
+ * \param packets the number of packets of the run
+ * \returns the time of the events of each class, in ns per packet
+ */
+std::map<std::string, double>
+ReadEventProfile (const std::string &filename, uint32_t packets)
+{
+  std::map<std::string, double> eventNs;
+  std::ifstream is (filename.c_str ());
+  std::string line;
+  while (std::getline (is, line))
+    {
+      std::string::size_type function = line.find ("{\"function\" : \"");
+      std::string::size_type total = line.find ("\"total_s\" : ");
+      if (function == std::string::npos || total == std::string::npos)
+        {
+          continue;
+        }
+      function += 15;
+      std::string name = line.substr (function, line.find ("\", ", function) - function);
+      double seconds = std::atof (line.c_str () + total + 12);
+      eventNs[GetFunctionClass (name)] += seconds * 1e9 / packets;
+    }
+  return eventNs;
+}
+
+/**
+ * Print the results of a stack as JSON.
+ * \param stack the stack
+ * \param result the results
+ * \param first whether this is the first stack printed
+ */
+void
+PrintResult (const std::string &stack, const StackResult &result, bool first)
+{
+  double packets = result.sent > 0 ? result.sent : 1;
+  std::cout << (first ? "" : ",") << std::endl
+            << "  {" << std::endl
+            << "   \"stack\" : \"" << stack << "\"," << std::endl
+            << "   \"sent\" : " << result.sent << "," << std::endl
+            << "   \"received\" : " << result.received << "," << std::endl
+            << "   \"run_s\" : " << result.run << "," << std::endl
+            << "   \"packets_per_s\" : " << (result.run > 0 ? result.sent / result.run : 0) << "," << std::endl
+            << "   \"ns_per_packet\" : " << result.run * 1e9 / packets << "," << std::endl
+            << "   \"events_per_packet\" : " << result.events / packets << "," << std::endl
+            << "   \"allocations_per_packet\" : " << result.allocations / packets << "," << std::endl
+            << "   \"allocated_bytes_per_packet\" : " << result.allocatedBytes / packets << "," << std::endl
+            << "   \"peak_rss_kb\" : " << result.peakRss << "," << std::endl
+            << "   \"layer_ns_per_packet\" : {";
+  bool firstLayer = true;
+  for (uint32_t layer = 0; layer < LAYERS; layer++)
+    {
+      if (result.crossings[layer] == 0)
+        {
+          continue;
+        }
+      std::cout << (firstLayer ? "" : ",") << std::endl
+                << "    \"" << g_layerNames[layer] << "\" : " << result.layerNs[layer] / result.crossings[layer];
+      firstLayer = false;
+    }
+  std::cout << std::endl << "   }";
+  if (!result.eventNs.empty ())
+    {
+      std::cout << "," << std::endl << "   \"event_ns_per_packet\" : {";
+      bool firstClass = true;
+      for (const std::pair<const std::string, double> &item : result.eventNs)
+        {
+          std::cout << (firstClass ? "" : ",") << std::endl
+                    << "    \"" << item.first << "\" : " << item.second;
+          firstClass = false;
+        }
+      std::cout << std::endl << "   }";
+    }
+  std::cout << std::endl << "  }" << std::flush;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t packets = 10000;
+  uint32_t warmup = 100;
+  double rate = 1000;
+  uint32_t size = 1000;
+  std::string stack = "all";
+  bool profile = true;
+
+  CommandLine cmd (__FILE__);
+  cmd.Usage ("Benchmark the packet throughput of UDP over IPv4 over\n"
+             "a SimpleNetDevice, a CSMA link or an ad-hoc Yans wifi link.\n"
+             "\n"
+             "The results are written as JSON for regression tests: the\n"
+             "wall clock time, events, allocations and allocated bytes per\n"
+             "packet, the peak resident set size, the time per packet of\n"
+             "each layer crossed within an event and, unless --profile=false,\n"
+             "the time per packet of the events of each class, measured in a\n"
+             "second run with the EventProfiler.");
+  cmd.AddValue ("packets", "number of packets to time (default 10000)", packets);
+  cmd.AddValue ("warmup", "number of packets sent before timing (default 100)", warmup);
+  cmd.AddValue ("rate", "packets per second (default 1000)", rate);
+  cmd.AddValue ("size", "packet size, in bytes (default 1000)", size);
+  cmd.AddValue ("stack", "stack: simple, csma, wifi or all", stack);
+  cmd.AddValue ("profile", "profile the events in a second run", profile);
+  cmd.Parse (argc, argv);
+
+  std::vector<std::string> stacks;
+  if (stack == "all")
+    {
+      stacks = {"simple", "csma", "wifi"};
+    }
+  else if (stack == "simple" || stack == "csma" || stack == "wifi")
+    {
+      stacks.push_back (stack);
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown stack " << stack);
+    }
+  if (packets == 0 || rate <= 0)
+    {
+      NS_FATAL_ERROR ("The number of packets and the rate must be positive");
+    }
+
+  std::string profileFile = cmd.GetName () + "-events.json";
+  StackBench bench (packets, warmup, rate, size);
+  std::cout << std::setprecision (9);
+  std::cout << "{" << std::endl
+            << " \"packets\" : " << packets << "," << std::endl
+            << " \"warmup\" : " << warmup << "," << std::endl
+            << " \"rate\" : " << rate << "," << std::endl
+            << " \"size\" : " << size << "," << std::endl
+            << " \"results\" : [";
+  bool first = true;
+  for (const std::string &name : stacks)
+    {
+      StackResult result = bench.Run (name, "");
+      if (profile)
+        {
+          bench.Run (name, profileFile);
+          result.eventNs = ReadEventProfile (profileFile, warmup + packets);
+          std::remove (profileFile.c_str ());
+        }
+      PrintResult (name, result, first);
+      first = false;
+    }
+  std::cout << std::endl << " ]" << std::endl << "}" << std::endl;
+  return 0;
+}
@@ -0,0 +1,54 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bench-utils.h"
+
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+
+void
+ResetPeakRss (void)
+{
+#ifdef __linux__
+  // Writing 5 to clear_refs resets VmHWM, since Linux 4.0
+  std::ofstream clearRefs ("/proc/self/clear_refs");
+  clearRefs << "5" << std::endl;
+#endif
+}
+
+uint64_t
+GetPeakRss (void)
+{
+#ifdef __linux__
+  std::ifstream status ("/proc/self/status");
+  std::string line;
+  while (std::getline (status, line))
+    {
+      if (line.compare (0, 6, "VmHWM:") == 0)
+        {
+          return std::stoull (line.substr (6));
+        }
+    }
+#endif
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
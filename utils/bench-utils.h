@@ -0,0 +1,40 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \ingroup utils
+ * Memory measurements shared by the benchmark programs.
+ */
+
+/**
+ * Reset the peak resident set size of the process, where supported.
+ */
+void ResetPeakRss (void);
+
+/**
+ * Get the peak resident set size of the process.
+ * \returns The peak resident set size since the last ResetPeakRss(),
+ * where supported, or since the start of the process, in kB.
+ */
+uint64_t GetPeakRss (void);
+
+#endif /* BENCH_UTILS_H */